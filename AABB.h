@@ -0,0 +1,297 @@
+#pragma once
+#include <cstddef>
+#include <limits>
+#include "Matrices.h"
+#include "VecArraySoA.h"
+#include "Pack.h"
+
+namespace gm
+{
+	// Axis aligned bounding box [min, max]. AABB::empty() has min = +max T and max = lowest T,
+	// so it grows to the first point or box it is united with, isEmpty() is true whenever min > max in any axis.
+	//
+	// AABB(points, count) / AABB(soaPoints) reduce with one simd::Pack of running min / max per component,
+	// the lanes are combined once at the end.
+	//
+	// transform(m, box) is Arvo's transform by an affine m: the center goes through m, the half extents through |m|,
+	// giving the tightest box around the transformed box. Boxes must not be empty.
+	// transform(m, in, out, count) transforms every box by one matrix, transform(ms, in, out, count) box i by ms[i].
+	// For float with SSE2 every 128 bit lane transforms one box, 4 columns and the box loaded straight from AoS,
+	// batched and single results are identical. in and out may be the same array.
+	template<int L, typename T>
+	struct AABB
+	{
+		Vec<L, T> min;
+		Vec<L, T> max;
+
+		inline AABB() = default;
+		inline AABB(const Vec<L, T>& min, const Vec<L, T>& max) : min(min), max(max) {}
+		inline AABB(const Vec<L, T>* points, size_t count);
+		inline explicit AABB(const VecArraySoA<L, T>& points);
+
+		static inline AABB empty() { return AABB(Vec<L, T>(std::numeric_limits<T>::max()), Vec<L, T>(std::numeric_limits<T>::lowest())); }
+
+		inline Vec<L, T> center() const { return (min + max) * (T)0.5; }
+		inline Vec<L, T> extents() const { return (max - min) * (T)0.5; }
+		inline Vec<L, T> size() const { return max - min; }
+
+		inline bool isEmpty() const
+		{
+			for (int i = 0; i < L; ++i)
+				if (min[i] > max[i])
+					return true;
+			return false;
+		}
+
+		inline bool contains(const Vec<L, T>& p) const
+		{
+			for (int i = 0; i < L; ++i)
+				if (p[i] < min[i] || p[i] > max[i])
+					return false;
+			return true;
+		}
+
+		inline bool contains(const AABB& b) const
+		{
+			for (int i = 0; i < L; ++i)
+				if (b.min[i] < min[i] || b.max[i] > max[i])
+					return false;
+			return true;
+		}
+
+		// touching boxes intersect
+		inline bool intersects(const AABB& b) const
+		{
+			for (int i = 0; i < L; ++i)
+				if (b.max[i] < min[i] || b.min[i] > max[i])
+					return false;
+			return true;
+		}
+	};
+
+	// plain compares rather than the Vec min / max, max goes through fmax which is a libm call
+	template<int L, typename T>
+	inline AABB<L, T> unite(const AABB<L, T>& a, const AABB<L, T>& b)
+	{
+		AABB<L, T> y;
+		for (int i = 0; i < L; ++i)
+		{
+			y.min[i] = b.min[i] < a.min[i] ? b.min[i] : a.min[i];
+			y.max[i] = b.max[i] > a.max[i] ? b.max[i] : a.max[i];
+		}
+		return y;
+	}
+
+	template<int L, typename T>
+	inline AABB<L, T> unite(const AABB<L, T>& a, const Vec<L, T>& p)
+	{
+		return unite(a, AABB<L, T>(p, p));
+	}
+
+	// empty when a and b do not intersect
+	template<int L, typename T>
+	inline AABB<L, T> intersect(const AABB<L, T>& a, const AABB<L, T>& b)
+	{
+		AABB<L, T> y;
+		for (int i = 0; i < L; ++i)
+		{
+			y.min[i] = b.min[i] > a.min[i] ? b.min[i] : a.min[i];
+			y.max[i] = b.max[i] < a.max[i] ? b.max[i] : a.max[i];
+		}
+		return y;
+	}
+
+	namespace detail
+	{
+		template<typename T>
+		struct BoundsAccumulator
+		{
+			typedef simd::Pack<T> P;
+			P lo[3], hi[3];
+
+			inline BoundsAccumulator()
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					lo[c] = P(std::numeric_limits<T>::max());
+					hi[c] = P(std::numeric_limits<T>::lowest());
+				}
+			}
+
+			inline void add(int c, const P& v)
+			{
+				lo[c] = simd::min(lo[c], v);
+				hi[c] = simd::max(hi[c], v);
+			}
+
+			inline void reduce(int c, T& outMin, T& outMax) const
+			{
+				alignas(64) T a[P::size], b[P::size];
+				lo[c].store(a);
+				hi[c].store(b);
+				for (int i = 0; i < P::size; ++i)
+				{
+					outMin = a[i] < outMin ? a[i] : outMin;
+					outMax = b[i] > outMax ? b[i] : outMax;
+				}
+			}
+		};
+
+		template<int L, typename T>
+		inline AABB<L, T> bounds(const Vec<L, T>* points, size_t count)
+		{
+			AABB<L, T> box = AABB<L, T>::empty();
+			for (size_t i = 0; i < count; ++i)
+				box = unite(box, points[i]);
+			return box;
+		}
+
+		template<typename T>
+		inline AABB<3, T> bounds(const Vec<3, T>* points, size_t count)
+		{
+			typedef simd::Pack<T> P;
+			BoundsAccumulator<T> acc;
+			size_t i = 0;
+			P x, y, z;
+			for (; i + P::size <= count; i += P::size)
+			{
+				simd::loadAoS3(&points[i].x, x, y, z);
+				acc.add(0, x);
+				acc.add(1, y);
+				acc.add(2, z);
+			}
+			AABB<3, T> box = AABB<3, T>::empty();
+			for (; i < count; ++i)
+				box = unite(box, points[i]);
+			for (int c = 0; c < 3; ++c)
+				acc.reduce(c, box.min[c], box.max[c]);
+			return box;
+		}
+
+		template<int L, typename T>
+		inline AABB<L, T> bounds(const VecArraySoA<L, T>& points)
+		{
+			typedef simd::Pack<T> P;
+			AABB<L, T> box = AABB<L, T>::empty();
+			// whole Packs below size, the padding past it is not part of the set
+			size_t whole = points.size() / P::size * P::size;
+			for (int c = 0; c < L; ++c)
+			{
+				const T* s = points.stream(c);
+				BoundsAccumulator<T> acc;
+				for (size_t i = 0; i < whole; i += P::size)
+					acc.add(0, P::load(s + i));
+				acc.reduce(0, box.min[c], box.max[c]);
+				for (size_t i = whole; i < points.size(); ++i)
+				{
+					box.min[c] = s[i] < box.min[c] ? s[i] : box.min[c];
+					box.max[c] = s[i] > box.max[c] ? s[i] : box.max[c];
+				}
+			}
+			return box;
+		}
+	}
+
+	template<int L, typename T>
+	inline AABB<L, T>::AABB(const Vec<L, T>* points, size_t count) : AABB(detail::bounds(points, count)) {}
+
+	template<int L, typename T>
+	inline AABB<L, T>::AABB(const VecArraySoA<L, T>& points) : AABB(detail::bounds(points)) {}
+
+	template<typename T>
+	inline AABB<3, T> transform(const Mat<4, 4, T>& m, const AABB<3, T>& box)
+	{
+		Vec<3, T> c = box.center(), e = box.extents();
+		Vec<3, T> nc, ne;
+		for (int r = 0; r < 3; ++r)
+		{
+			T y = m[12 + r];
+			T x = std::abs(m[r]) * e[0];
+			y = y + m[r] * c[0];
+			y = y + m[4 + r] * c[1];
+			y = y + m[8 + r] * c[2];
+			x = x + std::abs(m[4 + r]) * e[1];
+			x = x + std::abs(m[8 + r]) * e[2];
+			nc[r] = y;
+			ne[r] = x;
+		}
+		return AABB<3, T>(nc - ne, nc + ne);
+	}
+
+	template<typename T>
+	inline void transform(const Mat<4, 4, T>& m, const AABB<3, T>* in, AABB<3, T>* out, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			out[i] = transform(m, in[i]);
+	}
+
+	template<typename T>
+	inline void transform(const Mat<4, 4, T>* m, const AABB<3, T>* in, AABB<3, T>* out, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			out[i] = transform(m[i], in[i]);
+	}
+
+#if defined(GM_SIMD_SSE2)
+	namespace detail
+	{
+		// box k of the Pack at box + k * BoxStride, its matrix at m + k * MatStride floats.
+		// Stride 0 broadcasts one box or matrix to every lane.
+		template<int BoxStride, int MatStride>
+		GM_FORCEINLINE void transformBoxLanes(const float* m, const float* box, float* out)
+		{
+			typedef simd::Pack<float> P;
+			using simd::shuffleLanes;
+			P col0 = simd::loadLanes<MatStride>(m), col1 = simd::loadLanes<MatStride>(m + 4);
+			P col2 = simd::loadLanes<MatStride>(m + 8), col3 = simd::loadLanes<MatStride>(m + 12);
+			// lo = min.xyz max.x, hi = min.z max.xyz
+			P lo = simd::loadLanes<BoxStride>(box), hi = simd::loadLanes<BoxStride>(box + 2);
+			P mx = shuffleLanes<_MM_SHUFFLE(3, 3, 2, 1)>(hi.v, hi.v);
+			P c = (lo + mx) * P(0.5f), e = (mx - lo) * P(0.5f);
+
+			// same order as the scalar transform
+			P y = simd::madd(col0, P(shuffleLanes<_MM_SHUFFLE(0, 0, 0, 0)>(c.v, c.v)), col3);
+			P x = simd::abs(col0) * P(shuffleLanes<_MM_SHUFFLE(0, 0, 0, 0)>(e.v, e.v));
+			y = simd::madd(col1, P(shuffleLanes<_MM_SHUFFLE(1, 1, 1, 1)>(c.v, c.v)), y);
+			y = simd::madd(col2, P(shuffleLanes<_MM_SHUFFLE(2, 2, 2, 2)>(c.v, c.v)), y);
+			x = simd::madd(simd::abs(col1), P(shuffleLanes<_MM_SHUFFLE(1, 1, 1, 1)>(e.v, e.v)), x);
+			x = simd::madd(simd::abs(col2), P(shuffleLanes<_MM_SHUFFLE(2, 2, 2, 2)>(e.v, e.v)), x);
+			P nmin = y - x, nmax = y + x;
+
+			// min.xyz and a placeholder, then min.z max.xyz over it
+			P t = shuffleLanes<_MM_SHUFFLE(0, 0, 2, 2)>(nmin.v, nmax.v);
+			simd::storeLanes<BoxStride>(out, nmin.v, false);
+			simd::storeLanes<BoxStride>(out + 2, shuffleLanes<_MM_SHUFFLE(2, 1, 2, 0)>(t.v, nmax.v), false);
+		}
+
+		template<int MatStride>
+		inline void transformBoxes(const float* m, const AABB<3, float>* in, AABB<3, float>* out, size_t count)
+		{
+			const int G = simd::Pack<float>::size / 4;
+			size_t i = 0;
+			for (; i + G <= count; i += G)
+				transformBoxLanes<6, MatStride>(m + i * MatStride, &in[i].min.x, &out[i].min.x);
+			for (; i < count; ++i)
+				transformBoxLanes<0, 0>(m + i * MatStride, &in[i].min.x, &out[i].min.x);
+		}
+	}
+
+	inline AABB<3, float> transform(const Mat<4, 4, float>& m, const AABB<3, float>& box)
+	{
+		AABB<3, float> y;
+		detail::transformBoxLanes<0, 0>(m.values, &box.min.x, &y.min.x);
+		return y;
+	}
+
+	inline void transform(const Mat<4, 4, float>& m, const AABB<3, float>* in, AABB<3, float>* out, size_t count)
+	{
+		detail::transformBoxes<0>(m.values, in, out, count);
+	}
+
+	inline void transform(const Mat<4, 4, float>* m, const AABB<3, float>* in, AABB<3, float>* out, size_t count)
+	{
+		static_assert(sizeof(Mat<4, 4, float>) == 16 * sizeof(float) && sizeof(AABB<3, float>) == 6 * sizeof(float), "matrices and boxes must be tightly packed");
+		detail::transformBoxes<16>(m->values, in, out, count);
+	}
+#endif
+}
@@ -0,0 +1,316 @@
+#pragma once
+#include <cstddef>
+#include "Matrices.h"
+
+namespace gm
+{
+	// Affine transforms stored as Mat<3, 4, T>: the upper three rows of a Mat<4, 4, T> whose last row is 0, 0, 0, 1,
+	// 48 bytes for float instead of 64. Column major like every Mat, the columns are the x, y, z axes and the translation,
+	// the layout of the skinning palette. The constant row is neither stored nor multiplied:
+	// a * b composes (b applied first) with 36 multiplies against 64 for Mat<4, 4>, inverse() is a 3x3 inverse plus
+	// one 3x3 * vector product, transformPoint() / transformVector() are 9 multiplies. Mat<4, 4> * Mat<3, 4>
+	// (a projection times an instance) gives a Mat<4, 4> in 48 multiplies.
+	//
+	// toAffine(Mat<4, 4>) drops the last row, toMat4() restores it. affine(rotation, translation[, scale]) builds one
+	// from a quaternion like translate(rotation(q), t), decompose() recovers them when there is no shear.
+	template<typename T>
+	inline constexpr Mat<3, 4, T> affine(const Mat<3, 3, T> &m, const Vec<3, T> &translation)
+	{
+		return Mat<3, 4, T>
+		{
+			m[0], m[1], m[2],
+			m[3], m[4], m[5],
+			m[6], m[7], m[8],
+			translation[0], translation[1], translation[2]
+		};
+	}
+
+	template<typename T>
+	inline constexpr Mat<3, 4, T> affine(const Quat<T> &rotation, const Vec<3, T> &translation)
+	{
+		return affine(gm::rotation(rotation), translation);
+	}
+
+	template<typename T>
+	inline constexpr Mat<3, 4, T> affine(const Quat<T> &rotation, const Vec<3, T> &translation, const Vec<3, T> &scale)
+	{
+		Mat<3, 3, T> r = gm::rotation(rotation);
+		return Mat<3, 4, T>
+		{
+			r[0] * scale[0], r[1] * scale[0], r[2] * scale[0],
+			r[3] * scale[1], r[4] * scale[1], r[5] * scale[1],
+			r[6] * scale[2], r[7] * scale[2], r[8] * scale[2],
+			translation[0], translation[1], translation[2]
+		};
+	}
+
+	template<typename T>
+	inline constexpr Mat<3, 4, T> toAffine(const Mat<4, 4, T> &m)
+	{
+		return Mat<3, 4, T>
+		{
+			m[0], m[1], m[2],
+			m[4], m[5], m[6],
+			m[8], m[9], m[10],
+			m[12], m[13], m[14]
+		};
+	}
+
+	template<typename T>
+	inline constexpr Mat<4, 4, T> toMat4(const Mat<3, 4, T> &m)
+	{
+		const T _0 = 0;
+		const T _1 = 1;
+		return Mat<4, 4, T>
+		{
+			m[0], m[1], m[2], _0,
+			m[3], m[4], m[5], _0,
+			m[6], m[7], m[8], _0,
+			m[9], m[10], m[11], _1
+		};
+	}
+
+	// The 3x3 rotation / scale / shear part
+	template<typename T>
+	inline constexpr Mat<3, 3, T> linear(const Mat<3, 4, T> &m)
+	{
+		return Mat<3, 3, T>
+		{
+			m[0], m[1], m[2],
+			m[3], m[4], m[5],
+			m[6], m[7], m[8]
+		};
+	}
+
+	template<typename T>
+	inline constexpr Vec<3, T> translation(const Mat<3, 4, T> &m)
+	{
+		return Vec<3, T>(m[9], m[10], m[11]);
+	}
+
+	// Scale is the length of each axis, negated on x for a mirroring transform. The rotation is only meaningful without shear.
+	template<typename T>
+	inline constexpr void decompose(const Mat<3, 4, T> &m, Quat<T> &rotation, Vec<3, T> &translation, Vec<3, T> &scale)
+	{
+		Mat<3, 3, T> r = linear(m);
+		T sx = cx::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+		T sy = cx::sqrt(r[3] * r[3] + r[4] * r[4] + r[5] * r[5]);
+		T sz = cx::sqrt(r[6] * r[6] + r[7] * r[7] + r[8] * r[8]);
+		if (determinant(r) < 0)
+			sx = -sx;
+		T ix = (T)1 / sx, iy = (T)1 / sy, iz = (T)1 / sz;
+		r[0] *= ix; r[1] *= ix; r[2] *= ix;
+		r[3] *= iy; r[4] *= iy; r[5] *= iy;
+		r[6] *= iz; r[7] *= iz; r[8] *= iz;
+		rotation = toQuat(r);
+		translation = gm::translation(m);
+		scale = Vec<3, T>(sx, sy, sz);
+	}
+
+	template<typename T>
+	inline constexpr void decompose(const Mat<3, 4, T> &m, Quat<T> &rotation, Vec<3, T> &translation)
+	{
+		rotation = toQuat(linear(m));
+		translation = gm::translation(m);
+	}
+
+	template<typename T>
+	inline constexpr Mat<3, 4, T> operator * (const Mat<3, 4, T> &a, const Mat<3, 4, T> &b)
+	{
+		return Mat<3, 4, T>
+		{
+			a[0] * b[0] + a[3] * b[1] + a[6] * b[2],
+			a[1] * b[0] + a[4] * b[1] + a[7] * b[2],
+			a[2] * b[0] + a[5] * b[1] + a[8] * b[2],
+			a[0] * b[3] + a[3] * b[4] + a[6] * b[5],
+			a[1] * b[3] + a[4] * b[4] + a[7] * b[5],
+			a[2] * b[3] + a[5] * b[4] + a[8] * b[5],
+			a[0] * b[6] + a[3] * b[7] + a[6] * b[8],
+			a[1] * b[6] + a[4] * b[7] + a[7] * b[8],
+			a[2] * b[6] + a[5] * b[7] + a[8] * b[8],
+			a[0] * b[9] + a[3] * b[10] + a[6] * b[11] + a[9],
+			a[1] * b[9] + a[4] * b[10] + a[7] * b[11] + a[10],
+			a[2] * b[9] + a[5] * b[10] + a[8] * b[11] + a[11]
+		};
+	}
+
+	template<typename T>
+	inline constexpr Mat<3, 4, T> & operator *= (Mat<3, 4, T> &a, const Mat<3, 4, T> &b)
+	{
+		return a = a * b;
+	}
+
+	// A full matrix times an affine one, e.g. viewProjection * model.
+	template<typename T>
+	inline constexpr Mat<4, 4, T> operator * (const Mat<4, 4, T> &a, const Mat<3, 4, T> &b)
+	{
+		Mat<4, 4, T> y{};
+		for (int c = 0; c < 4; ++c)
+			for (int r = 0; r < 4; ++r)
+				y[c * 4 + r] = a[r] * b[c * 3] + a[4 + r] * b[c * 3 + 1] + a[8 + r] * b[c * 3 + 2] + (c == 3 ? a[12 + r] : (T)0);
+		return y;
+	}
+
+	template<typename T>
+	inline constexpr Vec<3, T> transformPoint(const Mat<3, 4, T> &m, const Vec<3, T> &p)
+	{
+		return Vec<3, T>(
+			m[0] * p[0] + m[3] * p[1] + m[6] * p[2] + m[9],
+			m[1] * p[0] + m[4] * p[1] + m[7] * p[2] + m[10],
+			m[2] * p[0] + m[5] * p[1] + m[8] * p[2] + m[11]);
+	}
+
+	template<typename T>
+	inline constexpr Vec<3, T> transformVector(const Mat<3, 4, T> &m, const Vec<3, T> &v)
+	{
+		return Vec<3, T>(
+			m[0] * v[0] + m[3] * v[1] + m[6] * v[2],
+			m[1] * v[0] + m[4] * v[1] + m[7] * v[2],
+			m[2] * v[0] + m[5] * v[1] + m[8] * v[2]);
+	}
+
+	namespace detail
+	{
+		// r = inverse of the 3x3 part of m, translation -r * t
+		template<typename T>
+		inline constexpr Mat<3, 4, T> affineInverse(const Mat<3, 3, T> &r, const Mat<3, 4, T> &m)
+		{
+			return Mat<3, 4, T>
+			{
+				r[0], r[1], r[2],
+				r[3], r[4], r[5],
+				r[6], r[7], r[8],
+				-(r[0] * m[9] + r[3] * m[10] + r[6] * m[11]),
+				-(r[1] * m[9] + r[4] * m[10] + r[7] * m[11]),
+				-(r[2] * m[9] + r[5] * m[10] + r[8] * m[11])
+			};
+		}
+	}
+
+	template<typename T>
+	inline constexpr Mat<3, 4, T> inverse(const Mat<3, 4, T> &m)
+	{
+		return detail::affineInverse(inverse(linear(m)), m);
+	}
+
+	// Inverse of a rotation + translation, e.g. affine(q, t).
+	template<typename T>
+	inline constexpr Mat<3, 4, T> inverseRigid(const Mat<3, 4, T> &m)
+	{
+		return detail::affineInverse(Mat<3, 3, T>
+		{
+			m[0], m[3], m[6],
+			m[1], m[4], m[7],
+			m[2], m[5], m[8]
+		}, m);
+	}
+
+#if defined(GM_SIMD_SSE2)
+	namespace detail
+	{
+		// The 4 columns of a Mat<3, 4, float> in the xyz lanes of 4 registers, w is garbage. Read and written
+		// as 3 unaligned 16 byte pieces at the same offsets, so a matrix stored by one call forwards to the loads of the next.
+		GM_FORCEINLINE void loadAffine(const Mat<3, 4, float> &m, __m128 &c0, __m128 &c1, __m128 &c2, __m128 &c3)
+		{
+			__m128 l0 = _mm_loadu_ps(m.values);
+			__m128 l1 = _mm_loadu_ps(m.values + 4);
+			__m128 l2 = _mm_loadu_ps(m.values + 8);
+			c0 = l0;
+			c1 = _mm_shuffle_ps(l0, l1, _MM_SHUFFLE(1, 0, 3, 3));
+			c1 = _mm_shuffle_ps(c1, c1, _MM_SHUFFLE(3, 3, 2, 0));
+			c2 = _mm_shuffle_ps(l1, l2, _MM_SHUFFLE(0, 0, 3, 2));
+			c3 = _mm_shuffle_ps(l2, l2, _MM_SHUFFLE(3, 3, 2, 1));
+		}
+
+		GM_FORCEINLINE void storeAffine(Mat<3, 4, float> &m, __m128 c0, __m128 c1, __m128 c2, __m128 c3)
+		{
+			__m128 t0 = _mm_shuffle_ps(c0, c1, _MM_SHUFFLE(0, 0, 2, 2));
+			__m128 t2 = _mm_shuffle_ps(c2, c3, _MM_SHUFFLE(0, 0, 2, 2));
+			_mm_storeu_ps(m.values, _mm_shuffle_ps(c0, t0, _MM_SHUFFLE(2, 0, 1, 0)));
+			_mm_storeu_ps(m.values + 4, _mm_shuffle_ps(c1, c2, _MM_SHUFFLE(1, 0, 2, 1)));
+			_mm_storeu_ps(m.values + 8, _mm_shuffle_ps(t2, c3, _MM_SHUFFLE(2, 1, 2, 0)));
+		}
+	}
+
+	inline GM_CONSTEXPR Mat<3, 4, float> operator * (const Mat<3, 4, float> &a, const Mat<3, 4, float> &b)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return operator*<float>(a, b);
+		__m128 a0, a1, a2, a3;
+		detail::loadAffine(a, a0, a1, a2, a3);
+		const float *v = b.values;
+		__m128 y0 = simd::madd(a2, _mm_set1_ps(v[2]), simd::madd(a1, _mm_set1_ps(v[1]), _mm_mul_ps(a0, _mm_set1_ps(v[0]))));
+		__m128 y1 = simd::madd(a2, _mm_set1_ps(v[5]), simd::madd(a1, _mm_set1_ps(v[4]), _mm_mul_ps(a0, _mm_set1_ps(v[3]))));
+		__m128 y2 = simd::madd(a2, _mm_set1_ps(v[8]), simd::madd(a1, _mm_set1_ps(v[7]), _mm_mul_ps(a0, _mm_set1_ps(v[6]))));
+		__m128 y3 = simd::madd(a2, _mm_set1_ps(v[11]), simd::madd(a1, _mm_set1_ps(v[10]), simd::madd(a0, _mm_set1_ps(v[9]), a3)));
+		Mat<3, 4, float> m;
+		detail::storeAffine(m, y0, y1, y2, y3);
+		return m;
+	}
+
+	inline GM_CONSTEXPR Mat<4, 4, float> operator * (const Mat<4, 4, float> &a, const Mat<3, 4, float> &b)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return operator*<float>(a, b);
+		__m128 a0 = a.base_vecs[0].simd();
+		__m128 a1 = a.base_vecs[1].simd();
+		__m128 a2 = a.base_vecs[2].simd();
+		__m128 a3 = a.base_vecs[3].simd();
+		const float *v = b.values;
+		Mat<4, 4, float> y;
+		y.base_vecs[0].simd(simd::madd(a2, _mm_set1_ps(v[2]), simd::madd(a1, _mm_set1_ps(v[1]), _mm_mul_ps(a0, _mm_set1_ps(v[0])))));
+		y.base_vecs[1].simd(simd::madd(a2, _mm_set1_ps(v[5]), simd::madd(a1, _mm_set1_ps(v[4]), _mm_mul_ps(a0, _mm_set1_ps(v[3])))));
+		y.base_vecs[2].simd(simd::madd(a2, _mm_set1_ps(v[8]), simd::madd(a1, _mm_set1_ps(v[7]), _mm_mul_ps(a0, _mm_set1_ps(v[6])))));
+		y.base_vecs[3].simd(simd::madd(a2, _mm_set1_ps(v[11]), simd::madd(a1, _mm_set1_ps(v[10]), simd::madd(a0, _mm_set1_ps(v[9]), a3))));
+		return y;
+	}
+
+	inline GM_CONSTEXPR Mat<3, 4, float> inverse(const Mat<3, 4, float> &m)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return inverse<float>(m);
+		__m128 a0, a1, a2, t;
+		detail::loadAffine(m, a0, a1, a2, t);
+		__m128 r0 = simd::cross3(a1, a2);
+		__m128 r1 = simd::cross3(a2, a0);
+		__m128 r2 = simd::cross3(a0, a1);
+		__m128 r3 = _mm_setzero_ps();
+		// a0.w is garbage, and so is cross3's w under FMA
+		__m128 det = _mm_and_ps(_mm_mul_ps(a0, r0), _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)));
+		__m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), simd::hsum(det));
+		r0 = _mm_mul_ps(r0, invDet);
+		r1 = _mm_mul_ps(r1, invDet);
+		r2 = _mm_mul_ps(r2, invDet);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+		__m128 it = _mm_mul_ps(r0, simd::splat<0>(t));
+		it = simd::madd(r1, simd::splat<1>(t), it);
+		it = simd::madd(r2, simd::splat<2>(t), it);
+		Mat<3, 4, float> y;
+		detail::storeAffine(y, r0, r1, r2, _mm_sub_ps(_mm_setzero_ps(), it));
+		return y;
+	}
+#endif
+
+	// Batched forms, out may alias a or b.
+	template<typename T>
+	inline void multiply(const Mat<3, 4, T> *a, const Mat<3, 4, T> *b, Mat<3, 4, T> *out, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			out[i] = a[i] * b[i];
+	}
+
+	template<typename T>
+	inline void toAffine(const Mat<4, 4, T> *in, Mat<3, 4, T> *out, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			out[i] = toAffine(in[i]);
+	}
+
+	template<typename T>
+	inline void toMat4(const Mat<3, 4, T> *in, Mat<4, 4, T> *out, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			out[i] = toMat4(in[i]);
+	}
+}
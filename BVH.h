@@ -0,0 +1,502 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <limits>
+#include "AABB.h"
+#include "Ray.h"
+
+namespace gm
+{
+	// Binary bounding volume hierarchy over primitive bounds, built with binned SAH.
+	//
+	// Nodes are 32 bytes for float: the node box, then first / count. Interior nodes have count 0 and their
+	// two children at first and first + 1, leaves cover indices[first, first + count). The root is node 0,
+	// node 1 is unused so every sibling pair starts at an even index and shares one 64 byte line.
+	// Children always come after their parent, refit() walks the nodes backwards once.
+	//
+	// build(bounds, count) bins centroids into 16 bins along the widest centroid axis and splits at the
+	// lowest SAH cost, nodes of at most maxLeafSize primitives become leaves when that is cheaper.
+	// Subtrees bigger than 4096 primitives are built on their own std::thread, up to threads
+	// (0: std::thread::hardware_concurrency()). From depth 32 on nodes are split at the median instead,
+	// which bounds the depth, and with it the traversal stacks, by 64.
+	//
+	// Queries call f for every primitive whose leaf is hit, f tests the primitive itself:
+	//   intersect(ray, tMax, f)          bool f(primitive, T& tMax) returns a hit and shortens tMax,
+	//                                    leaves are visited front to back, the result is whether f hit
+	//   overlap(box, f) / overlap(center, radius, f)  void f(primitive)
+	// The batched forms run one query after another on one traversal stack, f gets the query index first.
+	// Queries are const, threads may split a batch between them.
+	template<typename T>
+	struct BVH
+	{
+		struct Node
+		{
+			AABB<3, T> bounds;
+			uint32_t first;
+			uint32_t count;
+
+			inline bool isLeaf() const { return count != 0; }
+		};
+
+		static const int maxDepth = 64;
+
+		// traversal stack entry of intersect, the far child and its entry distance
+		struct RayEntry
+		{
+			uint32_t node;
+			T tNear;
+		};
+
+		std::vector<Node, simd::AlignedAllocator<Node, 64>> nodes;
+		std::vector<uint32_t> indices;
+
+		inline BVH() = default;
+		inline BVH(const AABB<3, T>* bounds, size_t count, int maxLeafSize = 4, unsigned threads = 0)
+		{
+			build(bounds, count, maxLeafSize, threads);
+		}
+
+		inline void build(const AABB<3, T>* bounds, size_t count, int maxLeafSize = 4, unsigned threads = 0);
+		inline void refit(const AABB<3, T>* bounds);
+
+		template<typename F>
+		inline bool intersect(const Ray<T>& ray, T& tMax, F f) const
+		{
+			RayEntry stack[maxDepth];
+			return intersect(ray, tMax, f, stack);
+		}
+		template<typename F>
+		inline void overlap(const AABB<3, T>& box, F f) const
+		{
+			uint32_t stack[maxDepth];
+			overlap(box, f, stack);
+		}
+		template<typename F>
+		inline void overlap(const Vec<3, T>& center, T radius, F f) const
+		{
+			uint32_t stack[maxDepth];
+			overlap(center, radius, f, stack);
+		}
+
+		// the same on a caller provided stack of maxDepth entries
+		template<typename F>
+		inline bool intersect(const Ray<T>& ray, T& tMax, F f, RayEntry* stack) const;
+		template<typename F>
+		inline void overlap(const AABB<3, T>& box, F f, uint32_t* stack) const;
+		template<typename F>
+		inline void overlap(const Vec<3, T>& center, T radius, F f, uint32_t* stack) const;
+
+		// f(query, primitive, tMax[query])
+		template<typename F>
+		inline void intersect(const Ray<T>* rays, T* tMax, size_t count, F f) const
+		{
+			RayEntry stack[maxDepth];
+			for (size_t q = 0; q < count; ++q)
+				intersect(rays[q], tMax[q], [&](uint32_t primitive, T& t) { return f(q, primitive, t); }, stack);
+		}
+
+		// f(query, primitive)
+		template<typename F>
+		inline void overlap(const AABB<3, T>* boxes, size_t count, F f) const
+		{
+			uint32_t stack[maxDepth];
+			for (size_t q = 0; q < count; ++q)
+				overlap(boxes[q], [&](uint32_t primitive) { f(q, primitive); }, stack);
+		}
+
+		template<typename F>
+		inline void overlap(const Vec<3, T>* centers, const T* radii, size_t count, F f) const
+		{
+			uint32_t stack[maxDepth];
+			for (size_t q = 0; q < count; ++q)
+				overlap(centers[q], radii[q], [&](uint32_t primitive) { f(q, primitive); }, stack);
+		}
+	};
+
+	namespace detail
+	{
+		template<typename T>
+		struct BVHBuilder
+		{
+			typedef typename BVH<T>::Node Node;
+			static const int binCount = 16;
+			static const size_t parallelSize = 4096;
+			static const int medianDepth = 32;
+
+			// plain arrays rather than AABB, Vec's union keeps the compiler from holding boxes in registers
+			struct Box
+			{
+				T lo[3], hi[3];
+
+				inline void clear()
+				{
+					for (int i = 0; i < 3; ++i)
+					{
+						lo[i] = std::numeric_limits<T>::max();
+						hi[i] = std::numeric_limits<T>::lowest();
+					}
+				}
+				inline void grow(const Box& b)
+				{
+					for (int i = 0; i < 3; ++i)
+					{
+						lo[i] = b.lo[i] < lo[i] ? b.lo[i] : lo[i];
+						hi[i] = b.hi[i] > hi[i] ? b.hi[i] : hi[i];
+					}
+				}
+				inline void grow(const T* p)
+				{
+					for (int i = 0; i < 3; ++i)
+					{
+						lo[i] = p[i] < lo[i] ? p[i] : lo[i];
+						hi[i] = p[i] > hi[i] ? p[i] : hi[i];
+					}
+				}
+				inline T halfArea() const
+				{
+					T x = hi[0] - lo[0], y = hi[1] - lo[1], z = hi[2] - lo[2];
+					return x * y + y * z + z * x;
+				}
+			};
+
+			// primitives are partitioned by value, so every pass over a range reads memory in order
+			struct Reference
+			{
+				Box box;
+				uint32_t index;
+
+				// twice the center, the factor cancels out of binning and comparisons
+				inline T centroid(int axis) const { return box.lo[axis] + box.hi[axis]; }
+				inline void growCentroids(Box& b) const
+				{
+					T c[3] = { centroid(0), centroid(1), centroid(2) };
+					b.grow(c);
+				}
+			};
+
+			Reference* refs;
+			Node* nodes;
+			int maxLeafSize;
+			std::atomic<uint32_t> nodeCount;
+			std::atomic<int> threadsLeft;
+
+			inline void rangeBounds(uint32_t begin, uint32_t end, Box& box, Box& centroids) const
+			{
+				box.clear();
+				centroids.clear();
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					box.grow(refs[i].box);
+					refs[i].growCentroids(centroids);
+				}
+			}
+
+			// box and centroids of the range come from the parent's bins
+			inline void build(uint32_t nodeIndex, uint32_t begin, uint32_t end, int depth, const Box& box, const Box& centroids)
+			{
+				Node& node = nodes[nodeIndex];
+				node.bounds = AABB<3, T>(Vec<3, T>(box.lo[0], box.lo[1], box.lo[2]), Vec<3, T>(box.hi[0], box.hi[1], box.hi[2]));
+				node.first = begin;
+				node.count = end - begin;
+				uint32_t count = end - begin;
+				if (count <= 1)
+					return;
+
+				T extent[3] = { centroids.hi[0] - centroids.lo[0], centroids.hi[1] - centroids.lo[1], centroids.hi[2] - centroids.lo[2] };
+				int axis = extent[0] > extent[1] ? (extent[0] > extent[2] ? 0 : 2) : (extent[1] > extent[2] ? 1 : 2);
+				uint32_t middle;
+				Box childBox[2], childCentroids[2];
+				// below binCount * min() the bin scale overflows to inf, such axes are split at the median like flat ones
+				if (extent[axis] <= (T)binCount * std::numeric_limits<T>::min() || depth >= medianDepth)
+				{
+					if (count <= (uint32_t)maxLeafSize)
+						return;
+					middle = begin + count / 2;
+					std::nth_element(refs + begin, refs + middle, refs + end, [&](const Reference& a, const Reference& b) { return a.centroid(axis) < b.centroid(axis); });
+					rangeBounds(begin, middle, childBox[0], childCentroids[0]);
+					rangeBounds(middle, end, childBox[1], childCentroids[1]);
+				}
+				else
+				{
+					Box binBox[binCount], binCentroids[binCount];
+					uint32_t binPrimitives[binCount] = {};
+					for (int b = 0; b < binCount; ++b)
+					{
+						binBox[b].clear();
+						binCentroids[b].clear();
+					}
+					T origin = centroids.lo[axis], scale = (T)binCount * (T)0.9999 / extent[axis];
+					auto binOf = [&](const Reference& r) { return std::min((int)((r.centroid(axis) - origin) * scale), binCount - 1); };
+					for (uint32_t i = begin; i < end; ++i)
+					{
+						int b = binOf(refs[i]);
+						binBox[b].grow(refs[i].box);
+						refs[i].growCentroids(binCentroids[b]);
+						++binPrimitives[b];
+					}
+
+					// cost of splitting after bin s: area * count left of it plus right of it
+					T leftCost[binCount - 1];
+					Box acc;
+					acc.clear();
+					uint32_t n = 0;
+					for (int s = 0; s < binCount - 1; ++s)
+					{
+						acc.grow(binBox[s]);
+						n += binPrimitives[s];
+						leftCost[s] = n ? acc.halfArea() * (T)n : (T)0;
+					}
+					acc.clear();
+					n = 0;
+					int split = -1;
+					T bestCost = std::numeric_limits<T>::max();
+					for (int s = binCount - 2; s >= 0; --s)
+					{
+						acc.grow(binBox[s + 1]);
+						n += binPrimitives[s + 1];
+						if (n == 0 || n == count)
+							continue;
+						T cost = leftCost[s] + acc.halfArea() * (T)n;
+						if (cost < bestCost)
+						{
+							bestCost = cost;
+							split = s;
+						}
+					}
+
+					// a traversal step costs about as much as one primitive test
+					T area = box.halfArea();
+					if (count <= (uint32_t)maxLeafSize && (T)count * area <= area + bestCost)
+						return;
+					for (int c = 0; c < 2; ++c)
+					{
+						childBox[c].clear();
+						childCentroids[c].clear();
+					}
+					for (int b = 0; b < binCount; ++b)
+					{
+						childBox[b <= split ? 0 : 1].grow(binBox[b]);
+						childCentroids[b <= split ? 0 : 1].grow(binCentroids[b]);
+					}
+					middle = (uint32_t)(std::partition(refs + begin, refs + end, [&](const Reference& r) { return binOf(r) <= split; }) - refs);
+				}
+
+				uint32_t children = nodeCount.fetch_add(2);
+				node.first = children;
+				node.count = 0;
+				// threadsLeft counts the threads that may still start, a finished one gives its slot back
+				bool parallel = count > parallelSize && threadsLeft.fetch_sub(1) > 0;
+				if (parallel)
+				{
+					std::thread left([&] { build(children, begin, middle, depth + 1, childBox[0], childCentroids[0]); });
+					build(children + 1, middle, end, depth + 1, childBox[1], childCentroids[1]);
+					left.join();
+				}
+				else
+				{
+					build(children, begin, middle, depth + 1, childBox[0], childCentroids[0]);
+					build(children + 1, middle, end, depth + 1, childBox[1], childCentroids[1]);
+				}
+				if (count > parallelSize)
+					threadsLeft.fetch_add(1);
+			}
+		};
+	}
+
+	template<typename T>
+	inline void BVH<T>::build(const AABB<3, T>* bounds, size_t count, int maxLeafSize, unsigned threads)
+	{
+		nodes.clear();
+		indices.resize(count);
+		if (count == 0)
+			return;
+		nodes.resize(2 * count);
+
+		detail::BVHBuilder<T> builder;
+		std::vector<typename detail::BVHBuilder<T>::Reference> refs(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				refs[i].box.lo[c] = bounds[i].min[c];
+				refs[i].box.hi[c] = bounds[i].max[c];
+			}
+			refs[i].index = (uint32_t)i;
+		}
+		builder.refs = refs.data();
+		builder.nodes = nodes.data();
+		builder.maxLeafSize = maxLeafSize;
+		builder.nodeCount = 2;
+		builder.threadsLeft = (int)(threads ? threads : std::max(std::thread::hardware_concurrency(), 1u)) - 1;
+		typename detail::BVHBuilder<T>::Box box, centroids;
+		builder.rangeBounds(0, (uint32_t)count, box, centroids);
+		builder.build(0, 0, (uint32_t)count, 0, box, centroids);
+		nodes.resize(builder.nodeCount);
+		for (size_t i = 0; i < count; ++i)
+			indices[i] = refs[i].index;
+		// the unused slot only keeps the pair alignment, no query reaches it
+		nodes[1].bounds = AABB<3, T>::empty();
+		nodes[1].first = 0;
+		nodes[1].count = 0;
+	}
+
+	template<typename T>
+	inline void BVH<T>::refit(const AABB<3, T>* bounds)
+	{
+		for (size_t i = nodes.size(); i-- > 0;)
+		{
+			Node& node = nodes[i];
+			if (i == 1)
+				continue;
+			if (node.isLeaf())
+			{
+				AABB<3, T> box = AABB<3, T>::empty();
+				for (uint32_t k = node.first; k < node.first + node.count; ++k)
+					box = unite(box, bounds[indices[k]]);
+				node.bounds = box;
+			}
+			else
+				node.bounds = unite(nodes[node.first].bounds, nodes[node.first + 1].bounds);
+		}
+	}
+
+	template<typename T>
+	template<typename F>
+	inline bool BVH<T>::intersect(const Ray<T>& ray, T& tMax, F f, RayEntry* stack) const
+	{
+		if (nodes.empty())
+			return false;
+		Vec<3, T> invDirection = (T)1 / ray.direction;
+		T tNear;
+		if (!intersectSlabs(ray.origin, invDirection, nodes[0].bounds, tMax, tNear))
+			return false;
+
+		int top = 0;
+		uint32_t current = 0;
+		bool hit = false;
+		for (;;)
+		{
+			const Node& node = nodes[current];
+			if (node.isLeaf())
+			{
+				for (uint32_t k = node.first; k < node.first + node.count; ++k)
+					hit |= f(indices[k], tMax);
+			}
+			else
+			{
+				T tLeft, tRight;
+				bool left = intersectSlabs(ray.origin, invDirection, nodes[node.first].bounds, tMax, tLeft);
+				bool right = intersectSlabs(ray.origin, invDirection, nodes[node.first + 1].bounds, tMax, tRight);
+				if (left && right)
+				{
+					// nearer child first, the other one waits with its entry distance
+					bool swap = tRight < tLeft;
+					current = node.first + (swap ? 1 : 0);
+					stack[top++] = RayEntry{ node.first + (swap ? 0 : 1), swap ? tLeft : tRight };
+					continue;
+				}
+				if (left || right)
+				{
+					current = node.first + (left ? 0 : 1);
+					continue;
+				}
+			}
+			// skip entries a closer hit has since ruled out
+			do
+			{
+				if (top == 0)
+					return hit;
+				--top;
+			} while (stack[top].tNear > tMax);
+			current = stack[top].node;
+		}
+	}
+
+	template<typename T>
+	template<typename F>
+	inline void BVH<T>::overlap(const AABB<3, T>& box, F f, uint32_t* stack) const
+	{
+		if (nodes.empty() || !nodes[0].bounds.intersects(box))
+			return;
+		int top = 0;
+		uint32_t current = 0;
+		for (;;)
+		{
+			const Node& node = nodes[current];
+			if (node.isLeaf())
+			{
+				for (uint32_t k = node.first; k < node.first + node.count; ++k)
+					f(indices[k]);
+			}
+			else
+			{
+				bool left = nodes[node.first].bounds.intersects(box);
+				bool right = nodes[node.first + 1].bounds.intersects(box);
+				if (left || right)
+				{
+					current = node.first + (left ? 0 : 1);
+					if (left && right)
+						stack[top++] = node.first + 1;
+					continue;
+				}
+			}
+			if (top == 0)
+				return;
+			current = stack[--top];
+		}
+	}
+
+	namespace detail
+	{
+		template<typename T>
+		inline bool overlapsSphere(const AABB<3, T>& box, const Vec<3, T>& center, T radiusSquared)
+		{
+			T d = 0;
+			for (int i = 0; i < 3; ++i)
+			{
+				T v = center[i] < box.min[i] ? box.min[i] - center[i] : (center[i] > box.max[i] ? center[i] - box.max[i] : (T)0);
+				d += v * v;
+			}
+			return d <= radiusSquared;
+		}
+	}
+
+	template<typename T>
+	template<typename F>
+	inline void BVH<T>::overlap(const Vec<3, T>& center, T radius, F f, uint32_t* stack) const
+	{
+		T r2 = radius * radius;
+		if (nodes.empty() || !detail::overlapsSphere(nodes[0].bounds, center, r2))
+			return;
+		int top = 0;
+		uint32_t current = 0;
+		for (;;)
+		{
+			const Node& node = nodes[current];
+			if (node.isLeaf())
+			{
+				for (uint32_t k = node.first; k < node.first + node.count; ++k)
+					f(indices[k]);
+			}
+			else
+			{
+				bool left = detail::overlapsSphere(nodes[node.first].bounds, center, r2);
+				bool right = detail::overlapsSphere(nodes[node.first + 1].bounds, center, r2);
+				if (left || right)
+				{
+					current = node.first + (left ? 0 : 1);
+					if (left && right)
+						stack[top++] = node.first + 1;
+					continue;
+				}
+			}
+			if (top == 0)
+				return;
+			current = stack[--top];
+		}
+	}
+}
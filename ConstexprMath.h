@@ -0,0 +1,219 @@
+#pragma once
+#include <cmath>
+#include <limits>
+#include "SIMD.h"
+
+namespace gm
+{
+	// <cmath> functions that also work in constant expressions.
+	// At run time they are the std:: functions, during constant evaluation they are evaluated in long double
+	// by argument reduction and a series, which rounds to within 1 ulp of std:: for float and double.
+	// sin, cos and tan reduce by pi / 2 in long double, so keep their arguments below about 1e6.
+	namespace cx
+	{
+		namespace detail
+		{
+			typedef long double W;
+			constexpr W pi = 3.141592653589793238462643383279502884L;
+
+			constexpr W sqrt(W x)
+			{
+				if (!(x > 0) || x > std::numeric_limits<W>::max())
+					return x == 0 || x > 0 ? x : std::numeric_limits<W>::quiet_NaN();
+				W scale = 1;
+				while (x >= 18446744073709551616.0L)
+				{
+					x *= 5.42101086242752217003726400434970855712890625e-20L;
+					scale *= 4294967296.0L;
+				}
+				while (x < 5.42101086242752217003726400434970855712890625e-20L)
+				{
+					x *= 18446744073709551616.0L;
+					scale *= 2.3283064365386962890625e-10L;
+				}
+				while (x >= 4)
+				{
+					x *= 0.25L;
+					scale *= 2;
+				}
+				while (x < 1)
+				{
+					x *= 4;
+					scale *= 0.5L;
+				}
+				W y = (x + 1) * 0.5L;
+				for (int i = 0; i < 6; ++i)
+					y = (y + x / y) * 0.5L;
+				return y * scale;
+			}
+
+			// sin (odd) or cos (!odd) of |r| <= pi / 4
+			constexpr W series(W r, bool odd)
+			{
+				W r2 = r * r;
+				W term = odd ? r : 1;
+				W sum = term;
+				for (int n = odd ? 2 : 1; n < 40; n += 2)
+				{
+					term *= -r2 / (W)(n * (n + 1));
+					if (sum + term == sum)
+						break;
+					sum += term;
+				}
+				return sum;
+			}
+
+			// quadrant k and remainder r with x = k * pi / 2 + r
+			constexpr W reduce(W x, long long& k)
+			{
+				k = (long long)(x * (2 / pi) + (x < 0 ? -0.5L : 0.5L));
+				return x - (W)k * (pi / 2);
+			}
+
+			constexpr W sin(W x)
+			{
+				long long k = 0;
+				W r = reduce(x, k);
+				W s = series(r, (k & 1) == 0);
+				return (k & 2) ? -s : s;
+			}
+
+			constexpr W cos(W x)
+			{
+				long long k = 0;
+				W r = reduce(x, k);
+				W c = series(r, (k & 1) != 0);
+				return ((k + 1) & 2) ? -c : c;
+			}
+
+			// both from one reduction, the quadrant picks the series and the signs
+			constexpr void sincos(W x, W& s, W& c)
+			{
+				long long k = 0;
+				W r = reduce(x, k);
+				W sr = series(r, true), cr = series(r, false);
+				s = (k & 1) ? cr : sr;
+				c = (k & 1) ? sr : cr;
+				s = (k & 2) ? -s : s;
+				c = ((k + 1) & 2) ? -c : c;
+			}
+
+			constexpr W atan(W x)
+			{
+				if (x < 0)
+					return -atan(-x);
+				if (x > 1)
+					return pi / 2 - atan(1 / x);
+				const W sqrt3 = 1.732050807568877293527446341505872367L;
+				W offset = 0;
+				if (x > 2 - sqrt3)
+				{
+					x = (x * sqrt3 - 1) / (sqrt3 + x);
+					offset = pi / 6;
+				}
+				W x2 = x * x;
+				W term = x;
+				W sum = x;
+				for (int n = 3; n < 80; n += 2)
+				{
+					term *= -x2;
+					W add = term / (W)n;
+					if (sum + add == sum)
+						break;
+					sum += add;
+				}
+				return offset + sum;
+			}
+
+			constexpr W acos(W x)
+			{
+				if (x < -1 || x > 1)
+					return std::numeric_limits<W>::quiet_NaN();
+				if (x == -1)
+					return pi;
+				// acos(x) = 2 * atan(sqrt((1 - x) / (1 + x)))
+				return 2 * atan(sqrt((1 - x) / (1 + x)));
+			}
+		}
+
+		template<typename T>
+		constexpr T abs(T x)
+		{
+			if (GM_IS_CONSTANT_EVALUATED())
+				return x == 0 ? (T)0 : x < 0 ? -x : x;
+			return std::abs(x);
+		}
+
+		template<typename T>
+		constexpr T sqrt(T x)
+		{
+			if (GM_IS_CONSTANT_EVALUATED())
+				return (T)detail::sqrt(x);
+			return std::sqrt(x);
+		}
+
+		template<typename T>
+		constexpr T sin(T x)
+		{
+			if (GM_IS_CONSTANT_EVALUATED())
+				return (T)detail::sin(x);
+			return std::sin(x);
+		}
+
+		template<typename T>
+		constexpr T cos(T x)
+		{
+			if (GM_IS_CONSTANT_EVALUATED())
+				return (T)detail::cos(x);
+			return std::cos(x);
+		}
+
+		// at run time GCC and Clang merge the std::sin / std::cos pair into one sincos call
+		template<typename T>
+		constexpr void sincos(T x, T& s, T& c)
+		{
+			if (GM_IS_CONSTANT_EVALUATED())
+			{
+				detail::W ws = 0, wc = 0;
+				detail::sincos(x, ws, wc);
+				s = (T)ws;
+				c = (T)wc;
+				return;
+			}
+			s = std::sin(x);
+			c = std::cos(x);
+		}
+
+		template<typename T>
+		constexpr T tan(T x)
+		{
+			if (GM_IS_CONSTANT_EVALUATED())
+				return (T)(detail::sin(x) / detail::cos(x));
+			return std::tan(x);
+		}
+
+		template<typename T>
+		constexpr T acos(T x)
+		{
+			if (GM_IS_CONSTANT_EVALUATED())
+				return (T)detail::acos(x);
+			return std::acos(x);
+		}
+
+		template<typename T>
+		constexpr T fmin(T a, T b)
+		{
+			if (GM_IS_CONSTANT_EVALUATED())
+				return b < a || a != a ? b : a;
+			return std::fmin(a, b);
+		}
+
+		template<typename T>
+		constexpr T fmax(T a, T b)
+		{
+			if (GM_IS_CONSTANT_EVALUATED())
+				return a < b || a != a ? b : a;
+			return std::fmax(a, b);
+		}
+	}
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <cstddef>
+#include "Vectors.h"
+#include "Quaternion.h"
+#include "ConstexprMath.h"
+
+namespace gm
+{
+	// Unit dual quaternion real + eps * dual for rigid transforms, 32 bytes for float against 64 for a Mat<4, 4>.
+	// real is the rotation, dual = 0.5 * (translation, 0) * real. a * b applies b first, like matrices,
+	// inverse() is the conjugate of a unit dual quaternion. As a matrix: translate(rotation(dq.real), dq.translation()).
+	//
+	// dlb(dqs, weights, count) is dual quaternion linear blending: the weighted sum, with every dual quaternion
+	// flipped into the hemisphere of the first one, normalized. sclerp(a, b, t) interpolates along the screw
+	// motion from a to b at constant speed, dlb of two is close to it for small differences and much cheaper.
+	template<typename T>
+	struct DualQuat
+	{
+		Quat<T> real;
+		Quat<T> dual;
+
+		static const DualQuat identity;
+
+		constexpr DualQuat() = default;
+		constexpr DualQuat(const Quat<T>& real, const Quat<T>& dual) : real(real), dual(dual) {}
+		constexpr DualQuat(const Quat<T>& rotation, const Vec<3, T>& translation)
+			: real(rotation), dual(Quat<T>(translation[0] * (T)0.5, translation[1] * (T)0.5, translation[2] * (T)0.5, (T)0) * rotation) {}
+
+		constexpr Quat<T> rotation() const { return real; }
+
+		// 2 * dual * conjugate(real)
+		constexpr Vec<3, T> translation() const
+		{
+			const T _2 = 2;
+			return Vec<3, T>(
+				_2 * (real.w * dual.x - dual.w * real.x + real.y * dual.z - real.z * dual.y),
+				_2 * (real.w * dual.y - dual.w * real.y + real.z * dual.x - real.x * dual.z),
+				_2 * (real.w * dual.z - dual.w * real.z + real.x * dual.y - real.y * dual.x));
+		}
+	};
+
+	template<typename T>
+	const DualQuat<T> DualQuat<T>::identity(Quat<T>(0, 0, 0, 1), Quat<T>(0, 0, 0, 0));
+
+	template<typename T>
+	inline constexpr DualQuat<T> operator*(const DualQuat<T>& a, const DualQuat<T>& b)
+	{
+		return DualQuat<T>(a.real * b.real, a.real * b.dual + a.dual * b.real);
+	}
+	template<typename T>
+	inline constexpr DualQuat<T> & operator *= (DualQuat<T>& a, const DualQuat<T>& b)
+	{
+		return a = a * b;
+	}
+
+	template<typename T>
+	inline constexpr DualQuat<T> operator*(const DualQuat<T>& a, const T& b)
+	{
+		return DualQuat<T>(a.real * b, a.dual * b);
+	}
+	template<typename T>
+	inline constexpr DualQuat<T> operator*(const T& a, const DualQuat<T>& b)
+	{
+		return DualQuat<T>(b.real * a, b.dual * a);
+	}
+
+	template<typename T>
+	inline constexpr DualQuat<T> operator+(const DualQuat<T>& a, const DualQuat<T>& b)
+	{
+		return DualQuat<T>(a.real + b.real, a.dual + b.dual);
+	}
+	template<typename T>
+	inline constexpr DualQuat<T> & operator += (DualQuat<T>& a, const DualQuat<T>& b)
+	{
+		a.real += b.real;
+		a.dual += b.dual;
+		return a;
+	}
+
+	template<typename T>
+	inline constexpr DualQuat<T> inverse(const DualQuat<T>& dq)
+	{
+		return DualQuat<T>(inverse(dq.real), inverse(dq.dual));
+	}
+
+	// unit length real part, dual made orthogonal to it
+	template<typename T>
+	inline constexpr DualQuat<T> normalize(const DualQuat<T>& dq)
+	{
+		const Quat<T>& r = dq.real;
+		T invLength = (T)1 / cx::sqrt(r.x * r.x + r.y * r.y + r.z * r.z + r.w * r.w);
+		Quat<T> real = r * invLength, dual = dq.dual * invLength;
+		T d = real.x * dual.x + real.y * dual.y + real.z * dual.z + real.w * dual.w;
+		return DualQuat<T>(real, dual - real * d);
+	}
+
+	template<typename T>
+	inline constexpr Vec<3, T> transformPoint(const DualQuat<T>& dq, const Vec<3, T>& p)
+	{
+		return dq.real * p + dq.translation();
+	}
+
+	template<typename T>
+	inline constexpr Vec<3, T> transformVector(const DualQuat<T>& dq, const Vec<3, T>& v)
+	{
+		return dq.real * v;
+	}
+
+	template<typename T>
+	inline constexpr DualQuat<T> dlb(const DualQuat<T>* dqs, const T* weights, size_t count)
+	{
+		const Quat<T>& pivot = dqs[0].real;
+		DualQuat<T> y(Quat<T>(0, 0, 0, 0), Quat<T>(0, 0, 0, 0));
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Quat<T>& r = dqs[i].real;
+			T w = pivot.x * r.x + pivot.y * r.y + pivot.z * r.z + pivot.w * r.w < 0 ? -weights[i] : weights[i];
+			y += dqs[i] * w;
+		}
+		return normalize(y);
+	}
+
+	namespace detail
+	{
+		// dq^t of a unit dual quaternion from its screw parameters: angle, axis l, pitch and moment m
+		template<typename T>
+		inline constexpr DualQuat<T> screwPow(const DualQuat<T>& dq, T t)
+		{
+			const Quat<T>& r = dq.real;
+			const Quat<T>& d = dq.dual;
+			T s = cx::sqrt(r.x * r.x + r.y * r.y + r.z * r.z);
+			// no rotation, the translation scales linearly
+			if (s < (T)1e-6)
+				return DualQuat<T>(Quat<T>(0, 0, 0, 1), Quat<T>(d.x * t, d.y * t, d.z * t, (T)0));
+
+			T invS = (T)1 / s;
+			Vec<3, T> l(r.x * invS, r.y * invS, r.z * invS);
+			T halfAngle = cx::acos(cx::fmin(r.w, (T)1));
+			T halfPitch = -d.w * invS;
+			Vec<3, T> m((d.x - l[0] * halfPitch * r.w) * invS, (d.y - l[1] * halfPitch * r.w) * invS, (d.z - l[2] * halfPitch * r.w) * invS);
+
+			halfAngle *= t;
+			halfPitch *= t;
+			T sinA = cx::sin(halfAngle), cosA = cx::cos(halfAngle);
+			return DualQuat<T>(
+				Quat<T>(l[0] * sinA, l[1] * sinA, l[2] * sinA, cosA),
+				Quat<T>(
+					l[0] * halfPitch * cosA + m[0] * sinA,
+					l[1] * halfPitch * cosA + m[1] * sinA,
+					l[2] * halfPitch * cosA + m[2] * sinA,
+					-halfPitch * sinA));
+		}
+	}
+
+	template<typename T>
+	inline constexpr DualQuat<T> sclerp(const DualQuat<T>& a, const DualQuat<T>& b, T t)
+	{
+		DualQuat<T> d = inverse(a) * b;
+		// shortest path
+		if (d.real.w < 0)
+			d = d * (T)-1;
+		return a * detail::screwPow(d, t);
+	}
+}
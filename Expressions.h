@@ -0,0 +1,285 @@
+#pragma once
+#include <cmath>
+#include <type_traits>
+#include "Vectors.h"
+#include "Matrices.h"
+#include "Pack.h"
+
+namespace gm
+{
+	// Opt-in lazy element-wise arithmetic on Vec<L, T> and Mat<R, C, T>.
+	// lazy(x) wraps an operand, +, -, * and / on it build an expression instead of a temporary,
+	// and converting to the Vec / Mat type evaluates the whole chain in one simd::Pack loop:
+	//   Mat<12, 12, float> y = lazy(a) * s + lazy(b) * t - c;
+	// An operator is lazy when one of its operands is, b * t alone would still build a temporary.
+	// a * b + c, a * b - c and c - a * b are fused into one madd / nmadd.
+	// Mat * Mat stays the matrix product and is not lazy, Mat expressions only multiply by scalars.
+	// Every element only depends on the same element of the operands, so the target may appear in the expression.
+	// Operands are held by reference: evaluate before the end of the statement, do not keep expressions in auto.
+	namespace expr
+	{
+		template<typename X>
+		struct Shape;
+
+		template<int L, typename T>
+		struct Shape<Vec<L, T>>
+		{
+			typedef T Scalar;
+			static const int size = L;
+			static const bool elementwiseMul = true;
+		};
+
+		template<int R, int C, typename T>
+		struct Shape<Mat<R, C, T>>
+		{
+			typedef T Scalar;
+			static const int size = R * C;
+			static const bool elementwiseMul = false;
+		};
+
+		// Scalar tail of the fused ops, packs pick simd::madd / simd::nmadd through ADL
+		template<typename T>
+		inline T madd(const T& a, const T& b, const T& c) { return a * b + c; }
+		template<typename T>
+		inline T nmadd(const T& a, const T& b, const T& c) { return c - a * b; }
+	#if defined(GM_SIMD_FMA)
+		inline float madd(const float& a, const float& b, const float& c) { return std::fma(a, b, c); }
+		inline double madd(const double& a, const double& b, const double& c) { return std::fma(a, b, c); }
+		inline float nmadd(const float& a, const float& b, const float& c) { return std::fma(-a, b, c); }
+		inline double nmadd(const double& a, const double& b, const double& c) { return std::fma(-a, b, c); }
+	#endif
+
+		template<typename E>
+		struct Expr;
+
+		template<typename E>
+		inline void assign(typename E::Result& y, const Expr<E>& e);
+
+		// Base of every node, E provides Result, Scalar, at(i) and pack(i)
+		template<typename E>
+		struct Expr
+		{
+			inline const E& self() const { return static_cast<const E&>(*this); }
+
+			template<typename R, typename E2 = E, IF<std::is_same<R, typename E2::Result>::value> = 0>
+			inline operator R() const
+			{
+				R y;
+				assign(y, *this);
+				return y;
+			}
+		};
+
+		template<typename R>
+		struct Terminal : Expr<Terminal<R>>
+		{
+			typedef R Result;
+			typedef typename Shape<R>::Scalar Scalar;
+			const Scalar* p;
+
+			inline explicit Terminal(const R& x) : p(&x[0]) {}
+			inline Scalar at(int i) const { return p[i]; }
+			inline simd::Pack<Scalar> pack(int i) const { return simd::Pack<Scalar>::loadu(p + i); }
+		};
+
+		template<typename R>
+		struct Constant : Expr<Constant<R>>
+		{
+			typedef R Result;
+			typedef typename Shape<R>::Scalar Scalar;
+			Scalar v;
+
+			inline explicit Constant(const Scalar& x) : v(x) {}
+			inline Scalar at(int) const { return v; }
+			inline simd::Pack<Scalar> pack(int) const { return simd::Pack<Scalar>(v); }
+		};
+
+		struct Add { template<typename V> static inline V apply(const V& a, const V& b) { return a + b; } };
+		struct Sub { template<typename V> static inline V apply(const V& a, const V& b) { return a - b; } };
+		struct Mul { template<typename V> static inline V apply(const V& a, const V& b) { return a * b; } };
+		struct Div { template<typename V> static inline V apply(const V& a, const V& b) { return a / b; } };
+
+		template<typename Op, typename A, typename B>
+		struct Binary;
+
+		// Evaluates Op(a, b), specializations contract a product with the add or subtract around it
+		template<typename Op, typename A, typename B>
+		struct Fuse
+		{
+			static inline typename A::Scalar at(const A& a, const B& b, int i) { return Op::apply(a.at(i), b.at(i)); }
+			static inline simd::Pack<typename A::Scalar> pack(const A& a, const B& b, int i) { return Op::apply(a.pack(i), b.pack(i)); }
+		};
+
+		template<typename A0, typename A1, typename B>
+		struct Fuse<Add, Binary<Mul, A0, A1>, B>
+		{
+			typedef Binary<Mul, A0, A1> A;
+			static inline typename A::Scalar at(const A& a, const B& b, int i) { return madd(a.a.at(i), a.b.at(i), b.at(i)); }
+			static inline simd::Pack<typename A::Scalar> pack(const A& a, const B& b, int i) { return madd(a.a.pack(i), a.b.pack(i), b.pack(i)); }
+		};
+
+		template<typename A, typename B0, typename B1>
+		struct Fuse<Add, A, Binary<Mul, B0, B1>>
+		{
+			typedef Binary<Mul, B0, B1> B;
+			static inline typename A::Scalar at(const A& a, const B& b, int i) { return madd(b.a.at(i), b.b.at(i), a.at(i)); }
+			static inline simd::Pack<typename A::Scalar> pack(const A& a, const B& b, int i) { return madd(b.a.pack(i), b.b.pack(i), a.pack(i)); }
+		};
+
+		template<typename A0, typename A1, typename B0, typename B1>
+		struct Fuse<Add, Binary<Mul, A0, A1>, Binary<Mul, B0, B1>>
+		{
+			typedef Binary<Mul, A0, A1> A;
+			typedef Binary<Mul, B0, B1> B;
+			static inline typename A::Scalar at(const A& a, const B& b, int i) { return madd(a.a.at(i), a.b.at(i), b.at(i)); }
+			static inline simd::Pack<typename A::Scalar> pack(const A& a, const B& b, int i) { return madd(a.a.pack(i), a.b.pack(i), b.pack(i)); }
+		};
+
+		template<typename A0, typename A1, typename B>
+		struct Fuse<Sub, Binary<Mul, A0, A1>, B>
+		{
+			typedef Binary<Mul, A0, A1> A;
+			static inline typename A::Scalar at(const A& a, const B& b, int i) { return madd(a.a.at(i), a.b.at(i), -b.at(i)); }
+			static inline simd::Pack<typename A::Scalar> pack(const A& a, const B& b, int i) { return madd(a.a.pack(i), a.b.pack(i), -b.pack(i)); }
+		};
+
+		template<typename A, typename B0, typename B1>
+		struct Fuse<Sub, A, Binary<Mul, B0, B1>>
+		{
+			typedef Binary<Mul, B0, B1> B;
+			static inline typename A::Scalar at(const A& a, const B& b, int i) { return nmadd(b.a.at(i), b.b.at(i), a.at(i)); }
+			static inline simd::Pack<typename A::Scalar> pack(const A& a, const B& b, int i) { return nmadd(b.a.pack(i), b.b.pack(i), a.pack(i)); }
+		};
+
+		template<typename A0, typename A1, typename B0, typename B1>
+		struct Fuse<Sub, Binary<Mul, A0, A1>, Binary<Mul, B0, B1>>
+		{
+			typedef Binary<Mul, A0, A1> A;
+			typedef Binary<Mul, B0, B1> B;
+			static inline typename A::Scalar at(const A& a, const B& b, int i) { return nmadd(b.a.at(i), b.b.at(i), a.at(i)); }
+			static inline simd::Pack<typename A::Scalar> pack(const A& a, const B& b, int i) { return nmadd(b.a.pack(i), b.b.pack(i), a.pack(i)); }
+		};
+
+		template<typename Op, typename A, typename B>
+		struct Binary : Expr<Binary<Op, A, B>>
+		{
+			static_assert(std::is_same<typename A::Result, typename B::Result>::value, "operands of a lazy expression must have the same type");
+			typedef typename A::Result Result;
+			typedef typename A::Scalar Scalar;
+			A a;
+			B b;
+
+			inline Binary(const A& a, const B& b) : a(a), b(b) {}
+			inline Scalar at(int i) const { return Fuse<Op, A, B>::at(a, b, i); }
+			inline simd::Pack<Scalar> pack(int i) const { return Fuse<Op, A, B>::pack(a, b, i); }
+		};
+
+		template<typename A>
+		struct Negate : Expr<Negate<A>>
+		{
+			typedef typename A::Result Result;
+			typedef typename A::Scalar Scalar;
+			A a;
+
+			inline explicit Negate(const A& a) : a(a) {}
+			inline Scalar at(int i) const { return -a.at(i); }
+			inline simd::Pack<Scalar> pack(int i) const { return -a.pack(i); }
+		};
+
+		template<typename E>
+		inline void assign(typename E::Result& y, const Expr<E>& expr)
+		{
+			typedef typename E::Scalar T;
+			typedef simd::Pack<T> P;
+			const int n = Shape<typename E::Result>::size;
+			const E& e = expr.self();
+			T* out = &y[0];
+			int i = 0;
+			for (; i + P::size <= n; i += P::size)
+				e.pack(i).storeu(out + i);
+			for (; i < n; ++i)
+				out[i] = e.at(i);
+		}
+
+		template<typename E>
+		inline typename E::Result eval(const Expr<E>& e)
+		{
+			typename E::Result y;
+			assign(y, e);
+			return y;
+		}
+
+		template<typename E>
+		inline Negate<E> operator-(const Expr<E>& a)
+		{
+			return Negate<E>(a.self());
+		}
+
+		template<typename A, typename B>
+		using AnyShape = IF<true>;
+		template<typename A, typename B>
+		using ElementwiseMul = IF<Shape<typename A::Result>::elementwiseMul && Shape<typename B::Result>::elementwiseMul>;
+
+#define OVERLOAD_OP_EXPR(op, Op, Cond)																							\
+		template<typename A, typename B, Cond<A, B> = 0>																		\
+		inline Binary<Op, A, B> operator op (const Expr<A>& a, const Expr<B>& b)												\
+		{																														\
+			return Binary<Op, A, B>(a.self(), b.self());																		\
+		}																														\
+		template<typename A, typename R = typename A::Result, Cond<A, Terminal<R>> = 0>											\
+		inline Binary<Op, A, Terminal<R>> operator op (const Expr<A>& a, const typename A::Result& b)							\
+		{																														\
+			return Binary<Op, A, Terminal<R>>(a.self(), Terminal<R>(b));														\
+		}																														\
+		template<typename B, typename R = typename B::Result, Cond<Terminal<R>, B> = 0>											\
+		inline Binary<Op, Terminal<R>, B> operator op (const typename B::Result& a, const Expr<B>& b)							\
+		{																														\
+			return Binary<Op, Terminal<R>, B>(Terminal<R>(a), b.self());														\
+		}																														\
+		template<typename A, typename R = typename A::Result>																	\
+		inline Binary<Op, A, Constant<R>> operator op (const Expr<A>& a, const typename A::Scalar& b)							\
+		{																														\
+			return Binary<Op, A, Constant<R>>(a.self(), Constant<R>(b));														\
+		}																														\
+		template<typename B, typename R = typename B::Result>																	\
+		inline Binary<Op, Constant<R>, B> operator op (const typename B::Scalar& a, const Expr<B>& b)							\
+		{																														\
+			return Binary<Op, Constant<R>, B>(Constant<R>(a), b.self());														\
+		}
+
+		OVERLOAD_OP_EXPR(+, Add, AnyShape)
+		OVERLOAD_OP_EXPR(-, Sub, AnyShape)
+		OVERLOAD_OP_EXPR(*, Mul, ElementwiseMul)
+		OVERLOAD_OP_EXPR(/, Div, AnyShape)
+#undef OVERLOAD_OP_EXPR
+
+		template<typename R, typename E, IF<std::is_same<R, typename E::Result>::value> = 0>
+		inline R& operator+=(R& y, const Expr<E>& e)
+		{
+			assign(y, Terminal<R>(y) + e);
+			return y;
+		}
+
+		template<typename R, typename E, IF<std::is_same<R, typename E::Result>::value> = 0>
+		inline R& operator-=(R& y, const Expr<E>& e)
+		{
+			assign(y, Terminal<R>(y) - e);
+			return y;
+		}
+
+		template<int L, typename T>
+		inline Terminal<Vec<L, T>> lazy(const Vec<L, T>& v)
+		{
+			return Terminal<Vec<L, T>>(v);
+		}
+
+		template<int R, int C, typename T>
+		inline Terminal<Mat<R, C, T>> lazy(const Mat<R, C, T>& m)
+		{
+			return Terminal<Mat<R, C, T>>(m);
+		}
+	}
+
+	using expr::lazy;
+	using expr::eval;
+}
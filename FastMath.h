@@ -0,0 +1,512 @@
+#pragma once
+#include <cmath>
+#include <limits>
+#include "Vectors.h"
+#include "VecArraySoA.h"
+#include "Pack.h"
+
+namespace gm
+{
+	// Vectorized approximations of <cmath> functions, evaluated a whole simd::Pack at a time.
+	// Every function accepts simd::Pack<T>, Vec<L, T>, VecArraySoA<L, T> and (const T* in, T* out, size_t count).
+	//
+	// Max error against libm in ULP of float / double, measured by bench/FastMathAccuracy.cpp over 4 seeds of 2^20 samples
+	// with FMA (the harness fails when an error exceeds these by more than 25%):
+	//   sin, cos, sincos   2 / 2    float |x| <= 4, double up to 2^20. Beyond |x| = 4 float is bounded in absolute error,
+	//                               1e-7 up to |x| <= 8192; near the zeros of sin and cos that is arbitrarily many ULP
+	//   exp, exp2          2 / 2    results below the normal range flush to 0
+	//   log, log2          2 / 3    log(0) = -inf, log(x < 0) = NaN
+	//   pow                8 / 11   x in [0.01, 100], |y| <= 9, 30 / 32 without FMA; x < 0 gives NaN
+	//   atan, atan2        4 / 2    atan2 treats -0 as +0
+	//   acos               4 / 3
+	namespace fast
+	{
+		namespace detail
+		{
+			template<typename T> struct Poly;
+
+			// Cephes single precision minimax polynomials.
+			template<>
+			struct Poly<float>
+			{
+				typedef simd::Pack<float> P;
+
+				static constexpr float pio2Hi = 1.5703125f;
+				static constexpr float pio2Mid = 4.837512969970703125e-4f;
+				static constexpr float pio2Lo = 7.54978995489188216e-8f;
+				static constexpr float ln2Hi = 0.693359375f;
+				static constexpr float ln2Lo = -2.12194440e-4f;
+				static constexpr float expMin = -87.3365447505f;
+				static constexpr float expMax = 88.7228391117f;
+				static constexpr float minNormal = 1.17549435e-38f;
+				static constexpr float denormScale = 33554432.0f;
+				static constexpr float denormExp = 25.0f;
+
+				// sin(r) and cos(r) for |r| <= pi / 4, z = r * r
+				static inline P sin(const P& r, const P& z)
+				{
+					P p = simd::madd(simd::madd(P(-1.9515295891e-4f), z, P(8.3321608736e-3f)), z, P(-1.6666654611e-1f));
+					return simd::madd(p * z, r, r);
+				}
+				static inline P cos(const P& z)
+				{
+					P p = simd::madd(simd::madd(P(2.443315711809948e-5f), z, P(-1.388731625493765e-3f)), z, P(4.166664568298827e-2f));
+					return simd::madd(p, z * z, simd::nmadd(P(0.5f), z, P(1.0f)));
+				}
+				// e^r for |r| <= ln2 / 2
+				static inline P exp(const P& r)
+				{
+					P p = simd::madd(P(1.9875691500e-4f), r, P(1.3981999507e-3f));
+					p = simd::madd(p, r, P(8.3334519073e-3f));
+					p = simd::madd(p, r, P(4.1665795894e-2f));
+					p = simd::madd(p, r, P(1.6666665459e-1f));
+					p = simd::madd(p, r, P(5.0000001201e-1f));
+					return simd::madd(p, r * r, r + P(1.0f));
+				}
+				// log(m) for m in [sqrt(0.5), sqrt(2)]
+				static inline P log(const P& m)
+				{
+					P f = m - P(1.0f);
+					P z = f * f;
+					P p = simd::madd(P(7.0376836292e-2f), f, P(-1.1514610310e-1f));
+					p = simd::madd(p, f, P(1.1676998740e-1f));
+					p = simd::madd(p, f, P(-1.2420140846e-1f));
+					p = simd::madd(p, f, P(1.4249322787e-1f));
+					p = simd::madd(p, f, P(-1.6668057665e-1f));
+					p = simd::madd(p, f, P(2.0000714765e-1f));
+					p = simd::madd(p, f, P(-2.4999993993e-1f));
+					p = simd::madd(p, f, P(3.3333331174e-1f));
+					return f + simd::nmadd(P(0.5f), z, p * z * f);
+				}
+				// atan(t) - t for |t| <= tan(pi / 8), z = t * t
+				static inline P atan(const P& t, const P& z)
+				{
+					P p = simd::madd(P(8.05374449538e-2f), z, P(-1.38776856032e-1f));
+					p = simd::madd(p, z, P(1.99777106478e-1f));
+					p = simd::madd(p, z, P(-3.33329491539e-1f));
+					return p * z * t;
+				}
+				static constexpr float atanSplit = 0.4142135623730950f;
+				static constexpr float atanMoreBits = 0.0f;
+			};
+
+			// Cephes double precision polynomials and Pade approximants,
+			// log uses the atanh series of (m - 1) / (m + 1).
+			template<>
+			struct Poly<double>
+			{
+				typedef simd::Pack<double> P;
+
+				static constexpr double pio2Hi = 1.57079625129699707031e0;
+				static constexpr double pio2Mid = 7.54978941586159635335e-8;
+				static constexpr double pio2Lo = 5.39030285815811905290e-15;
+				static constexpr double ln2Hi = 6.93147180369123816490e-1;
+				static constexpr double ln2Lo = 1.90821492927058770002e-10;
+				static constexpr double expMin = -708.396418532264106224;
+				static constexpr double expMax = 709.782712893383996843;
+				static constexpr double minNormal = 2.2250738585072014e-308;
+				static constexpr double denormScale = 18014398509481984.0;
+				static constexpr double denormExp = 54.0;
+
+				static inline P sin(const P& r, const P& z)
+				{
+					P p = simd::madd(P(1.58962301576546568060e-10), z, P(-2.50507477628578072866e-8));
+					p = simd::madd(p, z, P(2.75573136213857245213e-6));
+					p = simd::madd(p, z, P(-1.98412698295895385996e-4));
+					p = simd::madd(p, z, P(8.33333333332211858878e-3));
+					p = simd::madd(p, z, P(-1.66666666666666307295e-1));
+					return simd::madd(p * z, r, r);
+				}
+				static inline P cos(const P& z)
+				{
+					P p = simd::madd(P(-1.13585365213876817300e-11), z, P(2.08757008419747316778e-9));
+					p = simd::madd(p, z, P(-2.75573141792967388112e-7));
+					p = simd::madd(p, z, P(2.48015872888517045348e-5));
+					p = simd::madd(p, z, P(-1.38888888888730564116e-3));
+					p = simd::madd(p, z, P(4.16666666666665929218e-2));
+					return simd::madd(p, z * z, simd::nmadd(P(0.5), z, P(1.0)));
+				}
+				static inline P exp(const P& r)
+				{
+					P z = r * r;
+					P px = simd::madd(simd::madd(P(1.26177193074810590878e-4), z, P(3.02994407707441961300e-2)), z, P(9.99999999999999999910e-1)) * r;
+					P q = simd::madd(P(3.00198505138664455042e-6), z, P(2.52448340349684104192e-3));
+					q = simd::madd(q, z, P(2.27265548208155028766e-1));
+					q = simd::madd(q, z, P(2.00000000000000000009e0));
+					return simd::madd(P(2.0), px / (q - px), P(1.0));
+				}
+				static inline P log(const P& m)
+				{
+					P s = (m - P(1.0)) / (m + P(1.0));
+					P z = s * s;
+					P p(1.0 / 21);
+					const double c[] = {1.0 / 19, 1.0 / 17, 1.0 / 15, 1.0 / 13, 1.0 / 11, 1.0 / 9, 1.0 / 7, 1.0 / 5, 1.0 / 3};
+					for (double ci : c)
+						p = simd::madd(p, z, P(ci));
+					s += s;
+					return simd::madd(s * z, p, s);
+				}
+				static inline P atan(const P& t, const P& z)
+				{
+					P p = simd::madd(P(-8.750608600031904122785e-1), z, P(-1.615753718733365076637e1));
+					p = simd::madd(p, z, P(-7.500855792314704667340e1));
+					p = simd::madd(p, z, P(-1.228866684490136173410e2));
+					p = simd::madd(p, z, P(-6.485021904942025371773e1));
+					P q = z + P(2.485846490142306297962e1);
+					q = simd::madd(q, z, P(1.650270098316988542046e2));
+					q = simd::madd(q, z, P(4.328810604912902668951e2));
+					q = simd::madd(q, z, P(4.853903996359136964868e2));
+					q = simd::madd(q, z, P(1.945506571482613964425e2));
+					return p * z * t / q;
+				}
+				static constexpr double atanSplit = 0.66;
+				static constexpr double atanMoreBits = 6.123233995736765886130e-17;
+			};
+
+			// exp(r) * 2^n for r from the ln2 reduction, with out of range x mapped to 0 and inf
+			template<typename T>
+			inline simd::Pack<T> scaleExp(const simd::Pack<T>& x, const simd::Pack<T>& xMin, const simd::Pack<T>& xMax, const simd::Pack<T>& r, const simd::Pack<T>& n)
+			{
+				typedef simd::Pack<T> P;
+				// two steps keep 2^n normal for n up to the exponent bias + 1
+				P n1 = simd::floor(n * P((T)0.5));
+				P y = simd::ldexp(simd::ldexp(Poly<T>::exp(r), n1), n - n1);
+				y = simd::select(x < xMin, P((T)0), y);
+				y = simd::select(x > xMax, P(std::numeric_limits<T>::infinity()), y);
+				return simd::select(x != x, x, y);
+			}
+
+			// x = 2^e * m with m in [sqrt(0.5), sqrt(2)], returns log(m)
+			template<typename T>
+			inline simd::Pack<T> logReduce(const simd::Pack<T>& x, simd::Pack<T>& e)
+			{
+				typedef simd::Pack<T> P;
+				typename P::Mask tiny = x < P(Poly<T>::minNormal);
+				P a = simd::select(tiny, x * P(Poly<T>::denormScale), x);
+				e = simd::logb(a) - simd::select(tiny, P(Poly<T>::denormExp), P((T)0));
+				P m = simd::significand(a);
+				typename P::Mask big = m > P((T)1.41421356237309504880);
+				m = simd::select(big, m * P((T)0.5), m);
+				e = simd::select(big, e + P((T)1), e);
+				return Poly<T>::log(m);
+			}
+
+			template<typename T>
+			inline simd::Pack<T> logSpecial(const simd::Pack<T>& x, const simd::Pack<T>& y)
+			{
+				typedef simd::Pack<T> P;
+				P r = simd::select(x == P((T)0), P(-std::numeric_limits<T>::infinity()), y);
+				r = simd::select(x == P(std::numeric_limits<T>::infinity()), x, r);
+				return simd::select((x < P((T)0)) | (x != x), P(std::numeric_limits<T>::quiet_NaN()), r);
+			}
+		}
+
+
+		template<typename T>
+		inline void sincos(const simd::Pack<T>& x, simd::Pack<T>& s, simd::Pack<T>& c)
+		{
+			typedef simd::Pack<T> P;
+			typedef detail::Poly<T> C;
+			P j = simd::round(x * P((T)0.63661977236758134308));
+			P r = simd::nmadd(j, P(C::pio2Hi), x);
+			r = simd::nmadd(j, P(C::pio2Mid), r);
+			r = simd::nmadd(j, P(C::pio2Lo), r);
+			P z = r * r;
+			P sr = C::sin(r, z);
+			P cr = C::cos(z);
+
+			// quadrant j mod 4
+			P q = simd::nmadd(P((T)4), simd::floor(j * P((T)0.25)), j);
+			typename P::Mask odd = (q == P((T)1)) | (q == P((T)3));
+			s = simd::select(odd, cr, sr);
+			c = simd::select(odd, sr, cr);
+			s = simd::select(q >= P((T)2), -s, s);
+			c = simd::select((q == P((T)1)) | (q == P((T)2)), -c, c);
+		}
+
+		template<typename T>
+		inline simd::Pack<T> sin(const simd::Pack<T>& x)
+		{
+			simd::Pack<T> s, c;
+			sincos(x, s, c);
+			return s;
+		}
+
+		template<typename T>
+		inline simd::Pack<T> cos(const simd::Pack<T>& x)
+		{
+			simd::Pack<T> s, c;
+			sincos(x, s, c);
+			return c;
+		}
+
+		template<typename T>
+		inline simd::Pack<T> exp(const simd::Pack<T>& x)
+		{
+			typedef simd::Pack<T> P;
+			typedef detail::Poly<T> C;
+			P xMin(C::expMin), xMax(C::expMax);
+			P a = simd::min(simd::max(x, xMin), xMax);
+			P n = simd::round(a * P((T)1.44269504088896340736));
+			P r = simd::nmadd(n, P(C::ln2Hi), a);
+			r = simd::nmadd(n, P(C::ln2Lo), r);
+			return detail::scaleExp(x, xMin, xMax, r, n);
+		}
+
+		template<typename T>
+		inline simd::Pack<T> exp2(const simd::Pack<T>& x)
+		{
+			typedef simd::Pack<T> P;
+			P xMin((T)std::numeric_limits<T>::min_exponent - 1), xMax((T)std::numeric_limits<T>::max_exponent);
+			P a = simd::min(simd::max(x, xMin), xMax);
+			P n = simd::round(a);
+			P r = (a - n) * P((T)0.693147180559945309417);
+			return detail::scaleExp(x, xMin, xMax, r, n);
+		}
+
+		template<typename T>
+		inline simd::Pack<T> log(const simd::Pack<T>& x)
+		{
+			typedef simd::Pack<T> P;
+			typedef detail::Poly<T> C;
+			P e;
+			P lm = detail::logReduce(x, e);
+			return detail::logSpecial(x, simd::madd(e, P(C::ln2Hi), simd::madd(e, P(C::ln2Lo), lm)));
+		}
+
+		template<typename T>
+		inline simd::Pack<T> log2(const simd::Pack<T>& x)
+		{
+			typedef simd::Pack<T> P;
+			P e;
+			P lm = detail::logReduce(x, e);
+			return detail::logSpecial(x, simd::madd(lm, P((T)1.44269504088896340736), e));
+		}
+
+		template<typename T>
+		inline simd::Pack<T> pow(const simd::Pack<T>& x, const simd::Pack<T>& y)
+		{
+			typedef simd::Pack<T> P;
+			P e;
+			P lm = detail::logReduce(x, e);
+			// y * log2(x) = y * e + y * log2(m), y * e split into h + err (exact with FMA)
+			P h = y * e;
+			P err = simd::madd(y, e, -h);
+			P n = simd::round(h);
+			P f = simd::madd(y * lm, P((T)1.44269504088896340736), (h - n) + err);
+			P nf = simd::round(f);
+			P r = detail::scaleExp(h, P((T)std::numeric_limits<T>::min_exponent - 1), P((T)std::numeric_limits<T>::max_exponent),
+				(f - nf) * P((T)0.693147180559945309417), n + nf);
+
+			P inf(std::numeric_limits<T>::infinity());
+			r = simd::select(x == P((T)0), simd::select(y > P((T)0), P((T)0), inf), r);
+			r = simd::select(x == inf, simd::select(y > P((T)0), inf, P((T)0)), r);
+			r = simd::select((x < P((T)0)) | (x != x), P(std::numeric_limits<T>::quiet_NaN()), r);
+			return simd::select(y == P((T)0), P((T)1), r);
+		}
+
+		template<typename T>
+		inline simd::Pack<T> atan(const simd::Pack<T>& x)
+		{
+			typedef simd::Pack<T> P;
+			typedef detail::Poly<T> C;
+			P a = simd::abs(x);
+			typename P::Mask far = a > P((T)2.41421356237309504880);
+			typename P::Mask mid = a > P(C::atanSplit);
+			P t = simd::select(far, P((T)-1) / a, simd::select(mid, (a - P((T)1)) / (a + P((T)1)), a));
+			P base = simd::select(far, P((T)1.57079632679489661923), simd::select(mid, P((T)0.78539816339744830962), P((T)0)));
+			// low bits of pi / 2 and pi / 4 that do not fit into base
+			P low = simd::select(far, P(C::atanMoreBits), simd::select(mid, P((T)0.5 * C::atanMoreBits), P((T)0)));
+			P y = base + (t + (C::atan(t, t * t) + low));
+			return simd::select(x < P((T)0), -y, y);
+		}
+
+		template<typename T>
+		inline simd::Pack<T> atan2(const simd::Pack<T>& y, const simd::Pack<T>& x)
+		{
+			typedef simd::Pack<T> P;
+			P ax = simd::abs(x), ay = simd::abs(y);
+			P hi = simd::max(ax, ay);
+			P t = simd::select(hi == P((T)0), P((T)0), simd::min(ax, ay) / hi);
+			P r = atan(t);
+			r = simd::select(ay > ax, P((T)1.57079632679489661923) - r, r);
+			r = simd::select(x < P((T)0), P((T)3.14159265358979323846) - r, r);
+			return simd::select(y < P((T)0), -r, r);
+		}
+
+		template<typename T>
+		inline simd::Pack<T> acos(const simd::Pack<T>& x)
+		{
+			typedef simd::Pack<T> P;
+			return atan2(simd::sqrt((P((T)1) - x) * (P((T)1) + x)), x);
+		}
+
+
+#define FAST_UN_FUNC(name)																					\
+		template<int L, typename T, IsFloat<T> = true>														\
+		inline Vec<L, T> name(const Vec<L, T>& v)															\
+		{																									\
+			typedef simd::Pack<T> P;																		\
+			alignas(64) T t[(L + P::size - 1) / P::size * P::size] = {};									\
+			for (int i = 0; i < L; ++i)																		\
+				t[i] = v[i];																				\
+			for (int i = 0; i < L; i += P::size)															\
+				name(P::load(t + i)).store(t + i);															\
+			Vec<L, T> y;																					\
+			for (int i = 0; i < L; ++i)																		\
+				y[i] = t[i];																				\
+			return y;																						\
+		}																									\
+		template<typename T, IsFloat<T> = true>																\
+		inline void name(const T* in, T* out, size_t count)													\
+		{																									\
+			typedef simd::Pack<T> P;																		\
+			size_t i = 0;																					\
+			for (; i + P::size <= count; i += P::size)														\
+				name(P::loadu(in + i)).storeu(out + i);														\
+			if (i < count)																					\
+			{																								\
+				alignas(64) T t[P::size] = {};																\
+				for (size_t j = 0; j < count - i; ++j)														\
+					t[j] = in[i + j];																		\
+				name(P::load(t)).store(t);																	\
+				for (size_t j = 0; j < count - i; ++j)														\
+					out[i + j] = t[j];																		\
+			}																								\
+		}																									\
+		template<int L, typename T>																			\
+		inline VecArraySoA<L, T> name(const VecArraySoA<L, T>& a)											\
+		{																									\
+			VecArraySoA<L, T> y = VecArraySoA<L, T>::uninitialized(a.size());								\
+			for (int c = 0; c < L; ++c)																		\
+				name(a.stream(c), y.stream(c), a.stride());													\
+			return y;																						\
+		}
+
+#define FAST_BIN_FUNC(name)																					\
+		template<int L, typename T, IsFloat<T> = true>														\
+		inline Vec<L, T> name(const Vec<L, T>& a, const Vec<L, T>& b)										\
+		{																									\
+			typedef simd::Pack<T> P;																		\
+			alignas(64) T ta[(L + P::size - 1) / P::size * P::size] = {};									\
+			alignas(64) T tb[(L + P::size - 1) / P::size * P::size] = {};									\
+			for (int i = 0; i < L; ++i)																		\
+			{																								\
+				ta[i] = a[i];																				\
+				tb[i] = b[i];																				\
+			}																								\
+			for (int i = 0; i < L; i += P::size)															\
+				name(P::load(ta + i), P::load(tb + i)).store(ta + i);										\
+			Vec<L, T> y;																					\
+			for (int i = 0; i < L; ++i)																		\
+				y[i] = ta[i];																				\
+			return y;																						\
+		}																									\
+		template<typename T, IsFloat<T> = true>																\
+		inline void name(const T* a, const T* b, T* out, size_t count)										\
+		{																									\
+			typedef simd::Pack<T> P;																		\
+			size_t i = 0;																					\
+			for (; i + P::size <= count; i += P::size)														\
+				name(P::loadu(a + i), P::loadu(b + i)).storeu(out + i);										\
+			if (i < count)																					\
+			{																								\
+				alignas(64) T ta[P::size] = {}, tb[P::size] = {};											\
+				for (size_t j = 0; j < count - i; ++j)														\
+				{																							\
+					ta[j] = a[i + j];																		\
+					tb[j] = b[i + j];																		\
+				}																							\
+				name(P::load(ta), P::load(tb)).store(ta);													\
+				for (size_t j = 0; j < count - i; ++j)														\
+					out[i + j] = ta[j];																		\
+			}																								\
+		}																									\
+		template<int L, typename T>																			\
+		inline VecArraySoA<L, T> name(const VecArraySoA<L, T>& a, const VecArraySoA<L, T>& b)				\
+		{																									\
+			assert(a.size() == b.size());																	\
+			VecArraySoA<L, T> y = VecArraySoA<L, T>::uninitialized(a.size());								\
+			for (int c = 0; c < L; ++c)																		\
+				name(a.stream(c), b.stream(c), y.stream(c), a.stride());									\
+			return y;																						\
+		}
+
+		FAST_UN_FUNC(sin)
+		FAST_UN_FUNC(cos)
+		FAST_UN_FUNC(exp)
+		FAST_UN_FUNC(exp2)
+		FAST_UN_FUNC(log)
+		FAST_UN_FUNC(log2)
+		FAST_UN_FUNC(atan)
+		FAST_UN_FUNC(acos)
+
+		FAST_BIN_FUNC(pow)
+		FAST_BIN_FUNC(atan2)
+
+#undef FAST_UN_FUNC
+#undef FAST_BIN_FUNC
+
+
+		template<int L, typename T, IsFloat<T> = true>
+		inline void sincos(const Vec<L, T>& v, Vec<L, T>& s, Vec<L, T>& c)
+		{
+			typedef simd::Pack<T> P;
+			alignas(64) T ts[(L + P::size - 1) / P::size * P::size] = {};
+			alignas(64) T tc[(L + P::size - 1) / P::size * P::size];
+			for (int i = 0; i < L; ++i)
+				ts[i] = v[i];
+			for (int i = 0; i < L; i += P::size)
+			{
+				P ps, pc;
+				sincos(P::load(ts + i), ps, pc);
+				ps.store(ts + i);
+				pc.store(tc + i);
+			}
+			for (int i = 0; i < L; ++i)
+			{
+				s[i] = ts[i];
+				c[i] = tc[i];
+			}
+		}
+
+		template<typename T, IsFloat<T> = true>
+		inline void sincos(const T* in, T* s, T* c, size_t count)
+		{
+			typedef simd::Pack<T> P;
+			P ps, pc;
+			size_t i = 0;
+			for (; i + P::size <= count; i += P::size)
+			{
+				sincos(P::loadu(in + i), ps, pc);
+				ps.storeu(s + i);
+				pc.storeu(c + i);
+			}
+			if (i < count)
+			{
+				alignas(64) T ts[P::size] = {}, tc[P::size];
+				for (size_t j = 0; j < count - i; ++j)
+					ts[j] = in[i + j];
+				sincos(P::load(ts), ps, pc);
+				ps.store(ts);
+				pc.store(tc);
+				for (size_t j = 0; j < count - i; ++j)
+				{
+					s[i + j] = ts[j];
+					c[i + j] = tc[j];
+				}
+			}
+		}
+
+		template<int L, typename T>
+		inline void sincos(const VecArraySoA<L, T>& a, VecArraySoA<L, T>& s, VecArraySoA<L, T>& c)
+		{
+			if (s.size() != a.size())
+				s = VecArraySoA<L, T>::uninitialized(a.size());
+			if (c.size() != a.size())
+				c = VecArraySoA<L, T>::uninitialized(a.size());
+			for (int i = 0; i < L; ++i)
+				sincos(a.stream(i), s.stream(i), c.stream(i), a.stride());
+		}
+	}
+}
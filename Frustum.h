@@ -0,0 +1,173 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include "Matrices.h"
+#include "VecArraySoA.h"
+#include "Pack.h"
+
+namespace gm
+{
+	// View frustum as 6 normalized planes (n, d), a point p is inside a plane when dot(n, p) + d >= 0.
+	// Frustum(viewProjection) extracts them from the rows of any projection * view matrix (Gribb / Hartmann),
+	// in clip space -w <= x, y, z <= w. That is the depth range perspective() and ortho() map to for both
+	// rightHanded conventions, the handedness lives in the matrix, so one extraction serves both.
+	//
+	// Sphere and box tests are conservative: an object touching or crossing a plane counts as visible,
+	// boxes outside near a frustum corner may pass. The scalar tests sum d (+ r), x, y, z in the order of the
+	// batched kernels and fuse exactly when they do, so both agree bit for bit, unless the compiler fuses
+	// a * b + c on its own (GCC's default -ffp-contract=fast for an FMA target with GM_NO_SIMD).
+	//
+	// cullSpheres(frustum, spheres, visible) with spheres as VecArraySoA<4, T> (center xyz, radius w) and
+	// cullBoxes(frustum, min, max, visible) test one simd::Pack of objects per iteration against all 6 planes.
+	// Bit i % 32 of visible[i / 32] is set for visible objects, visible needs (size + 31) / 32 words.
+	namespace detail
+	{
+		// a * b + c, fused like simd::madd
+		template<typename T>
+		inline T planeMadd(T a, T b, T c)
+		{
+		#if defined(GM_SIMD_FMA)
+			return std::fma(a, b, c);
+		#else
+			return a * b + c;
+		#endif
+		}
+
+		// dot(n, p) + n[3] + offset, summed like the cull kernels
+		template<typename T>
+		inline T planeDistance(const Vec<4, T>& n, const Vec<3, T>& p, T offset)
+		{
+			return planeMadd(p[2], n[2], planeMadd(p[1], n[1], planeMadd(p[0], n[0], n[3] + offset)));
+		}
+	}
+
+	template<typename T>
+	struct Frustum
+	{
+		enum Plane
+		{
+			Left,
+			Right,
+			Bottom,
+			Top,
+			Near,
+			Far
+		};
+
+		Vec<4, T> planes[6];
+
+		inline Frustum() = default;
+		inline explicit Frustum(const Mat<4, 4, T>& viewProjection)
+		{
+			const Mat<4, 4, T>& m = viewProjection;
+			for (int i = 0; i < 6; ++i)
+			{
+				// row i / 2 of m added to the w row for the -w side, subtracted for the +w side
+				int r = i / 2;
+				T s = i % 2 ? (T)-1 : (T)1;
+				Vec<4, T> p(m[3] + s * m[r], m[7] + s * m[4 + r], m[11] + s * m[8 + r], m[15] + s * m[12 + r]);
+				planes[i] = p * ((T)1 / std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]));
+			}
+		}
+
+		inline T distance(Plane plane, const Vec<3, T>& p) const
+		{
+			return detail::planeDistance(planes[plane], p, (T)0);
+		}
+
+		inline bool contains(const Vec<3, T>& p) const
+		{
+			return intersectsSphere(p, (T)0);
+		}
+
+		inline bool intersectsSphere(const Vec<3, T>& center, T radius) const
+		{
+			for (int i = 0; i < 6; ++i)
+				if (!(detail::planeDistance(planes[i], center, radius) >= 0))
+					return false;
+			return true;
+		}
+
+		// tests the corner furthest along each plane normal
+		inline bool intersectsBox(const Vec<3, T>& min, const Vec<3, T>& max) const
+		{
+			for (int i = 0; i < 6; ++i)
+			{
+				const Vec<4, T>& n = planes[i];
+				Vec<3, T> p(n[0] >= 0 ? max[0] : min[0], n[1] >= 0 ? max[1] : min[1], n[2] >= 0 ? max[2] : min[2]);
+				if (!(distance((Plane)i, p) >= 0))
+					return false;
+			}
+			return true;
+		}
+	};
+
+	namespace detail
+	{
+		// ORs the lane bits of one Pack starting at object i into the bitmask, Pack<T>::size divides 32
+		template<typename T>
+		inline void setVisibleBits(uint32_t* visible, size_t i, unsigned bits)
+		{
+			if (i % 32 == 0)
+				visible[i / 32] = 0;
+			visible[i / 32] |= (uint32_t)bits << (i % 32);
+		}
+
+		// VecArraySoA pads to whole Packs, lanes past size are cleared
+		inline void clearPadding(uint32_t* visible, size_t size)
+		{
+			if (size % 32)
+				visible[size / 32] &= (1u << (size % 32)) - 1;
+		}
+	}
+
+	template<typename T>
+	inline void cullSpheres(const Frustum<T>& frustum, const VecArraySoA<4, T>& spheres, uint32_t* visible)
+	{
+		typedef simd::Pack<T> P;
+		static_assert(32 % P::size == 0, "bitmask words must hold whole Packs");
+		P n[6][4];
+		for (int p = 0; p < 6; ++p)
+			for (int c = 0; c < 4; ++c)
+				n[p][c] = P(frustum.planes[p][c]);
+
+		const T *x = spheres.stream(0), *y = spheres.stream(1), *z = spheres.stream(2), *r = spheres.stream(3);
+		for (size_t i = 0; i < spheres.stride(); i += P::size)
+		{
+			P cx = P::load(x + i), cy = P::load(y + i), cz = P::load(z + i), cr = P::load(r + i);
+			// dot(n, c) + d + r >= 0 for every plane
+			typename P::Mask inside = simd::madd(cz, n[0][2], simd::madd(cy, n[0][1], simd::madd(cx, n[0][0], n[0][3] + cr))) >= P((T)0);
+			for (int p = 1; p < 6; ++p)
+				inside = inside & (simd::madd(cz, n[p][2], simd::madd(cy, n[p][1], simd::madd(cx, n[p][0], n[p][3] + cr))) >= P((T)0));
+			detail::setVisibleBits<T>(visible, i, simd::bits(inside));
+		}
+		detail::clearPadding(visible, spheres.size());
+	}
+
+	template<typename T>
+	inline void cullBoxes(const Frustum<T>& frustum, const VecArraySoA<3, T>& min, const VecArraySoA<3, T>& max, uint32_t* visible)
+	{
+		typedef simd::Pack<T> P;
+		static_assert(32 % P::size == 0, "bitmask words must hold whole Packs");
+		P n[6][4];
+		// the corner furthest along each normal is chosen per plane, not per box
+		const T* corner[6][3];
+		for (int p = 0; p < 6; ++p)
+		{
+			for (int c = 0; c < 4; ++c)
+				n[p][c] = P(frustum.planes[p][c]);
+			for (int c = 0; c < 3; ++c)
+				corner[p][c] = frustum.planes[p][c] >= 0 ? max.stream(c) : min.stream(c);
+		}
+
+		for (size_t i = 0; i < min.stride(); i += P::size)
+		{
+			typename P::Mask inside = simd::madd(P::load(corner[0][2] + i), n[0][2], simd::madd(P::load(corner[0][1] + i), n[0][1], simd::madd(P::load(corner[0][0] + i), n[0][0], n[0][3]))) >= P((T)0);
+			for (int p = 1; p < 6; ++p)
+				inside = inside & (simd::madd(P::load(corner[p][2] + i), n[p][2], simd::madd(P::load(corner[p][1] + i), n[p][1], simd::madd(P::load(corner[p][0] + i), n[p][0], n[p][3]))) >= P((T)0));
+			detail::setVisibleBits<T>(visible, i, simd::bits(inside));
+		}
+		detail::clearPadding(visible, min.size());
+	}
+}
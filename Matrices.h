@@ -1,5 +1,7 @@
 #pragma once
 #include <ostream>
+#include <cstddef>
+#include <utility>
 #include "Vectors.h"
 #include "VectorGloabalFuncs.h"
 #include "Quaternion.h"
@@ -15,19 +17,19 @@ namespace gm
 			Vec<R, T> base_vecs[C];
 		};
 
-		T& operator[](int i)
+		constexpr T& operator[](int i)
 		{
-			return *((T*)this + i);
+			return values[i];
 		}
-		const T& operator[](int i) const
+		constexpr const T& operator[](int i) const
 		{
-			return *((T*)this + i);
+			return values[i];
 		}
 	};
 
 
 	template<int N, int R, int C, typename T>
-	inline Mat<R, C, T> operator * (const Mat<R, N, T> &a, const Mat<N, C, T> &b)
+	inline constexpr Mat<R, C, T> operator * (const Mat<R, N, T> &a, const Mat<N, C, T> &b)
 	{
 		Mat<R, C, T> y;
 		T dot;
@@ -45,7 +47,7 @@ namespace gm
 	}
 
 	template<int N, int R, typename T>
-	inline Vec<R, T> operator * (const Mat<R, N, T> &a, const Vec<N, T> &b)
+	inline constexpr Vec<R, T> operator * (const Mat<R, N, T> &a, const Vec<N, T> &b)
 	{
 		Vec<R, T> y;
 		T dot;
@@ -62,7 +64,7 @@ namespace gm
 	}
 
 	template<int N, int C, typename T>
-	inline Vec<C, T> operator * (const Vec<N, T> &a, const Mat<N, C, T> &b)
+	inline constexpr Vec<C, T> operator * (const Vec<N, T> &a, const Mat<N, C, T> &b)
 	{
 		Vec<C, T> y;
 		T dot;
@@ -92,63 +94,67 @@ namespace gm
 
 
 	template<typename T>
-	inline Mat<2, 2, T> rotation(const T &radians)
+	inline constexpr Mat<2, 2, T> rotation(const T &radians)
 	{
-		T sin = std::sin(radians), cos = std::cos(radians);
+		T sin, cos;
+		sincos(radians, sin, cos);
 		return {cos, sin, -sin, cos};
 	}
 
 	template<typename T>
-	inline Mat<3, 3, T> rotation(const Vec<3, T> &normal, const T &radians)
+	inline constexpr Mat<3, 3, T> rotation(const Vec<3, T> &normal, const T &radians)
 	{
-		T cos = std::cos(radians);
+		T sin, cos;
+		sincos(radians, sin, cos);
 		T omcos = (T)1 - cos;
 		Vec<3, T> omcosN = normal * omcos;
-		T Nxx = omcosN.x * normal.x;
-		T Nxy = omcosN.x * normal.y;
-		T Nxz = omcosN.x * normal.z;
-		T Nyy = omcosN.y * normal.y;
-		T Nyz = omcosN.y * normal.z;
-		T Nzz = omcosN.z * normal.z;
-		Vec<3, T> nSine = normal * std::sin(radians);
+		T Nxx = omcosN[0] * normal[0];
+		T Nxy = omcosN[0] * normal[1];
+		T Nxz = omcosN[0] * normal[2];
+		T Nyy = omcosN[1] * normal[1];
+		T Nyz = omcosN[1] * normal[2];
+		T Nzz = omcosN[2] * normal[2];
+		Vec<3, T> nSine = normal * sin;
 
 		return 
 		{
-			Nxx + cos, Nxy - nSine.z, Nxz + nSine.y,
-			Nxy + nSine.z, Nyy + cos, Nyz - nSine.x,
-			Nxz - nSine.y, Nyz + nSine.x, Nzz + cos,
+			Nxx + cos, Nxy - nSine[2], Nxz + nSine[1],
+			Nxy + nSine[2], Nyy + cos, Nyz - nSine[0],
+			Nxz - nSine[1], Nyz + nSine[0], Nzz + cos,
 		};
 	}
 
 	template<typename T>
-	inline Mat<3, 3, T> rotation(const Vec<3, T> &euler)
+	inline constexpr Mat<3, 3, T> rotation(const Vec<3, T> &euler)
 	{
-		Vec<3, T> sin = sin(euler);
-		Vec<3, T> cos = cos(euler);
-		T sinxy = sin.x * sin.y;
-		T cxsy = cos.x * sin.y;
+		Vec<3, T> sin, cos;
+		sincos(euler, sin, cos);
+		T sinxy = sin[0] * sin[1];
+		T cxsy = cos[0] * sin[1];
 		return 
 		{
-			cos.y * cos.z, -cos.y * sin.z, sin.y,
-			cos.x * sin.z + sinxy * cos.z, cos.x * cos.z - sinxy * sin.z, -cos.y * sin.x,
-			sin.x * sin.z - cxsy * cos.z, cos.z * sin.x + cxsy * sin.z, cos.x * cos.y
+			cos[1] * cos[2], -cos[1] * sin[2], sin[1],
+			cos[0] * sin[2] + sinxy * cos[2], cos[0] * cos[2] - sinxy * sin[2], -cos[1] * sin[0],
+			sin[0] * sin[2] - cxsy * cos[2], cos[2] * sin[0] + cxsy * sin[2], cos[0] * cos[1]
 		};
 	}
 
 	template<typename T>
-	inline Mat<3, 3, T> rotation(const Quat<T>& q)
+	inline constexpr Mat<3, 3, T> rotation(const Quat<T>& q)
 	{
 		const T _1 = 1;
-		Vec <3, T> q2 = (T)2 * q.n;
-		T q2xx = q2.x * q.x;
-		T q2xy = q2.x * q.y;
-		T q2xz = q2.x * q.z;
-		T q2xw = q2.x * q.w;
-		T q2yy = q2.y * q.y;
-		T q2yz = q2.y * q.z;
-		T q2yw = q2.y * q.w;
-		T q2zz = q2.z * q.z;
-		T q2zw = q2.z * q.w;
+		T q2x = q.x + q.x;
+		T q2y = q.y + q.y;
+		T q2z = q.z + q.z;
+		T q2xx = q2x * q.x;
+		T q2xy = q2x * q.y;
+		T q2xz = q2x * q.z;
+		T q2xw = q2x * q.w;
+		T q2yy = q2y * q.y;
+		T q2yz = q2y * q.z;
+		T q2yw = q2y * q.w;
+		T q2zz = q2z * q.z;
+		T q2zw = q2z * q.w;
 		return
 		{
 			_1 - q2yy - q2zz, q2xy + q2zw, q2xz - q2yw,
@@ -157,18 +163,44 @@ namespace gm
 		};
 	}
 
+	// Inverse of rotation(q) for a pure rotation matrix, branching on the largest of w, x, y, z for precision.
 	template<typename T>
-	inline Mat<3, 3, T> scale(const Vec<3, T> &normal, const T &scale)
+	inline constexpr Quat<T> toQuat(const Mat<3, 3, T> &m)
+	{
+		const T _1 = 1;
+		const T _4 = 0.25;
+		T trace = m[0] + m[4] + m[8];
+		if (trace > 0)
+		{
+			T s = cx::sqrt(trace + _1) * 2;
+			return Quat<T>((m[5] - m[7]) / s, (m[6] - m[2]) / s, (m[1] - m[3]) / s, s * _4);
+		}
+		if (m[0] > m[4] && m[0] > m[8])
+		{
+			T s = cx::sqrt(_1 + m[0] - m[4] - m[8]) * 2;
+			return Quat<T>(s * _4, (m[1] + m[3]) / s, (m[6] + m[2]) / s, (m[5] - m[7]) / s);
+		}
+		if (m[4] > m[8])
+		{
+			T s = cx::sqrt(_1 + m[4] - m[0] - m[8]) * 2;
+			return Quat<T>((m[1] + m[3]) / s, s * _4, (m[5] + m[7]) / s, (m[6] - m[2]) / s);
+		}
+		T s = cx::sqrt(_1 + m[8] - m[0] - m[4]) * 2;
+		return Quat<T>((m[6] + m[2]) / s, (m[5] + m[7]) / s, s * _4, (m[1] - m[3]) / s);
+	}
+
+	template<typename T>
+	inline constexpr Mat<3, 3, T> scale(const Vec<3, T> &normal, const T &scale)
 	{
 		const T _1 = 1;
 		T scmone = scale - (T)1;
 		Vec<3, T> scmoneN = normal * scmone;
-		T Nxx = scmoneN.x * normal.x;
-		T Nxy = scmoneN.x * normal.y;
-		T Nxz = scmoneN.x * normal.z;
-		T Nyy = scmoneN.y * normal.y;
-		T Nyz = scmoneN.y * normal.z;
-		T Nzz = scmoneN.z * normal.z;
+		T Nxx = scmoneN[0] * normal[0];
+		T Nxy = scmoneN[0] * normal[1];
+		T Nxz = scmoneN[0] * normal[2];
+		T Nyy = scmoneN[1] * normal[1];
+		T Nyz = scmoneN[1] * normal[2];
+		T Nzz = scmoneN[2] * normal[2];
 
 		return 
 		{
@@ -179,14 +211,14 @@ namespace gm
 	}
 
 	template<typename T>
-	inline Mat<2, 2, T> scale(const Vec<2, T> &normal, const T &scale)
+	inline constexpr Mat<2, 2, T> scale(const Vec<2, T> &normal, const T &scale)
 	{
 		const T _1 = 1;
 		T scmone = scale - (T)1;
 		Vec<2, T> scmoneN = normal * scmone;
-		T Nxx = scmoneN.x * normal.x;
-		T Nxy = scmoneN.x * normal.y;
-		T Nyy = scmoneN.y * normal.y;
+		T Nxx = scmoneN[0] * normal[0];
+		T Nxy = scmoneN[0] * normal[1];
+		T Nyy = scmoneN[1] * normal[1];
 
 		return 
 		{
@@ -196,7 +228,7 @@ namespace gm
 	}
 
 	template<int N, typename T>
-	constexpr Mat<N, N, T> diagonal(const Vec<N, T> &diaginal)
+	inline constexpr Mat<N, N, T> diagonal(const Vec<N, T> &diaginal)
 	{
 		Mat<N, N, T> m;
 		for (int c = 0; c < N; ++c)
@@ -205,7 +237,7 @@ namespace gm
 		return m;
 	}
 	template<int N, typename T>
-	constexpr Mat<N, N, T> diagonal(const T value)
+	inline constexpr Mat<N, N, T> diagonal(const T value)
 	{
 		Mat<N, N, T> m;
 		for (int c = 0; c < N; ++c)
@@ -214,13 +246,13 @@ namespace gm
 		return m;
 	}
 	template<int N, typename T>
-	constexpr Mat<N, N, T> identity()
+	inline constexpr Mat<N, N, T> identity()
 	{
 		return diagonal<N, T>((T)1);
 	}
 
 	template<int R, int C, typename T>
-	inline Mat<C, R, T> transpose(const Mat<R, C, T> &m)
+	inline constexpr Mat<C, R, T> transpose(const Mat<R, C, T> &m)
 	{
 		Mat<C, R, T> result;
 		for (int c = 0; c < C; c++)
@@ -230,13 +262,13 @@ namespace gm
 	}
 
 	template<typename T>
-	inline T determinant(const Mat<2, 2, T> &m)
+	inline constexpr T determinant(const Mat<2, 2, T> &m)
 	{
 		return m[0] * m[3] - m[1] * m[2];
 	}
 
 	template<typename T>
-	inline T determinant(const Mat<3, 3, T> &m)
+	inline constexpr T determinant(const Mat<3, 3, T> &m)
 	{
 		return
 			+ m[0] * (m[4] * m[8] - m[5] * m[7])
@@ -245,7 +277,7 @@ namespace gm
 	}
 
 	template<typename T>
-	inline T determinant(const Mat<4, 4, T> &m)
+	inline constexpr T determinant(const Mat<4, 4, T> &m)
 	{
 		T d2_01 = m[8] * m[13] - m[9] * m[12];
 		T d2_02 = m[8] * m[14] - m[10] * m[12];
@@ -260,21 +292,128 @@ namespace gm
 			- m[3] * (m[4] * d2_12 - m[5] * d2_02 + m[6] * d2_01);
 	}
 
+	#pragma region LU
+	// Row-pivoted LU decomposition, P * m = L * U.
+	// lu holds U on and above the diagonal and L (with unit diagonal) below it,
+	// row r of P * m is row pivots[r] of m.
 	template<int N, typename T>
-	inline T determinant(const Mat<N, N, T> &m)
+	struct LU
 	{
-		T result = m[0] * determinant(minor(m, 0, 0));
-		for (int i = 2; i < N; i += 2)
-			result += m[i] * determinant(minor(m, 0, i));
+		Mat<N, N, T> lu;
+		int pivots[N];
+		T sign;
+	};
 
-		for (int i = 1; i < N; i += 2)
-			result -= m[i] * determinant(minor(m, 0, i));
+	template<int N, typename T>
+	inline constexpr LU<N, T> lu(const Mat<N, N, T> &m)
+	{
+		LU<N, T> result;
+		Mat<N, N, T> &a = result.lu;
+		a = m;
+		result.sign = (T)1;
+		for (int i = 0; i < N; ++i)
+			result.pivots[i] = i;
+
+		for (int k = 0; k < N; ++k)
+		{
+			int p = k;
+			T maxAbs = cx::abs(a[k*N + k]);
+			for (int r = k + 1; r < N; ++r)
+			{
+				T v = cx::abs(a[k*N + r]);
+				if (v > maxAbs)
+				{
+					maxAbs = v;
+					p = r;
+				}
+			}
+			if (p != k)
+			{
+				for (int c = 0; c < N; ++c)
+					std::swap(a[c*N + k], a[c*N + p]);
+				std::swap(result.pivots[k], result.pivots[p]);
+				result.sign = -result.sign;
+			}
+			if (a[k*N + k] == (T)0)
+				continue;
 
+			T invPivot = (T)1 / a[k*N + k];
+			for (int r = k + 1; r < N; ++r)
+				a[k*N + r] *= invPivot;
+			for (int c = k + 1; c < N; ++c)
+			{
+				T u = a[c*N + k];
+				for (int r = k + 1; r < N; ++r)
+					a[c*N + r] -= a[k*N + r] * u;
+			}
+		}
+		return result;
+	}
+
+	template<int N, typename T>
+	inline constexpr T determinant(const LU<N, T> &d)
+	{
+		T result = d.sign;
+		for (int i = 0; i < N; ++i)
+			result *= d.lu[i*N + i];
 		return result;
 	}
 
 	template<int N, typename T>
-	inline Mat<N - 1, N - 1, T> minor(const Mat<N, N, T> &m, int i, int j)
+	inline constexpr Vec<N, T> solve(const LU<N, T> &d, const Vec<N, T> &b)
+	{
+		Vec<N, T> x;
+		for (int r = 0; r < N; ++r)
+			x[r] = b[d.pivots[r]];
+		for (int c = 0; c < N; ++c)
+			for (int r = c + 1; r < N; ++r)
+				x[r] -= d.lu[c*N + r] * x[c];
+		for (int c = N - 1; c >= 0; --c)
+		{
+			x[c] /= d.lu[c*N + c];
+			for (int r = 0; r < c; ++r)
+				x[r] -= d.lu[c*N + r] * x[c];
+		}
+		return x;
+	}
+
+	template<int N, int C, typename T>
+	inline constexpr Mat<N, C, T> solve(const LU<N, T> &d, const Mat<N, C, T> &b)
+	{
+		Mat<N, C, T> x;
+		for (int c = 0; c < C; ++c)
+		{
+			Vec<N, T> column;
+			for (int r = 0; r < N; ++r)
+				column[r] = b[c*N + r];
+			column = solve(d, column);
+			for (int r = 0; r < N; ++r)
+				x[c*N + r] = column[r];
+		}
+		return x;
+	}
+
+	template<int N, typename T>
+	inline constexpr Vec<N, T> solve(const Mat<N, N, T> &m, const Vec<N, T> &b)
+	{
+		return solve(lu(m), b);
+	}
+
+	template<int N, typename T>
+	inline constexpr Mat<N, N, T> inverse(const LU<N, T> &d)
+	{
+		return solve(d, identity<N, T>());
+	}
+	#pragma endregion LU
+
+	template<int N, typename T>
+	inline constexpr T determinant(const Mat<N, N, T> &m)
+	{
+		return determinant(lu(m));
+	}
+
+	template<int N, typename T>
+	inline constexpr Mat<N - 1, N - 1, T> minor(const Mat<N, N, T> &m, int i, int j)
 	{
 		int iN = i * N;
 		Mat<N - 1, N - 1, T> result;
@@ -292,31 +431,91 @@ namespace gm
 	}
 
 	template<int N, typename T>
-	inline T cofactor(const Mat<N, N, T> &m, int i, int j)
+	inline constexpr T cofactor(const Mat<N, N, T> &m, int i, int j)
 	{
 		T result = determinant(minor(m, i, j));
 		return (i ^ j) & 1 ? -result : result;
 	}
 
-	template<int N, typename T>
-	inline Mat<N, N, T> inverse(const Mat<N, N, T> &m)
+	template<typename T>
+	inline constexpr Mat<2, 2, T> inverse(const Mat<2, 2, T> &m)
 	{
-		Mat<N, N, T> comatrix;
-		for (int i = 0; i < N; i++)
-			for (int j = 0; j < N; j++)
-				comatrix[i * N + j] = cofactor(m, i, j);
+		T invDet = (T)1 / determinant(m);
+		return
+		{
+			m[3] * invDet, -m[1] * invDet,
+			-m[2] * invDet, m[0] * invDet
+		};
+	}
 
-		T det = m[0] * comatrix[0];
-		for (int i = 1; i < N; i++)
-			det += m[i] * comatrix[i];
+	template<typename T>
+	inline constexpr Mat<3, 3, T> inverse(const Mat<3, 3, T> &m)
+	{
+		T c0 = m[4] * m[8] - m[5] * m[7];
+		T c1 = m[5] * m[6] - m[3] * m[8];
+		T c2 = m[3] * m[7] - m[4] * m[6];
+		T invDet = (T)1 / (m[0] * c0 + m[1] * c1 + m[2] * c2);
+		return
+		{
+			c0 * invDet, (m[2] * m[7] - m[1] * m[8]) * invDet, (m[1] * m[5] - m[2] * m[4]) * invDet,
+			c1 * invDet, (m[0] * m[8] - m[2] * m[6]) * invDet, (m[2] * m[3] - m[0] * m[5]) * invDet,
+			c2 * invDet, (m[1] * m[6] - m[0] * m[7]) * invDet, (m[0] * m[4] - m[1] * m[3]) * invDet
+		};
+	}
 
-		Mat<N, N, T> result = transpose(comatrix);
-		result *= (T)1 / determinant(m);
-		return result;
+	template<typename T>
+	inline constexpr Mat<4, 4, T> inverse(const Mat<4, 4, T> &m)
+	{
+		// same 2x2 sub-determinants of the last two columns as determinant(),
+		// plus the complementary ones of the first two columns
+		T d2_01 = m[8] * m[13] - m[9] * m[12];
+		T d2_02 = m[8] * m[14] - m[10] * m[12];
+		T d2_03 = m[8] * m[15] - m[11] * m[12];
+		T d2_12 = m[9] * m[14] - m[10] * m[13];
+		T d2_13 = m[9] * m[15] - m[11] * m[13];
+		T d2_23 = m[10] * m[15] - m[11] * m[14];
+
+		T u2_01 = m[0] * m[5] - m[1] * m[4];
+		T u2_02 = m[0] * m[6] - m[2] * m[4];
+		T u2_03 = m[0] * m[7] - m[3] * m[4];
+		T u2_12 = m[1] * m[6] - m[2] * m[5];
+		T u2_13 = m[1] * m[7] - m[3] * m[5];
+		T u2_23 = m[2] * m[7] - m[3] * m[6];
+
+		T det = u2_01 * d2_23 - u2_02 * d2_13 + u2_03 * d2_12 + u2_12 * d2_03 - u2_13 * d2_02 + u2_23 * d2_01;
+		T invDet = (T)1 / det;
+		return
+		{
+			( m[5] * d2_23 - m[6] * d2_13 + m[7] * d2_12) * invDet,
+			(-m[1] * d2_23 + m[2] * d2_13 - m[3] * d2_12) * invDet,
+			( m[13] * u2_23 - m[14] * u2_13 + m[15] * u2_12) * invDet,
+			(-m[9] * u2_23 + m[10] * u2_13 - m[11] * u2_12) * invDet,
+
+			(-m[4] * d2_23 + m[6] * d2_03 - m[7] * d2_02) * invDet,
+			( m[0] * d2_23 - m[2] * d2_03 + m[3] * d2_02) * invDet,
+			(-m[12] * u2_23 + m[14] * u2_03 - m[15] * u2_02) * invDet,
+			( m[8] * u2_23 - m[10] * u2_03 + m[11] * u2_02) * invDet,
+
+			( m[4] * d2_13 - m[5] * d2_03 + m[7] * d2_01) * invDet,
+			(-m[0] * d2_13 + m[1] * d2_03 - m[3] * d2_01) * invDet,
+			( m[12] * u2_13 - m[13] * u2_03 + m[15] * u2_01) * invDet,
+			(-m[8] * u2_13 + m[9] * u2_03 - m[11] * u2_01) * invDet,
+
+			(-m[4] * d2_12 + m[5] * d2_02 - m[6] * d2_01) * invDet,
+			( m[0] * d2_12 - m[1] * d2_02 + m[2] * d2_01) * invDet,
+			(-m[12] * u2_12 + m[13] * u2_02 - m[14] * u2_01) * invDet,
+			( m[8] * u2_12 - m[9] * u2_02 + m[10] * u2_01) * invDet,
+		};
+	}
+
+	template<int N, typename T>
+	inline constexpr Mat<N, N, T> inverse(const Mat<N, N, T> &m)
+	{
+		return inverse(lu(m));
 	}
 
 	template<typename T>
-	inline Mat<4, 4, T> translate(const Mat<3, 3, T> &m, const Vec<3, T> translation)
+	inline constexpr Mat<4, 4, T> translate(const Mat<3, 3, T> &m, const Vec<3, T> translation)
 	{
 		const T _0 = 0;
 		const T _1 = 1;
@@ -325,16 +524,58 @@ namespace gm
 			m[0], m[1], m[2], _0,
 			m[3], m[4], m[5], _0,
 			m[6], m[7], m[8], _0,
-			translation.x, translation.y, translation.z, _1
+			translation[0], translation[1], translation[2], _1
+		};
+	}
+
+	// Inverse of an affine matrix as built by translate(): the last row must be 0, 0, 0, 1.
+	template<typename T>
+	inline constexpr Mat<4, 4, T> inverseAffine(const Mat<4, 4, T> &m)
+	{
+		Mat<3, 3, T> a
+		{
+			m[0], m[1], m[2],
+			m[4], m[5], m[6],
+			m[8], m[9], m[10]
+		};
+		Mat<3, 3, T> inv = inverse(a);
+		return translate(inv, -(inv * Vec<3, T>(m[12], m[13], m[14])));
+	}
+
+	// Inverse of a rotation + translation matrix, e.g. translate(rotation(q), t).
+	template<typename T>
+	inline constexpr Mat<4, 4, T> inverseRigid(const Mat<4, 4, T> &m)
+	{
+		Mat<3, 3, T> inv
+		{
+			m[0], m[4], m[8],
+			m[1], m[5], m[9],
+			m[2], m[6], m[10]
 		};
+		return translate(inv, -(inv * Vec<3, T>(m[12], m[13], m[14])));
 	}
 
+	// Batched forms, in and out may be the same array.
 	template<typename T>
-	inline Mat<4, 4, T> perspective(T fov, T aspect, T near, T far, bool rightHanded = false)
+	inline void inverseAffine(const Mat<4, 4, T> *in, Mat<4, 4, T> *out, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			out[i] = inverseAffine(in[i]);
+	}
+
+	template<typename T>
+	inline void inverseRigid(const Mat<4, 4, T> *in, Mat<4, 4, T> *out, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			out[i] = inverseRigid(in[i]);
+	}
+
+	template<typename T>
+	inline constexpr Mat<4, 4, T> perspective(T fov, T aspect, T near, T far, bool rightHanded = false)
 	{
 		const T _1 = 1;
 		const T _0 = 0;
-		T const tanHalfFov = std::tan(fov * (T)0.5);
+		T const tanHalfFov = cx::tan(fov * (T)0.5);
 
 		T invRange = _1 / (far - near);
 
@@ -361,7 +602,7 @@ namespace gm
 	}
 
 	template<typename T>
-	inline Mat<4, 4, T> ortho(Vec<3, T> max, Vec<3, T> min, bool rightHanded = false)
+	inline constexpr Mat<4, 4, T> ortho(Vec<3, T> max, Vec<3, T> min, bool rightHanded = false)
 	{
 		const T _0 = 0;
 		const T _1 = 1;
@@ -373,27 +614,27 @@ namespace gm
 
 		if (rightHanded)
 		{
-			mul.z = -mul.z;
+			mul[2] = -mul[2];
 		}
 		return 
 		{
-			mul.x, _0, _0, _0,
-			_0, mul.y, _0, _0,
-			_0, _0, mul.z, _0,
-			add.x, add.y, add.z, _1,
+			mul[0], _0, _0, _0,
+			_0, mul[1], _0, _0,
+			_0, _0, mul[2], _0,
+			add[0], add[1], add[2], _1,
 		};
 	}
 
 	template<typename T>
-	inline Mat<4, 4, T> ortho(T left, T right, T bottom, T top, T near, T far, bool rightHanded = false)
+	inline constexpr Mat<4, 4, T> ortho(T left, T right, T bottom, T top, T near, T far, bool rightHanded = false)
 	{
-		return ortho({right, top, far}, {left, bottom, near}, rightHanded);
+		return ortho(Vec<3, T>(right, top, far), Vec<3, T>(left, bottom, near), rightHanded);
 	}
 
 
 #define OVERLOAD_OP_MAT(op)																	\
 	template<int R, int C, typename T>														\
-	inline Mat<R, C, T> operator op (const Mat<R, C, T> &a, const Mat<R, C, T> &b)			\
+	inline constexpr Mat<R, C, T> operator op (const Mat<R, C, T> &a, const Mat<R, C, T> &b)	\
 	{																						\
 		Mat<R, C, T> y;																		\
 		for (int i = 0; i < C * R; i++)														\
@@ -401,7 +642,7 @@ namespace gm
 		return y;																			\
 	}																						\
 	template<int R, int C, typename T>														\
-	inline Mat<R, C, T> & operator op##= (Mat<R, C, T> &a, const Mat<R, C, T> &b)			\
+	inline constexpr Mat<R, C, T> & operator op##= (Mat<R, C, T> &a, const Mat<R, C, T> &b)	\
 	{																						\
 		for (int i = 0; i < C * R; i++)														\
 			a[i] op##= b[i];																\
@@ -410,7 +651,7 @@ namespace gm
 
 #define OVERLOAD_OP_SCAL(op)																\
 	template<int R, int C, typename T>														\
-	inline Mat<R, C, T> operator op (const Mat<R, C, T> &a, const T &b)						\
+	inline constexpr Mat<R, C, T> operator op (const Mat<R, C, T> &a, const T &b)			\
 	{																						\
 		Mat<R, C, T> y;																		\
 		for (int i = 0; i < C * R; i++)														\
@@ -418,7 +659,7 @@ namespace gm
 		return y;																			\
 	}																						\
 	template<int R, int C, typename T>														\
-	inline Mat<R, C, T> operator op (const T &a, const Mat<R, C, T> &b)						\
+	inline constexpr Mat<R, C, T> operator op (const T &a, const Mat<R, C, T> &b)			\
 	{																						\
 		Mat<R, C, T> y;																		\
 		for (int i = 0; i < C * R; i++)														\
@@ -426,7 +667,7 @@ namespace gm
 		return y;																			\
 	}																						\
 	template<int R, int C, typename T>														\
-	inline Mat<R, C, T> & operator op##= (Mat<R, C, T> &a, const T &b)						\
+	inline constexpr Mat<R, C, T> & operator op##= (Mat<R, C, T> &a, const T &b)			\
 	{																						\
 		for (int i = 0; i < C * R; i++)														\
 			a[i] op##= b;																	\
@@ -435,7 +676,7 @@ namespace gm
 
 
 	template<int R, int C, typename T>
-	inline Mat<R, C, T> operator / (const Mat<R, C, T> &a, const T &b)
+	inline constexpr Mat<R, C, T> operator / (const Mat<R, C, T> &a, const T &b)
 	{
 		T invDiv = (T)1 / b;
 		Mat<R, C, T> y;
@@ -444,7 +685,7 @@ namespace gm
 		return y;
 	}
 	template<int R, int C, typename T>
-	inline Mat<R, C, T> operator / (const T &a, const Mat<R, C, T> &b)
+	inline constexpr Mat<R, C, T> operator / (const T &a, const Mat<R, C, T> &b)
 	{
 		Mat<R, C, T> y;
 		for (int i = 0; i < C * R; i++)
@@ -452,7 +693,7 @@ namespace gm
 		return y;
 	}
 	template<int R, int C, typename T>
-	inline Mat<R, C, T> & operator /= (Mat<R, C, T> &a, const T &b)
+	inline constexpr Mat<R, C, T> & operator /= (Mat<R, C, T> &a, const T &b)
 	{
 		T invDiv = (T)1 / b;
 		for (int i = 0; i < C * R; i++)
@@ -469,7 +710,7 @@ namespace gm
 	OVERLOAD_OP_SCAL(-)
 
 	template<int R, int C, typename T>
-	inline Mat<R, C, T> operator -(const Mat<R, C, T> &b)
+	inline constexpr Mat<R, C, T> operator -(const Mat<R, C, T> &b)
 	{
 		Mat<R, C, T> y;
 		for (int i = 0; i < C * R; i++)
@@ -477,4 +718,6 @@ namespace gm
 		return y;
 	}
 
-}
\ No newline at end of file
+}
+
+#include "MatricesSIMD.h"
\ No newline at end of file
@@ -0,0 +1,249 @@
+#pragma once
+#include "Matrices.h"
+#include "Pack.h"
+
+namespace gm
+{
+	// Scalar reference of the float4x4 kernels.
+	// Every result column is accumulated left to right over the columns of a:
+	//   y = a.col0 * b0;  y = y + a.col1 * b1;  y = y + a.col2 * b2;  y = y + a.col3 * b3;
+	// where each "y + a * b" is a single fused std::fma when GM_SIMD_FMA is defined.
+	// Without FMA this is exactly the order of the generic operator* loops,
+	// so the SIMD kernels are bit-identical to both.
+	inline Vec<4, float> mulReference(const Mat<4, 4, float> &a, const Vec<4, float> &b)
+	{
+		Vec<4, float> y;
+		for (int r = 0; r < 4; ++r)
+		{
+			float dot = a[r] * b[0];
+			for (int n = 1; n < 4; ++n)
+			{
+			#if defined(GM_SIMD_FMA)
+				dot = std::fma(a[n * 4 + r], b[n], dot);
+			#else
+				dot = dot + a[n * 4 + r] * b[n];
+			#endif
+			}
+			y[r] = dot;
+		}
+		return y;
+	}
+
+	inline Mat<4, 4, float> mulReference(const Mat<4, 4, float> &a, const Mat<4, 4, float> &b)
+	{
+		Mat<4, 4, float> y;
+		for (int c = 0; c < 4; ++c)
+			y.base_vecs[c] = mulReference(a, b.base_vecs[c]);
+		return y;
+	}
+
+
+#if defined(GM_SIMD_SSE2)
+	inline GM_CONSTEXPR Vec<4, float> operator * (const Mat<4, 4, float> &a, const Vec<4, float> &b)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return operator*<4, 4, float>(a, b);
+		__m128 v = b.simd();
+		__m128 y = _mm_mul_ps(a.base_vecs[0].simd(), simd::splat<0>(v));
+		y = simd::madd(a.base_vecs[1].simd(), simd::splat<1>(v), y);
+		y = simd::madd(a.base_vecs[2].simd(), simd::splat<2>(v), y);
+		y = simd::madd(a.base_vecs[3].simd(), simd::splat<3>(v), y);
+		return Vec<4, float>(y);
+	}
+
+	inline GM_CONSTEXPR Mat<4, 4, float> operator * (const Mat<4, 4, float> &a, const Mat<4, 4, float> &b)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return operator*<4, 4, 4, float>(a, b);
+		Mat<4, 4, float> y;
+	#if defined(GM_SIMD_AVX512)
+		__m512 vb = _mm512_loadu_ps(b.values);
+		__m512 r = _mm512_mul_ps(_mm512_broadcast_f32x4(a.base_vecs[0].simd()), _mm512_permute_ps(vb, 0x00));
+	#if defined(GM_SIMD_FMA)
+		r = _mm512_fmadd_ps(_mm512_broadcast_f32x4(a.base_vecs[1].simd()), _mm512_permute_ps(vb, 0x55), r);
+		r = _mm512_fmadd_ps(_mm512_broadcast_f32x4(a.base_vecs[2].simd()), _mm512_permute_ps(vb, 0xAA), r);
+		r = _mm512_fmadd_ps(_mm512_broadcast_f32x4(a.base_vecs[3].simd()), _mm512_permute_ps(vb, 0xFF), r);
+	#else
+		r = _mm512_add_ps(r, _mm512_mul_ps(_mm512_broadcast_f32x4(a.base_vecs[1].simd()), _mm512_permute_ps(vb, 0x55)));
+		r = _mm512_add_ps(r, _mm512_mul_ps(_mm512_broadcast_f32x4(a.base_vecs[2].simd()), _mm512_permute_ps(vb, 0xAA)));
+		r = _mm512_add_ps(r, _mm512_mul_ps(_mm512_broadcast_f32x4(a.base_vecs[3].simd()), _mm512_permute_ps(vb, 0xFF)));
+	#endif
+		_mm512_storeu_ps(y.values, r);
+	#elif defined(GM_SIMD_AVX)
+		__m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.base_vecs[0]));
+		__m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.base_vecs[1]));
+		__m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.base_vecs[2]));
+		__m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.base_vecs[3]));
+		for (int c = 0; c < 4; c += 2)
+		{
+			__m256 vb = _mm256_loadu_ps(b.values + c * 4);
+			__m256 r = _mm256_mul_ps(a0, _mm256_permute_ps(vb, 0x00));
+		#if defined(GM_SIMD_FMA)
+			r = _mm256_fmadd_ps(a1, _mm256_permute_ps(vb, 0x55), r);
+			r = _mm256_fmadd_ps(a2, _mm256_permute_ps(vb, 0xAA), r);
+			r = _mm256_fmadd_ps(a3, _mm256_permute_ps(vb, 0xFF), r);
+		#else
+			r = _mm256_add_ps(r, _mm256_mul_ps(a1, _mm256_permute_ps(vb, 0x55)));
+			r = _mm256_add_ps(r, _mm256_mul_ps(a2, _mm256_permute_ps(vb, 0xAA)));
+			r = _mm256_add_ps(r, _mm256_mul_ps(a3, _mm256_permute_ps(vb, 0xFF)));
+		#endif
+			_mm256_storeu_ps(y.values + c * 4, r);
+		}
+	#else
+		for (int c = 0; c < 4; ++c)
+			y.base_vecs[c] = a * b.base_vecs[c];
+	#endif
+		return y;
+	}
+
+	inline GM_CONSTEXPR Mat<4, 4, float> inverseAffine(const Mat<4, 4, float> &m)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return inverseAffine<float>(m);
+		__m128 a0 = m.base_vecs[0].simd();
+		__m128 a1 = m.base_vecs[1].simd();
+		__m128 a2 = m.base_vecs[2].simd();
+		__m128 r0 = simd::cross3(a1, a2);
+		__m128 r1 = simd::cross3(a2, a0);
+		__m128 r2 = simd::cross3(a0, a1);
+		__m128 r3 = _mm_setzero_ps();
+		__m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), simd::hsum(_mm_mul_ps(a0, r0)));
+		r0 = _mm_mul_ps(r0, invDet);
+		r1 = _mm_mul_ps(r1, invDet);
+		r2 = _mm_mul_ps(r2, invDet);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+		__m128 t = m.base_vecs[3].simd();
+		__m128 it = _mm_mul_ps(r0, simd::splat<0>(t));
+		it = simd::madd(r1, simd::splat<1>(t), it);
+		it = simd::madd(r2, simd::splat<2>(t), it);
+
+		Mat<4, 4, float> y;
+		y.base_vecs[0].simd(r0);
+		y.base_vecs[1].simd(r1);
+		y.base_vecs[2].simd(r2);
+		y.base_vecs[3].simd(_mm_sub_ps(_mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f), it));
+		return y;
+	}
+
+	inline GM_CONSTEXPR Mat<4, 4, float> inverseRigid(const Mat<4, 4, float> &m)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return inverseRigid<float>(m);
+		__m128 r0 = m.base_vecs[0].simd();
+		__m128 r1 = m.base_vecs[1].simd();
+		__m128 r2 = m.base_vecs[2].simd();
+		__m128 r3 = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+		__m128 t = m.base_vecs[3].simd();
+		__m128 it = _mm_mul_ps(r0, simd::splat<0>(t));
+		it = simd::madd(r1, simd::splat<1>(t), it);
+		it = simd::madd(r2, simd::splat<2>(t), it);
+
+		Mat<4, 4, float> y;
+		y.base_vecs[0].simd(r0);
+		y.base_vecs[1].simd(r1);
+		y.base_vecs[2].simd(r2);
+		y.base_vecs[3].simd(_mm_sub_ps(_mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f), it));
+		return y;
+	}
+
+	inline GM_CONSTEXPR Mat<4, 4, float> transpose(const Mat<4, 4, float> &m)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return transpose<4, 4, float>(m);
+		Mat<4, 4, float> y;
+	#if defined(GM_SIMD_AVX512)
+		__m512i order = _mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+		_mm512_storeu_ps(y.values, _mm512_permutexvar_ps(order, _mm512_loadu_ps(m.values)));
+	#else
+		__m128 c0 = _mm_loadu_ps(m.values);
+		__m128 c1 = _mm_loadu_ps(m.values + 4);
+		__m128 c2 = _mm_loadu_ps(m.values + 8);
+		__m128 c3 = _mm_loadu_ps(m.values + 12);
+		simd::transpose4(c0, c1, c2, c3);
+		_mm_storeu_ps(y.values, c0);
+		_mm_storeu_ps(y.values + 4, c1);
+		_mm_storeu_ps(y.values + 8, c2);
+		_mm_storeu_ps(y.values + 12, c3);
+	#endif
+		return y;
+	}
+
+	inline GM_CONSTEXPR Mat<4, 4, double> transpose(const Mat<4, 4, double> &m)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return transpose<4, 4, double>(m);
+		Mat<4, 4, double> y;
+	#if defined(GM_SIMD_AVX512)
+		__m512d a = _mm512_loadu_pd(m.values), b = _mm512_loadu_pd(m.values + 8);
+		_mm512_storeu_pd(y.values, _mm512_permutex2var_pd(a, _mm512_setr_epi64(0, 4, 8, 12, 1, 5, 9, 13), b));
+		_mm512_storeu_pd(y.values + 8, _mm512_permutex2var_pd(a, _mm512_setr_epi64(2, 6, 10, 14, 3, 7, 11, 15), b));
+	#elif defined(GM_SIMD_AVX)
+		__m256d c0 = _mm256_loadu_pd(m.values), c1 = _mm256_loadu_pd(m.values + 4);
+		__m256d c2 = _mm256_loadu_pd(m.values + 8), c3 = _mm256_loadu_pd(m.values + 12);
+		__m256d t0 = _mm256_unpacklo_pd(c0, c1), t1 = _mm256_unpackhi_pd(c0, c1);
+		__m256d t2 = _mm256_unpacklo_pd(c2, c3), t3 = _mm256_unpackhi_pd(c2, c3);
+		_mm256_storeu_pd(y.values, _mm256_permute2f128_pd(t0, t2, 0x20));
+		_mm256_storeu_pd(y.values + 4, _mm256_permute2f128_pd(t1, t3, 0x20));
+		_mm256_storeu_pd(y.values + 8, _mm256_permute2f128_pd(t0, t2, 0x31));
+		_mm256_storeu_pd(y.values + 12, _mm256_permute2f128_pd(t1, t3, 0x31));
+	#else
+		// rows 0, 1 and rows 2, 3 of every column
+		__m128d lo[4], hi[4];
+		for (int c = 0; c < 4; ++c)
+		{
+			lo[c] = _mm_loadu_pd(m.values + c * 4);
+			hi[c] = _mm_loadu_pd(m.values + c * 4 + 2);
+		}
+		_mm_storeu_pd(y.values, _mm_unpacklo_pd(lo[0], lo[1]));
+		_mm_storeu_pd(y.values + 2, _mm_unpacklo_pd(lo[2], lo[3]));
+		_mm_storeu_pd(y.values + 4, _mm_unpackhi_pd(lo[0], lo[1]));
+		_mm_storeu_pd(y.values + 6, _mm_unpackhi_pd(lo[2], lo[3]));
+		_mm_storeu_pd(y.values + 8, _mm_unpacklo_pd(hi[0], hi[1]));
+		_mm_storeu_pd(y.values + 10, _mm_unpacklo_pd(hi[2], hi[3]));
+		_mm_storeu_pd(y.values + 12, _mm_unpackhi_pd(hi[0], hi[1]));
+		_mm_storeu_pd(y.values + 14, _mm_unpackhi_pd(hi[2], hi[3]));
+	#endif
+		return y;
+	}
+
+	inline GM_CONSTEXPR Mat<8, 8, float> transpose(const Mat<8, 8, float> &m)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return transpose<8, 8, float>(m);
+		Mat<8, 8, float> y;
+	#if defined(GM_SIMD_AVX)
+		// after 4x4 transposes inside both 128 bit lanes column i holds rows i and i + 4 of columns 0-3,
+		// column i + 4 the same of columns 4-7
+		__m256 c[8];
+		for (int i = 0; i < 8; ++i)
+			c[i] = _mm256_loadu_ps(m.values + i * 8);
+		simd::transpose4(c[0], c[1], c[2], c[3]);
+		simd::transpose4(c[4], c[5], c[6], c[7]);
+		for (int i = 0; i < 4; ++i)
+		{
+			_mm256_storeu_ps(y.values + i * 8, _mm256_permute2f128_ps(c[i], c[i + 4], 0x20));
+			_mm256_storeu_ps(y.values + (i + 4) * 8, _mm256_permute2f128_ps(c[i], c[i + 4], 0x31));
+		}
+	#else
+		// 4x4 block at column c, row r of y is the transposed block at column r, row c of m
+		for (int r = 0; r < 8; r += 4)
+		{
+			for (int c = 0; c < 8; c += 4)
+			{
+				__m128 a = _mm_loadu_ps(m.values + r * 8 + c), b = _mm_loadu_ps(m.values + (r + 1) * 8 + c);
+				__m128 d = _mm_loadu_ps(m.values + (r + 2) * 8 + c), e = _mm_loadu_ps(m.values + (r + 3) * 8 + c);
+				simd::transpose4(a, b, d, e);
+				_mm_storeu_ps(y.values + c * 8 + r, a);
+				_mm_storeu_ps(y.values + (c + 1) * 8 + r, b);
+				_mm_storeu_ps(y.values + (c + 2) * 8 + r, d);
+				_mm_storeu_ps(y.values + (c + 3) * 8 + r, e);
+			}
+		}
+	#endif
+		return y;
+	}
+#endif
+}
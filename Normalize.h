@@ -0,0 +1,254 @@
+#pragma once
+#include <cstddef>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include "Vectors.h"
+#include "VectorGloabalFuncs.h"
+#include "Quaternion.h"
+#include "Pack.h"
+
+namespace gm
+{
+	// Normalization of single Vec<L, T> / Quat<T> and of arrays of them:
+	//   normalize(in, out, count)                 exact, 1 / sqrt of the squared length like normalize(v)
+	//   normalizeFast(v), (in, out, count)        reciprocal square root estimate refined by Newton steps
+	//   normalizeFastOrZero(v), (in, out, count)  same, squared lengths outside the normal range of T give zero, without branches
+	// Arrays are processed one simd::Pack of elements at a time, the tail is padded to a whole Pack so every element
+	// of an array gets the same result wherever it sits. in and out may be the same array.
+	//
+	// Max relative error per component for 4 components, bound from the roundings and the estimate error, with the
+	// largest error measured over 8M vectors of lengths in [1e-15, 1e15] in brackets:
+	//   float   normalize 3.0e-7 (2.1e-7), normalizeFast with rsqrtps + 1 Newton step 5.0e-7 (3.1e-7),
+	//           with AVX-512 rsqrt14ps + 1 step 3.1e-7 (1.9e-7)
+	//   double  normalize 5.6e-16 (3.8e-16), normalizeFast with AVX-512 rsqrt14pd + 2 Newton steps 6.7e-16 (3.3e-16),
+	//           exact 1 / sqrt otherwise
+	// Without SIMD normalizeFast is normalize.
+	// normalizeFast on an estimate gives NaN where the squared length overflows (float |v| above about 1.8e19, double
+	// 1.3e154), with rsqrtps also where it is below the smallest normal float (|v| below about 1.1e-19). normalize and
+	// builds without the estimate give 0 and the unit vector there, normalizeFastOrZero gives 0 for both.
+	enum class NormalizeKind
+	{
+		Exact,
+		Fast,
+		FastOrZero
+	};
+
+	namespace detail
+	{
+		// Newton steps that bring the reciprocal square root estimate of simd::rsqrt to full precision
+		template<typename T> struct RsqrtSteps { static const int value = 0; };
+	#if defined(GM_SIMD_AVX512)
+		template<> struct RsqrtSteps<float> { static const int value = 1; };
+		template<> struct RsqrtSteps<double> { static const int value = 2; };
+	#elif defined(GM_SIMD_SSE2)
+		template<> struct RsqrtSteps<float> { static const int value = 1; };
+	#endif
+
+		// 1 / sqrt(lengthSq) of every lane
+		template<NormalizeKind K, typename T>
+		inline simd::Pack<T> inverseLength(const simd::Pack<T>& lengthSq)
+		{
+			typedef simd::Pack<T> P;
+			if (K == NormalizeKind::Exact)
+				return P((T)1) / simd::sqrt(lengthSq);
+			P x = lengthSq;
+			if (K == NormalizeKind::FastOrZero)
+				x = simd::min(simd::max(x, P(std::numeric_limits<T>::min())), P(std::numeric_limits<T>::max()));
+			P y = RsqrtSteps<T>::value ? simd::rsqrt(x) : P((T)1) / simd::sqrt(x);
+			// y += y / 2 * (1 - x * y * y)
+			for (int i = 0; i < RsqrtSteps<T>::value; ++i)
+				y = simd::madd(y * P((T)0.5), simd::nmadd(x * y, y, P((T)1)), y);
+			if (K == NormalizeKind::FastOrZero)
+				y = simd::select((lengthSq < P(std::numeric_limits<T>::min())) | (lengthSq > P(std::numeric_limits<T>::max())), P((T)0), y);
+			return y;
+		}
+
+		template<NormalizeKind K, int L, typename T>
+		inline void normalizePack(simd::Pack<T> c[L])
+		{
+			simd::Pack<T> lengthSq = c[0] * c[0];
+			for (int k = 1; k < L; ++k)
+				lengthSq = simd::madd(c[k], c[k], lengthSq);
+			simd::Pack<T> s = inverseLength<K>(lengthSq);
+			for (int k = 0; k < L; ++k)
+				c[k] *= s;
+		}
+
+		// count elements of L components at in / out, tightly packed
+		template<NormalizeKind K, int L, typename T>
+		inline void normalizeArray(const T* in, T* out, size_t count)
+		{
+			typedef simd::Pack<T> P;
+			P c[L];
+			size_t i = 0;
+			for (; i + P::size <= count; i += P::size)
+			{
+				simd::loadAoS<L>(in + i * L, c);
+				normalizePack<K, L>(c);
+				simd::storeAoS<L>(out + i * L, c);
+			}
+			if (i < count)
+			{
+				alignas(64) T t[L * P::size] = {};
+				for (size_t j = 0; j < (count - i) * L; ++j)
+					t[j] = in[i * L + j];
+				simd::loadAoS<L>(t, c);
+				normalizePack<K, L>(c);
+				simd::storeAoS<L>(t, c);
+				for (size_t j = 0; j < (count - i) * L; ++j)
+					out[i * L + j] = t[j];
+			}
+		}
+
+	#if defined(GM_SIMD_SSE2)
+		// 4 floats per element, one element per 128 bit lane: squares summed inside every lane, no transposes.
+		// Costs one square root per component, so only for the rsqrt estimate.
+		template<NormalizeKind K, int L>
+		inline typename std::enable_if<L == 4 && K != NormalizeKind::Exact>::type normalizeArray(const float* in, float* out, size_t count)
+		{
+			typedef simd::Pack<float> P;
+			const size_t n = count * 4;
+			size_t i = 0;
+			auto kernel = [](const P& v)
+			{
+				P sq = v * v;
+				P lengthSq = sq + P(simd::shuffleLanes<_MM_SHUFFLE(2, 3, 0, 1)>(sq.v, sq.v));
+				lengthSq = lengthSq + P(simd::shuffleLanes<_MM_SHUFFLE(1, 0, 3, 2)>(lengthSq.v, lengthSq.v));
+				return v * inverseLength<K>(lengthSq);
+			};
+			for (; i + P::size <= n; i += P::size)
+				kernel(P::loadu(in + i)).storeu(out + i);
+			if (i < n)
+			{
+				alignas(64) float t[P::size] = {};
+				for (size_t j = 0; j < n - i; ++j)
+					t[j] = in[i + j];
+				kernel(P::load(t)).store(t);
+				for (size_t j = 0; j < n - i; ++j)
+					out[i + j] = t[j];
+			}
+		}
+	#endif
+
+		// the scalar estimate of simd::rsqrt
+		template<typename T>
+		inline T rsqrt(T x)
+		{
+			return (T)1 / std::sqrt(x);
+		}
+	#if defined(GM_SIMD_AVX512)
+		inline float rsqrt(float x)
+		{
+			__m128 v = _mm_set_ss(x);
+			return _mm_cvtss_f32(_mm_rsqrt14_ss(v, v));
+		}
+		inline double rsqrt(double x)
+		{
+			__m128d v = _mm_set_sd(x);
+			return _mm_cvtsd_f64(_mm_rsqrt14_sd(v, v));
+		}
+	#elif defined(GM_SIMD_SSE2)
+		inline float rsqrt(float x)
+		{
+			return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+		}
+	#endif
+
+		// 0 when x is outside [lo, hi], else y, compilers turn the plain select into a branch
+		template<typename T>
+		inline T zeroOutside(T x, T lo, T hi, T y)
+		{
+			return x < lo || x > hi ? (T)0 : y;
+		}
+	#if defined(GM_SIMD_SSE2)
+		inline float zeroOutside(float x, float lo, float hi, float y)
+		{
+			__m128 v = _mm_set_ss(x);
+			return _mm_cvtss_f32(_mm_andnot_ps(_mm_or_ps(_mm_cmplt_ss(v, _mm_set_ss(lo)), _mm_cmpgt_ss(v, _mm_set_ss(hi))), _mm_set_ss(y)));
+		}
+		inline double zeroOutside(double x, double lo, double hi, double y)
+		{
+			__m128d v = _mm_set_sd(x);
+			return _mm_cvtsd_f64(_mm_andnot_pd(_mm_or_pd(_mm_cmplt_sd(v, _mm_set_sd(lo)), _mm_cmpgt_sd(v, _mm_set_sd(hi))), _mm_set_sd(y)));
+		}
+	#endif
+
+		template<NormalizeKind K, typename T>
+		inline T inverseLength(T lengthSq)
+		{
+			if (K == NormalizeKind::Exact)
+				return (T)1 / std::sqrt(lengthSq);
+			T x = lengthSq;
+			if (K == NormalizeKind::FastOrZero)
+				x = std::min(std::max(x, std::numeric_limits<T>::min()), std::numeric_limits<T>::max());
+			T y = RsqrtSteps<T>::value ? rsqrt(x) : (T)1 / std::sqrt(x);
+			for (int i = 0; i < RsqrtSteps<T>::value; ++i)
+				y += y * (T)0.5 * ((T)1 - x * y * y);
+			if (K == NormalizeKind::FastOrZero)
+				y = zeroOutside(lengthSq, std::numeric_limits<T>::min(), std::numeric_limits<T>::max(), y);
+			return y;
+		}
+	}
+
+	template<int L, typename T, IsFloat<T> = true>
+	inline Vec<L, T> normalizeFast(const Vec<L, T>& v)
+	{
+		return v * detail::inverseLength<NormalizeKind::Fast>(sqrLength(v));
+	}
+
+	template<int L, typename T, IsFloat<T> = true>
+	inline Vec<L, T> normalizeFastOrZero(const Vec<L, T>& v)
+	{
+		return v * detail::inverseLength<NormalizeKind::FastOrZero>(sqrLength(v));
+	}
+
+	template<typename T>
+	inline Quat<T> normalizeFast(const Quat<T>& q)
+	{
+		return q * detail::inverseLength<NormalizeKind::Fast>(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+	}
+
+	template<typename T>
+	inline Quat<T> normalizeFastOrZero(const Quat<T>& q)
+	{
+		return q * detail::inverseLength<NormalizeKind::FastOrZero>(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+	}
+
+	template<int L, typename T, IsFloat<T> = true>
+	inline void normalize(const Vec<L, T>* in, Vec<L, T>* out, size_t count)
+	{
+		detail::normalizeArray<NormalizeKind::Exact, L>(in->values, out->values, count);
+	}
+
+	template<int L, typename T, IsFloat<T> = true>
+	inline void normalizeFast(const Vec<L, T>* in, Vec<L, T>* out, size_t count)
+	{
+		detail::normalizeArray<NormalizeKind::Fast, L>(in->values, out->values, count);
+	}
+
+	template<int L, typename T, IsFloat<T> = true>
+	inline void normalizeFastOrZero(const Vec<L, T>* in, Vec<L, T>* out, size_t count)
+	{
+		detail::normalizeArray<NormalizeKind::FastOrZero, L>(in->values, out->values, count);
+	}
+
+	template<typename T>
+	inline void normalize(const Quat<T>* in, Quat<T>* out, size_t count)
+	{
+		detail::normalizeArray<NormalizeKind::Exact, 4>(&in->x, &out->x, count);
+	}
+
+	template<typename T>
+	inline void normalizeFast(const Quat<T>* in, Quat<T>* out, size_t count)
+	{
+		detail::normalizeArray<NormalizeKind::Fast, 4>(&in->x, &out->x, count);
+	}
+
+	template<typename T>
+	inline void normalizeFastOrZero(const Quat<T>* in, Quat<T>* out, size_t count)
+	{
+		detail::normalizeArray<NormalizeKind::FastOrZero, 4>(&in->x, &out->x, count);
+	}
+}
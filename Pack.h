@@ -0,0 +1,590 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "SIMD.h"
+
+namespace gm
+{
+	namespace simd
+	{
+		// Widest register of T the target supports:
+		// float is 16/8/4 lanes with AVX-512/AVX/SSE2, double 8/4/2, anything else 1.
+		// Pack<T>::Mask is the result of comparisons, bits() packs it into one bit per lane.
+		template<typename T>
+		struct Pack
+		{
+			static const int size = 1;
+			typedef bool Mask;
+			T v;
+
+			inline Pack() = default;
+			inline Pack(T x) : v(x) {}
+
+			static inline Pack load(const T* p) { return Pack(*p); }
+			static inline Pack loadu(const T* p) { return Pack(*p); }
+			inline void store(T* p) const { *p = v; }
+			inline void storeu(T* p) const { *p = v; }
+			inline void stream(T* p) const { *p = v; }
+			inline T operator[](int) const { return v; }
+
+			inline Pack operator-() const { return Pack(-v); }
+			inline Pack operator+(const Pack& b) const { return Pack(v + b.v); }
+			inline Pack operator-(const Pack& b) const { return Pack(v - b.v); }
+			inline Pack operator*(const Pack& b) const { return Pack(v * b.v); }
+			inline Pack operator/(const Pack& b) const { return Pack(v / b.v); }
+			inline Pack& operator+=(const Pack& b) { v += b.v; return *this; }
+			inline Pack& operator-=(const Pack& b) { v -= b.v; return *this; }
+			inline Pack& operator*=(const Pack& b) { v *= b.v; return *this; }
+			inline Pack& operator/=(const Pack& b) { v /= b.v; return *this; }
+
+			inline Mask operator<(const Pack& b) const { return v < b.v; }
+			inline Mask operator<=(const Pack& b) const { return v <= b.v; }
+			inline Mask operator>(const Pack& b) const { return v > b.v; }
+			inline Mask operator>=(const Pack& b) const { return v >= b.v; }
+			inline Mask operator==(const Pack& b) const { return v == b.v; }
+			inline Mask operator!=(const Pack& b) const { return v != b.v; }
+		};
+
+		template<typename T> inline Pack<T> madd(const Pack<T>& a, const Pack<T>& b, const Pack<T>& c) { return Pack<T>(a.v * b.v + c.v); }
+		template<typename T> inline Pack<T> nmadd(const Pack<T>& a, const Pack<T>& b, const Pack<T>& c) { return Pack<T>(c.v - a.v * b.v); }
+		template<typename T> inline Pack<T> min(const Pack<T>& a, const Pack<T>& b) { return Pack<T>(b.v < a.v ? b.v : a.v); }
+		template<typename T> inline Pack<T> max(const Pack<T>& a, const Pack<T>& b) { return Pack<T>(a.v < b.v ? b.v : a.v); }
+		template<typename T> inline Pack<T> abs(const Pack<T>& a) { return Pack<T>(std::abs(a.v)); }
+		template<typename T> inline Pack<T> sqrt(const Pack<T>& a) { return Pack<T>(std::sqrt(a.v)); }
+		template<typename T> inline Pack<T> rsqrt(const Pack<T>& a) { return Pack<T>((T)1 / std::sqrt(a.v)); }
+		template<typename T> inline Pack<T> rcp(const Pack<T>& a) { return Pack<T>((T)1 / a.v); }
+		template<typename T> inline Pack<T> floor(const Pack<T>& a) { return Pack<T>(std::floor(a.v)); }
+		template<typename T> inline Pack<T> ceil(const Pack<T>& a) { return Pack<T>(std::ceil(a.v)); }
+		template<typename T> inline Pack<T> round(const Pack<T>& a) { return Pack<T>(std::nearbyint(a.v)); }
+		template<typename T> inline Pack<T> select(bool m, const Pack<T>& a, const Pack<T>& b) { return m ? a : b; }
+		inline unsigned bits(bool m) { return m ? 1u : 0u; }
+		// Exponent access for normal, finite x:
+		// ldexp(x, n) = x * 2^n with n integral and in the normal exponent range of T,
+		// logb(x) = floor(log2(|x|)), significand(x) = |x| / 2^logb(x) in [1, 2).
+		template<typename T> inline Pack<T> ldexp(const Pack<T>& x, const Pack<T>& n) { return Pack<T>(std::ldexp(x.v, (int)n.v)); }
+		template<typename T> inline Pack<T> logb(const Pack<T>& x) { return Pack<T>(std::logb(x.v)); }
+		template<typename T> inline Pack<T> significand(const Pack<T>& x) { int e; return Pack<T>(std::frexp(std::abs(x.v), &e) * (T)2); }
+
+
+#define GM_PACK_COMMON(T, Reg, P, S, W)																\
+			static const int size = W;																\
+			Reg v;																					\
+																									\
+			inline Pack() = default;																\
+			inline Pack(Reg x) : v(x) {}															\
+			inline Pack(T x) : v(P##set1_##S(x)) {}												\
+			inline operator Reg() const { return v; }												\
+																									\
+			static inline Pack load(const T* p) { return P##load_##S(p); }							\
+			static inline Pack loadu(const T* p) { return P##loadu_##S(p); }						\
+			inline void store(T* p) const { P##store_##S(p, v); }									\
+			inline void storeu(T* p) const { P##storeu_##S(p, v); }									\
+			inline void stream(T* p) const { P##stream_##S(p, v); }									\
+			inline T operator[](int i) const { alignas(64) T t[W]; store(t); return t[i]; }			\
+																									\
+			inline Pack operator-() const { return P##xor_##S(v, P##set1_##S((T)-0.0)); }			\
+			inline Pack operator+(const Pack& b) const { return P##add_##S(v, b.v); }				\
+			inline Pack operator-(const Pack& b) const { return P##sub_##S(v, b.v); }				\
+			inline Pack operator*(const Pack& b) const { return P##mul_##S(v, b.v); }				\
+			inline Pack operator/(const Pack& b) const { return P##div_##S(v, b.v); }				\
+			inline Pack& operator+=(const Pack& b) { v = P##add_##S(v, b.v); return *this; }		\
+			inline Pack& operator-=(const Pack& b) { v = P##sub_##S(v, b.v); return *this; }		\
+			inline Pack& operator*=(const Pack& b) { v = P##mul_##S(v, b.v); return *this; }		\
+			inline Pack& operator/=(const Pack& b) { v = P##div_##S(v, b.v); return *this; }
+
+#define GM_PACK_FUNCS(T, P, S)																		\
+		inline Pack<T> min(const Pack<T>& a, const Pack<T>& b) { return P##min_##S(a.v, b.v); }		\
+		inline Pack<T> max(const Pack<T>& a, const Pack<T>& b) { return P##max_##S(a.v, b.v); }		\
+		inline Pack<T> sqrt(const Pack<T>& a) { return P##sqrt_##S(a.v); }							\
+		inline Pack<T> abs(const Pack<T>& a) { return P##andnot_##S(P##set1_##S((T)-0.0), a.v); }
+
+#if defined(GM_SIMD_FMA)
+	#define GM_PACK_MADD(T, P, S)																	\
+		inline Pack<T> madd(const Pack<T>& a, const Pack<T>& b, const Pack<T>& c) { return P##fmadd_##S(a.v, b.v, c.v); }		\
+		inline Pack<T> nmadd(const Pack<T>& a, const Pack<T>& b, const Pack<T>& c) { return P##fnmadd_##S(a.v, b.v, c.v); }
+#else
+	#define GM_PACK_MADD(T, P, S)																	\
+		inline Pack<T> madd(const Pack<T>& a, const Pack<T>& b, const Pack<T>& c) { return P##add_##S(P##mul_##S(a.v, b.v), c.v); }		\
+		inline Pack<T> nmadd(const Pack<T>& a, const Pack<T>& b, const Pack<T>& c) { return P##sub_##S(c.v, P##mul_##S(a.v, b.v)); }
+#endif
+
+// compare / select through full-width lane masks (SSE and AVX)
+#define GM_PACK_VECTOR_MASK(T, Reg, P, S, CMP)														\
+			struct Mask																				\
+			{																						\
+				Reg v;																				\
+				inline Mask(Reg x) : v(x) {}														\
+				inline Mask operator&(const Mask& b) const { return P##and_##S(v, b.v); }			\
+				inline Mask operator|(const Mask& b) const { return P##or_##S(v, b.v); }			\
+				inline Mask operator^(const Mask& b) const { return P##xor_##S(v, b.v); }			\
+				inline Mask operator~() const { return P##xor_##S(v, P##castsi##CMP##_##S(P##set1_epi32(-1))); }	\
+			};																						\
+			inline Mask operator<(const Pack& b) const { return GM_PACK_CMP_##CMP(P, S, v, b.v, LT); }		\
+			inline Mask operator<=(const Pack& b) const { return GM_PACK_CMP_##CMP(P, S, v, b.v, LE); }	\
+			inline Mask operator>(const Pack& b) const { return GM_PACK_CMP_##CMP(P, S, b.v, v, LT); }		\
+			inline Mask operator>=(const Pack& b) const { return GM_PACK_CMP_##CMP(P, S, b.v, v, LE); }	\
+			inline Mask operator==(const Pack& b) const { return GM_PACK_CMP_##CMP(P, S, v, b.v, EQ); }	\
+			inline Mask operator!=(const Pack& b) const { return GM_PACK_CMP_##CMP(P, S, v, b.v, NEQ); }
+
+#define GM_PACK_CMP_128(P, S, a, b, OP) GM_PACK_CMP128_##OP(S, a, b)
+#define GM_PACK_CMP128_LT(S, a, b) _mm_cmplt_##S(a, b)
+#define GM_PACK_CMP128_LE(S, a, b) _mm_cmple_##S(a, b)
+#define GM_PACK_CMP128_EQ(S, a, b) _mm_cmpeq_##S(a, b)
+#define GM_PACK_CMP128_NEQ(S, a, b) _mm_cmpneq_##S(a, b)
+#define GM_PACK_CMP_256(P, S, a, b, OP) _mm256_cmp_##S(a, b, GM_PACK_CMPI_##OP)
+#define GM_PACK_CMP_512(P, S, a, b, OP) _mm512_cmp_##S##_mask(a, b, GM_PACK_CMPI_##OP)
+#define GM_PACK_CMPI_LT _CMP_LT_OQ
+#define GM_PACK_CMPI_LE _CMP_LE_OQ
+#define GM_PACK_CMPI_EQ _CMP_EQ_OQ
+#define GM_PACK_CMPI_NEQ _CMP_NEQ_UQ
+
+// ldexp / logb / significand through the IEEE bit layout: M mantissa bits, exponent BIAS,
+// n + 2^M + BIAS holds the biased exponent in its low mantissa bits, shifting it left by M gives 2^n.
+#define GM_PACK_EXPONENT(T, P, S, SI, SHL, SHR, MANT_MASK, M, BIAS, TWO_M)											\
+		inline Pack<T> ldexp(const Pack<T>& x, const Pack<T>& n)														\
+		{																											\
+			Pack<T> e = n + Pack<T>((T)(TWO_M + BIAS));																\
+			return x * Pack<T>(P##castsi##SI##_##S(SHL(P##cast##S##_si##SI(e.v), M)));								\
+		}																											\
+		inline Pack<T> logb(const Pack<T>& x)																		\
+		{																											\
+			Pack<T> e = P##castsi##SI##_##S(SHR(P##cast##S##_si##SI(abs(x).v), M));									\
+			return Pack<T>(P##or_##S(e.v, P##set1_##S((T)TWO_M))) - Pack<T>((T)(TWO_M + BIAS));						\
+		}																											\
+		inline Pack<T> significand(const Pack<T>& x)																	\
+		{																											\
+			return P##or_##S(P##and_##S(x.v, P##castsi##SI##_##S(MANT_MASK)), P##set1_##S((T)1));					\
+		}
+
+// compare / select through k-registers (AVX-512)
+#define GM_PACK_K_MASK(K, S)																		\
+			struct Mask																				\
+			{																						\
+				K v;																				\
+				inline Mask(K x) : v(x) {}															\
+				inline Mask operator&(const Mask& b) const { return (K)(v & b.v); }					\
+				inline Mask operator|(const Mask& b) const { return (K)(v | b.v); }					\
+				inline Mask operator^(const Mask& b) const { return (K)(v ^ b.v); }					\
+				inline Mask operator~() const { return (K)~v; }										\
+			};																						\
+			inline Mask operator<(const Pack& b) const { return GM_PACK_CMP_512(, S, v, b.v, LT); }		\
+			inline Mask operator<=(const Pack& b) const { return GM_PACK_CMP_512(, S, v, b.v, LE); }	\
+			inline Mask operator>(const Pack& b) const { return GM_PACK_CMP_512(, S, b.v, v, LT); }		\
+			inline Mask operator>=(const Pack& b) const { return GM_PACK_CMP_512(, S, b.v, v, LE); }	\
+			inline Mask operator==(const Pack& b) const { return GM_PACK_CMP_512(, S, v, b.v, EQ); }	\
+			inline Mask operator!=(const Pack& b) const { return GM_PACK_CMP_512(, S, v, b.v, NEQ); }
+
+
+#if defined(GM_SIMD_AVX512)
+		template<>
+		struct Pack<float>
+		{
+			GM_PACK_COMMON(float, __m512, _mm512_, ps, 16)
+			GM_PACK_K_MASK(__mmask16, ps)
+		};
+		template<>
+		struct Pack<double>
+		{
+			GM_PACK_COMMON(double, __m512d, _mm512_, pd, 8)
+			GM_PACK_K_MASK(__mmask8, pd)
+		};
+
+		GM_PACK_FUNCS(float, _mm512_, ps)
+		GM_PACK_FUNCS(double, _mm512_, pd)
+		GM_PACK_MADD(float, _mm512_, ps)
+		GM_PACK_MADD(double, _mm512_, pd)
+
+		inline Pack<float> select(Pack<float>::Mask m, const Pack<float>& a, const Pack<float>& b) { return _mm512_mask_blend_ps(m.v, b.v, a.v); }
+		inline Pack<double> select(Pack<double>::Mask m, const Pack<double>& a, const Pack<double>& b) { return _mm512_mask_blend_pd(m.v, b.v, a.v); }
+		inline unsigned bits(Pack<float>::Mask m) { return m.v; }
+		inline unsigned bits(Pack<double>::Mask m) { return m.v; }
+		inline Pack<float> floor(const Pack<float>& a) { return _mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+		inline Pack<float> ceil(const Pack<float>& a) { return _mm512_roundscale_ps(a.v, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC); }
+		inline Pack<float> round(const Pack<float>& a) { return _mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		inline Pack<double> floor(const Pack<double>& a) { return _mm512_roundscale_pd(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+		inline Pack<double> ceil(const Pack<double>& a) { return _mm512_roundscale_pd(a.v, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC); }
+		inline Pack<double> round(const Pack<double>& a) { return _mm512_roundscale_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		inline Pack<float> rsqrt(const Pack<float>& a) { return _mm512_rsqrt14_ps(a.v); }
+		inline Pack<float> rcp(const Pack<float>& a) { return _mm512_rcp14_ps(a.v); }
+		inline Pack<double> rsqrt(const Pack<double>& a) { return _mm512_rsqrt14_pd(a.v); }
+		inline Pack<double> rcp(const Pack<double>& a) { return _mm512_rcp14_pd(a.v); }
+		inline Pack<float> ldexp(const Pack<float>& x, const Pack<float>& n) { return _mm512_scalef_ps(x.v, n.v); }
+		inline Pack<double> ldexp(const Pack<double>& x, const Pack<double>& n) { return _mm512_scalef_pd(x.v, n.v); }
+		inline Pack<float> logb(const Pack<float>& x) { return _mm512_getexp_ps(x.v); }
+		inline Pack<double> logb(const Pack<double>& x) { return _mm512_getexp_pd(x.v); }
+		inline Pack<float> significand(const Pack<float>& x) { return _mm512_getmant_ps(x.v, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero); }
+		inline Pack<double> significand(const Pack<double>& x) { return _mm512_getmant_pd(x.v, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero); }
+
+#elif defined(GM_SIMD_AVX)
+		template<>
+		struct Pack<float>
+		{
+			GM_PACK_COMMON(float, __m256, _mm256_, ps, 8)
+			GM_PACK_VECTOR_MASK(float, __m256, _mm256_, ps, 256)
+		};
+		template<>
+		struct Pack<double>
+		{
+			GM_PACK_COMMON(double, __m256d, _mm256_, pd, 4)
+			GM_PACK_VECTOR_MASK(double, __m256d, _mm256_, pd, 256)
+		};
+
+		GM_PACK_FUNCS(float, _mm256_, ps)
+		GM_PACK_FUNCS(double, _mm256_, pd)
+		GM_PACK_MADD(float, _mm256_, ps)
+		GM_PACK_MADD(double, _mm256_, pd)
+
+	#if defined(GM_SIMD_AVX2)
+		inline Pack<float> select(Pack<float>::Mask m, const Pack<float>& a, const Pack<float>& b) { return _mm256_blendv_ps(b.v, a.v, m.v); }
+		inline Pack<double> select(Pack<double>::Mask m, const Pack<double>& a, const Pack<double>& b) { return _mm256_blendv_pd(b.v, a.v, m.v); }
+	#else
+		// GCC lowers blendv to a sign test of 256 bit integers, which plain AVX does lane by lane
+		inline Pack<float> select(Pack<float>::Mask m, const Pack<float>& a, const Pack<float>& b) { return _mm256_or_ps(_mm256_and_ps(m.v, a.v), _mm256_andnot_ps(m.v, b.v)); }
+		inline Pack<double> select(Pack<double>::Mask m, const Pack<double>& a, const Pack<double>& b) { return _mm256_or_pd(_mm256_and_pd(m.v, a.v), _mm256_andnot_pd(m.v, b.v)); }
+	#endif
+		inline unsigned bits(Pack<float>::Mask m) { return (unsigned)_mm256_movemask_ps(m.v); }
+		inline unsigned bits(Pack<double>::Mask m) { return (unsigned)_mm256_movemask_pd(m.v); }
+		inline Pack<float> floor(const Pack<float>& a) { return _mm256_floor_ps(a.v); }
+		inline Pack<float> ceil(const Pack<float>& a) { return _mm256_ceil_ps(a.v); }
+		inline Pack<float> round(const Pack<float>& a) { return _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		inline Pack<double> floor(const Pack<double>& a) { return _mm256_floor_pd(a.v); }
+		inline Pack<double> ceil(const Pack<double>& a) { return _mm256_ceil_pd(a.v); }
+		inline Pack<double> round(const Pack<double>& a) { return _mm256_round_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		inline Pack<float> rsqrt(const Pack<float>& a) { return _mm256_rsqrt_ps(a.v); }
+		inline Pack<float> rcp(const Pack<float>& a) { return _mm256_rcp_ps(a.v); }
+		inline Pack<double> rsqrt(const Pack<double>& a) { return _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(a.v)); }
+		inline Pack<double> rcp(const Pack<double>& a) { return _mm256_div_pd(_mm256_set1_pd(1.0), a.v); }
+
+	#if defined(GM_SIMD_AVX2)
+		GM_FORCEINLINE __m256i shiftLeft32(__m256i a, int n) { return _mm256_slli_epi32(a, n); }
+		GM_FORCEINLINE __m256i shiftRight32(__m256i a, int n) { return _mm256_srli_epi32(a, n); }
+		GM_FORCEINLINE __m256i shiftLeft64(__m256i a, int n) { return _mm256_slli_epi64(a, n); }
+		GM_FORCEINLINE __m256i shiftRight64(__m256i a, int n) { return _mm256_srli_epi64(a, n); }
+	#else
+		// AVX has no 256 bit integer shifts, shift both halves
+		#define GM_SPLIT_SHIFT(name, op)																				\
+			GM_FORCEINLINE __m256i name(__m256i a, int n)																\
+			{																										\
+				__m128i lo = op(_mm256_castsi256_si128(a), n), hi = op(_mm256_extractf128_si256(a, 1), n);			\
+				return _mm256_insertf128_si256(_mm256_castsi128_si256(lo), hi, 1);									\
+			}
+		GM_SPLIT_SHIFT(shiftLeft32, _mm_slli_epi32)
+		GM_SPLIT_SHIFT(shiftRight32, _mm_srli_epi32)
+		GM_SPLIT_SHIFT(shiftLeft64, _mm_slli_epi64)
+		GM_SPLIT_SHIFT(shiftRight64, _mm_srli_epi64)
+		#undef GM_SPLIT_SHIFT
+	#endif
+		GM_PACK_EXPONENT(float, _mm256_, ps, 256, shiftLeft32, shiftRight32, _mm256_set1_epi32(0x007FFFFF), 23, 127, 8388608.0)
+		GM_PACK_EXPONENT(double, _mm256_, pd, 256, shiftLeft64, shiftRight64, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFll), 52, 1023, 4503599627370496.0)
+
+#elif defined(GM_SIMD_SSE2)
+		template<>
+		struct Pack<float>
+		{
+			GM_PACK_COMMON(float, __m128, _mm_, ps, 4)
+			GM_PACK_VECTOR_MASK(float, __m128, _mm_, ps, 128)
+		};
+		template<>
+		struct Pack<double>
+		{
+			GM_PACK_COMMON(double, __m128d, _mm_, pd, 2)
+			GM_PACK_VECTOR_MASK(double, __m128d, _mm_, pd, 128)
+		};
+
+		GM_PACK_FUNCS(float, _mm_, ps)
+		GM_PACK_FUNCS(double, _mm_, pd)
+		GM_PACK_MADD(float, _mm_, ps)
+		GM_PACK_MADD(double, _mm_, pd)
+
+	#if defined(GM_SIMD_SSE4)
+		inline Pack<float> select(Pack<float>::Mask m, const Pack<float>& a, const Pack<float>& b) { return _mm_blendv_ps(b.v, a.v, m.v); }
+		inline Pack<double> select(Pack<double>::Mask m, const Pack<double>& a, const Pack<double>& b) { return _mm_blendv_pd(b.v, a.v, m.v); }
+		inline Pack<float> floor(const Pack<float>& a) { return _mm_floor_ps(a.v); }
+		inline Pack<float> ceil(const Pack<float>& a) { return _mm_ceil_ps(a.v); }
+		inline Pack<float> round(const Pack<float>& a) { return _mm_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		inline Pack<double> floor(const Pack<double>& a) { return _mm_floor_pd(a.v); }
+		inline Pack<double> ceil(const Pack<double>& a) { return _mm_ceil_pd(a.v); }
+		inline Pack<double> round(const Pack<double>& a) { return _mm_round_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+	#else
+		inline Pack<float> select(Pack<float>::Mask m, const Pack<float>& a, const Pack<float>& b) { return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)); }
+		inline Pack<double> select(Pack<double>::Mask m, const Pack<double>& a, const Pack<double>& b) { return _mm_or_pd(_mm_and_pd(m.v, a.v), _mm_andnot_pd(m.v, b.v)); }
+		// round to nearest through the 2^23 / 2^52 trick, valid for the full range
+		inline Pack<float> round(const Pack<float>& a)
+		{
+			Pack<float> magic = _mm_or_ps(_mm_and_ps(a.v, _mm_set1_ps(-0.0f)), _mm_set1_ps(8388608.0f));
+			Pack<float> r = (a + magic) - magic;
+			return select(abs(a) < Pack<float>(8388608.0f), r, a);
+		}
+		inline Pack<double> round(const Pack<double>& a)
+		{
+			Pack<double> magic = _mm_or_pd(_mm_and_pd(a.v, _mm_set1_pd(-0.0)), _mm_set1_pd(4503599627370496.0));
+			Pack<double> r = (a + magic) - magic;
+			return select(abs(a) < Pack<double>(4503599627370496.0), r, a);
+		}
+		inline Pack<float> floor(const Pack<float>& a) { Pack<float> r = round(a); return r - Pack<float>(_mm_and_ps((a < r).v, _mm_set1_ps(1.0f))); }
+		inline Pack<float> ceil(const Pack<float>& a) { Pack<float> r = round(a); return r + Pack<float>(_mm_and_ps((r < a).v, _mm_set1_ps(1.0f))); }
+		inline Pack<double> floor(const Pack<double>& a) { Pack<double> r = round(a); return r - Pack<double>(_mm_and_pd((a < r).v, _mm_set1_pd(1.0))); }
+		inline Pack<double> ceil(const Pack<double>& a) { Pack<double> r = round(a); return r + Pack<double>(_mm_and_pd((r < a).v, _mm_set1_pd(1.0))); }
+	#endif
+		inline unsigned bits(Pack<float>::Mask m) { return (unsigned)_mm_movemask_ps(m.v); }
+		inline unsigned bits(Pack<double>::Mask m) { return (unsigned)_mm_movemask_pd(m.v); }
+		inline Pack<float> rsqrt(const Pack<float>& a) { return _mm_rsqrt_ps(a.v); }
+		inline Pack<float> rcp(const Pack<float>& a) { return _mm_rcp_ps(a.v); }
+		inline Pack<double> rsqrt(const Pack<double>& a) { return _mm_div_pd(_mm_set1_pd(1.0), _mm_sqrt_pd(a.v)); }
+		inline Pack<double> rcp(const Pack<double>& a) { return _mm_div_pd(_mm_set1_pd(1.0), a.v); }
+		GM_PACK_EXPONENT(float, _mm_, ps, 128, _mm_slli_epi32, _mm_srli_epi32, _mm_set1_epi32(0x007FFFFF), 23, 127, 8388608.0)
+		GM_PACK_EXPONENT(double, _mm_, pd, 128, _mm_slli_epi64, _mm_srli_epi64, _mm_set1_epi64x(0x000FFFFFFFFFFFFFll), 52, 1023, 4503599627370496.0)
+#endif
+
+		template<typename T>
+		inline bool any(const T& m) { return bits(m) != 0; }
+
+		inline void streamFence()
+		{
+		#if defined(GM_SIMD_SSE2)
+			_mm_sfence();
+		#endif
+		}
+
+
+		#pragma region AoS
+		// Pack<T>::size consecutive xyz triples / xyzw quadruples <-> one Pack per component.
+		template<typename T>
+		inline void loadAoS3(const T* p, Pack<T>& x, Pack<T>& y, Pack<T>& z)
+		{
+			alignas(64) T t[3][Pack<T>::size];
+			for (int i = 0; i < Pack<T>::size; ++i)
+				for (int c = 0; c < 3; ++c)
+					t[c][i] = p[i * 3 + c];
+			x = Pack<T>::load(t[0]);
+			y = Pack<T>::load(t[1]);
+			z = Pack<T>::load(t[2]);
+		}
+
+		template<typename T>
+		inline void storeAoS3(T* p, const Pack<T>& x, const Pack<T>& y, const Pack<T>& z, bool = false)
+		{
+			alignas(64) T t[3][Pack<T>::size];
+			x.store(t[0]);
+			y.store(t[1]);
+			z.store(t[2]);
+			for (int i = 0; i < Pack<T>::size; ++i)
+				for (int c = 0; c < 3; ++c)
+					p[i * 3 + c] = t[c][i];
+		}
+
+		template<typename T>
+		inline void loadAoS4(const T* p, Pack<T>& x, Pack<T>& y, Pack<T>& z, Pack<T>& w)
+		{
+			alignas(64) T t[4][Pack<T>::size];
+			for (int i = 0; i < Pack<T>::size; ++i)
+				for (int c = 0; c < 4; ++c)
+					t[c][i] = p[i * 4 + c];
+			x = Pack<T>::load(t[0]);
+			y = Pack<T>::load(t[1]);
+			z = Pack<T>::load(t[2]);
+			w = Pack<T>::load(t[3]);
+		}
+
+		template<typename T>
+		inline void storeAoS4(T* p, const Pack<T>& x, const Pack<T>& y, const Pack<T>& z, const Pack<T>& w, bool = false)
+		{
+			alignas(64) T t[4][Pack<T>::size];
+			x.store(t[0]);
+			y.store(t[1]);
+			z.store(t[2]);
+			w.store(t[3]);
+			for (int i = 0; i < Pack<T>::size; ++i)
+				for (int c = 0; c < 4; ++c)
+					p[i * 4 + c] = t[c][i];
+		}
+
+#if defined(GM_SIMD_SSE2)
+		// Every 128 bit lane holds 4 triples: a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3.
+	#define GM_LANE_SHUFFLE(R, P)												\
+		template<int I> GM_FORCEINLINE R shuffleLanes(R a, R b) { return P##shuffle_ps(a, b, I); }		\
+		GM_FORCEINLINE R unpackLoLanes(R a, R b) { return P##unpacklo_ps(a, b); }				\
+		GM_FORCEINLINE R unpackHiLanes(R a, R b) { return P##unpackhi_ps(a, b); }
+
+		GM_LANE_SHUFFLE(__m128, _mm_)
+	#if defined(GM_SIMD_AVX)
+		GM_LANE_SHUFFLE(__m256, _mm256_)
+	#endif
+	#if defined(GM_SIMD_AVX512)
+		GM_LANE_SHUFFLE(__m512, _mm512_)
+	#endif
+	#undef GM_LANE_SHUFFLE
+
+		template<typename R>
+		GM_FORCEINLINE void deinterleave3(R a, R b, R c, R& x, R& y, R& z)
+		{
+			x = shuffleLanes<_MM_SHUFFLE(2, 0, 3, 0)>(a, shuffleLanes<_MM_SHUFFLE(1, 1, 2, 2)>(b, c));
+			y = shuffleLanes<_MM_SHUFFLE(2, 0, 2, 0)>(shuffleLanes<_MM_SHUFFLE(0, 0, 1, 1)>(a, b), shuffleLanes<_MM_SHUFFLE(2, 2, 3, 3)>(b, c));
+			z = shuffleLanes<_MM_SHUFFLE(3, 0, 2, 0)>(shuffleLanes<_MM_SHUFFLE(1, 1, 2, 2)>(a, b), c);
+		}
+
+		template<typename R>
+		GM_FORCEINLINE void interleave3(R x, R y, R z, R& a, R& b, R& c)
+		{
+			a = shuffleLanes<_MM_SHUFFLE(2, 0, 1, 0)>(unpackLoLanes(x, y), shuffleLanes<_MM_SHUFFLE(1, 1, 0, 0)>(z, x));
+			b = shuffleLanes<_MM_SHUFFLE(2, 0, 2, 0)>(shuffleLanes<_MM_SHUFFLE(1, 1, 1, 1)>(y, z), shuffleLanes<_MM_SHUFFLE(2, 2, 2, 2)>(x, y));
+			c = shuffleLanes<_MM_SHUFFLE(2, 0, 2, 0)>(shuffleLanes<_MM_SHUFFLE(3, 3, 2, 2)>(z, x), shuffleLanes<_MM_SHUFFLE(3, 3, 3, 3)>(y, z));
+		}
+
+		// 4x4 transpose inside every 128 bit lane, its own inverse
+		template<typename R>
+		GM_FORCEINLINE void transpose4(R& a, R& b, R& c, R& d)
+		{
+			R t0 = unpackLoLanes(a, b), t1 = unpackLoLanes(c, d);
+			R t2 = unpackHiLanes(a, b), t3 = unpackHiLanes(c, d);
+			a = shuffleLanes<_MM_SHUFFLE(1, 0, 1, 0)>(t0, t1);
+			b = shuffleLanes<_MM_SHUFFLE(3, 2, 3, 2)>(t0, t1);
+			c = shuffleLanes<_MM_SHUFFLE(1, 0, 1, 0)>(t2, t3);
+			d = shuffleLanes<_MM_SHUFFLE(3, 2, 3, 2)>(t2, t3);
+		}
+
+		GM_FORCEINLINE void store128(float* p, __m128 v, bool stream)
+		{
+			if (stream)
+				_mm_stream_ps(p, v);
+			else
+				_mm_storeu_ps(p, v);
+		}
+
+		// Lane group k of the result is loaded from / stored to p + k * Stride.
+	#if defined(GM_SIMD_AVX512)
+		template<int Stride>
+		GM_FORCEINLINE __m512 loadLanes(const float* p)
+		{
+			__m512 r = _mm512_castps128_ps512(_mm_loadu_ps(p));
+			r = _mm512_insertf32x4(r, _mm_loadu_ps(p + Stride), 1);
+			r = _mm512_insertf32x4(r, _mm_loadu_ps(p + 2 * Stride), 2);
+			return _mm512_insertf32x4(r, _mm_loadu_ps(p + 3 * Stride), 3);
+		}
+		template<int Stride>
+		GM_FORCEINLINE void storeLanes(float* p, __m512 v, bool stream)
+		{
+			store128(p, _mm512_castps512_ps128(v), stream);
+			store128(p + Stride, _mm512_extractf32x4_ps(v, 1), stream);
+			store128(p + 2 * Stride, _mm512_extractf32x4_ps(v, 2), stream);
+			store128(p + 3 * Stride, _mm512_extractf32x4_ps(v, 3), stream);
+		}
+	#elif defined(GM_SIMD_AVX)
+		template<int Stride>
+		GM_FORCEINLINE __m256 loadLanes(const float* p)
+		{
+			return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + Stride), 1);
+		}
+		template<int Stride>
+		GM_FORCEINLINE void storeLanes(float* p, __m256 v, bool stream)
+		{
+			store128(p, _mm256_castps256_ps128(v), stream);
+			store128(p + Stride, _mm256_extractf128_ps(v, 1), stream);
+		}
+	#else
+		template<int Stride>
+		GM_FORCEINLINE __m128 loadLanes(const float* p)
+		{
+			return _mm_loadu_ps(p);
+		}
+		template<int Stride>
+		GM_FORCEINLINE void storeLanes(float* p, __m128 v, bool stream)
+		{
+			store128(p, v, stream);
+		}
+	#endif
+
+		inline void loadAoS3(const float* p, Pack<float>& x, Pack<float>& y, Pack<float>& z)
+		{
+			deinterleave3(loadLanes<12>(p), loadLanes<12>(p + 4), loadLanes<12>(p + 8), x.v, y.v, z.v);
+		}
+
+		// stream requires p to be 16 byte aligned
+		inline void storeAoS3(float* p, const Pack<float>& x, const Pack<float>& y, const Pack<float>& z, bool stream = false)
+		{
+			Pack<float> a, b, c;
+			interleave3(x.v, y.v, z.v, a.v, b.v, c.v);
+			storeLanes<12>(p, a.v, stream);
+			storeLanes<12>(p + 4, b.v, stream);
+			storeLanes<12>(p + 8, c.v, stream);
+		}
+
+		inline void loadAoS4(const float* p, Pack<float>& x, Pack<float>& y, Pack<float>& z, Pack<float>& w)
+		{
+			x.v = loadLanes<16>(p);
+			y.v = loadLanes<16>(p + 4);
+			z.v = loadLanes<16>(p + 8);
+			w.v = loadLanes<16>(p + 12);
+			transpose4(x.v, y.v, z.v, w.v);
+		}
+
+		// stream requires p to be 16 byte aligned
+		inline void storeAoS4(float* p, Pack<float> x, Pack<float> y, Pack<float> z, Pack<float> w, bool stream = false)
+		{
+			transpose4(x.v, y.v, z.v, w.v);
+			storeLanes<16>(p, x.v, stream);
+			storeLanes<16>(p + 4, y.v, stream);
+			storeLanes<16>(p + 8, z.v, stream);
+			storeLanes<16>(p + 12, w.v, stream);
+		}
+#endif
+
+		// Pack<T>::size consecutive elements of L components <-> one Pack per component
+		template<int L, typename T>
+		inline void loadAoS(const T* p, Pack<T> c[L])
+		{
+			if (L == 3)
+				loadAoS3(p, c[0], c[1], c[2]);
+			else if (L == 4)
+				loadAoS4(p, c[0], c[1], c[2], c[3]);
+			else
+			{
+				alignas(64) T t[L][Pack<T>::size];
+				for (int i = 0; i < Pack<T>::size; ++i)
+					for (int k = 0; k < L; ++k)
+						t[k][i] = p[i * L + k];
+				for (int k = 0; k < L; ++k)
+					c[k] = Pack<T>::load(t[k]);
+			}
+		}
+
+		// stream requires p to be 16 byte aligned, it only applies to float triples / quadruples
+		template<int L, typename T>
+		inline void storeAoS(T* p, const Pack<T> c[L], bool stream = false)
+		{
+			if (L == 3)
+				storeAoS3(p, c[0], c[1], c[2], stream);
+			else if (L == 4)
+				storeAoS4(p, c[0], c[1], c[2], c[3], stream);
+			else
+			{
+				alignas(64) T t[L][Pack<T>::size];
+				for (int k = 0; k < L; ++k)
+					c[k].store(t[k]);
+				for (int i = 0; i < Pack<T>::size; ++i)
+					for (int k = 0; k < L; ++k)
+						p[i * L + k] = t[k][i];
+			}
+		}
+		#pragma endregion AoS
+
+#undef GM_PACK_COMMON
+#undef GM_PACK_FUNCS
+#undef GM_PACK_MADD
+#undef GM_PACK_EXPONENT
+#undef GM_PACK_VECTOR_MASK
+#undef GM_PACK_K_MASK
+#undef GM_PACK_CMP_128
+#undef GM_PACK_CMP128_LT
+#undef GM_PACK_CMP128_LE
+#undef GM_PACK_CMP128_EQ
+#undef GM_PACK_CMP128_NEQ
+#undef GM_PACK_CMP_256
+#undef GM_PACK_CMP_512
+#undef GM_PACK_CMPI_LT
+#undef GM_PACK_CMPI_LE
+#undef GM_PACK_CMPI_EQ
+#undef GM_PACK_CMPI_NEQ
+	}
+}
@@ -0,0 +1,261 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include "Vectors.h"
+#include "Quaternion.h"
+
+namespace gm
+{
+	// Storage-only scalar types for vertex buffers and streamed data, math still happens in float:
+	//   half     IEEE 754 binary16, round to nearest even, |x| >= 65520 becomes inf, NaN stays NaN with its sign
+	//            and upper payload bits and the quiet bit set
+	//   snorm16  [-1, 1] as int16 round(x * 32767), -32768 decodes to -1
+	//   unorm8   [0, 1] as uint8 round(x * 255)
+	// Out of range values clamp, NaN encodes as the upper bound for snorm16 / unorm8.
+	// They convert explicitly from and to float, so Vec's converting constructor packs whole vectors:
+	//   Vec<3, half> p(position);  Vec<3, float> position2(p);
+	// PackedQuat is a Quat<float> in 4 snorm16, 8 instead of 16 bytes, components are off by at most 1 / 65534.
+	//
+	// pack(in, out, count) / unpack(in, out, count) convert whole arrays of float, Vec<L, float> or Quat<float>,
+	// F16C for half and SSE2 / AVX2 for snorm16 / unorm8 where available, the scalar conversions elsewhere.
+	// Bulk and scalar conversions give identical results.
+	namespace detail
+	{
+		inline uint32_t floatBits(float x) { uint32_t u; std::memcpy(&u, &x, 4); return u; }
+		inline float bitsFloat(uint32_t u) { float x; std::memcpy(&x, &u, 4); return x; }
+
+		// round to nearest even like _mm_cvtps_epi32, std::lrint is a libm call unless -fno-math-errno
+		inline int roundToInt(float x)
+		{
+		#if defined(GM_SIMD_SSE2)
+			return _mm_cvtss_si32(_mm_set_ss(x));
+		#else
+			return (int)std::lrint(x);
+		#endif
+		}
+
+		inline uint16_t floatToHalf(float x)
+		{
+		#if defined(GM_SIMD_F16C)
+			return (uint16_t)_mm_extract_epi16(_mm_cvtps_ph(_mm_set_ss(x), _MM_FROUND_TO_NEAREST_INT), 0);
+		#else
+			uint32_t u = floatBits(x);
+			uint32_t sign = (u >> 16) & 0x8000;
+			u &= 0x7fffffff;
+			uint32_t h;
+			if (u > 0x7f800000)
+				// NaN keeps the top payload bits and becomes quiet, like vcvtps2ph
+				h = 0x7e00 | ((u >> 13) & 0x3ff);
+			else if (u >= 0x47800000)
+				h = 0x7c00;
+			else if (u < 0x38800000)
+				// subnormal or zero: adding 0.5 lines the half mantissa up with the low float mantissa bits and rounds
+				h = floatBits(bitsFloat(u) + 0.5f) - 0x3f000000;
+			else
+				// rebias the exponent, round to nearest even on bit 13
+				h = (u + 0xc8000fff + ((u >> 13) & 1)) >> 13;
+			return (uint16_t)(sign | h);
+		#endif
+		}
+
+		inline float halfToFloat(uint16_t h)
+		{
+		#if defined(GM_SIMD_F16C)
+			return _mm_cvtss_f32(_mm_cvtph_ps(_mm_cvtsi32_si128(h)));
+		#else
+			uint32_t u = (uint32_t)(h & 0x7fff) << 13;
+			uint32_t exponent = u & 0x0f800000;
+			u += 0x38000000;
+			if (exponent == 0x0f800000)
+				// inf, or NaN made quiet like vcvtph2ps
+				u = (u + 0x38000000) | (u & 0x007fe000 ? 0x00400000 : 0);
+			else if (exponent == 0)
+				u = floatBits(bitsFloat(u + 0x00800000) - bitsFloat(0x38800000));
+			return bitsFloat(u | (uint32_t)(h & 0x8000) << 16);
+		#endif
+		}
+	}
+
+	struct half
+	{
+		uint16_t bits;
+
+		inline half() = default;
+		inline explicit half(float x) : bits(detail::floatToHalf(x)) {}
+		inline explicit operator float() const { return detail::halfToFloat(bits); }
+	};
+
+	struct snorm16
+	{
+		int16_t bits;
+
+		inline snorm16() = default;
+		inline explicit snorm16(float x) : bits((int16_t)detail::roundToInt((x < 1 ? (x > -1 ? x : -1.0f) : 1.0f) * 32767.0f)) {}
+		inline explicit operator float() const
+		{
+			float x = bits * (1.0f / 32767.0f);
+			return x > -1.0f ? x : -1.0f;
+		}
+	};
+
+	struct unorm8
+	{
+		uint8_t bits;
+
+		inline unorm8() = default;
+		inline explicit unorm8(float x) : bits((uint8_t)detail::roundToInt((x < 1 ? (x > 0 ? x : 0.0f) : 1.0f) * 255.0f)) {}
+		inline explicit operator float() const { return bits * (1.0f / 255.0f); }
+	};
+
+	struct PackedQuat
+	{
+		Vec<4, snorm16> xyzw;
+
+		inline PackedQuat() = default;
+		inline explicit PackedQuat(const Quat<float>& q) : xyzw(Vec<4, float>(q.x, q.y, q.z, q.w)) {}
+		inline explicit operator Quat<float>() const
+		{
+			Vec<4, float> v(xyzw);
+			return Quat<float>(v[0], v[1], v[2], v[3]);
+		}
+	};
+
+
+	inline void pack(const float* in, half* out, size_t count)
+	{
+		size_t i = 0;
+	#if defined(GM_SIMD_F16C)
+		for (; i + 8 <= count; i += 8)
+			_mm_storeu_si128((__m128i*)(out + i), _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+	#endif
+		for (; i < count; ++i)
+			out[i] = half(in[i]);
+	}
+
+	inline void unpack(const half* in, float* out, size_t count)
+	{
+		size_t i = 0;
+	#if defined(GM_SIMD_F16C)
+		for (; i + 8 <= count; i += 8)
+			_mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(in + i))));
+	#endif
+		for (; i < count; ++i)
+			out[i] = (float)in[i];
+	}
+
+	inline void pack(const float* in, snorm16* out, size_t count)
+	{
+		size_t i = 0;
+	#if defined(GM_SIMD_SSE2)
+		const __m128 one = _mm_set1_ps(1.0f), minusOne = _mm_set1_ps(-1.0f), scale = _mm_set1_ps(32767.0f);
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128 a = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(in + i), one), minusOne);
+			__m128 b = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(in + i + 4), one), minusOne);
+			__m128i ia = _mm_cvtps_epi32(_mm_mul_ps(a, scale));
+			__m128i ib = _mm_cvtps_epi32(_mm_mul_ps(b, scale));
+			_mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(ia, ib));
+		}
+	#endif
+		for (; i < count; ++i)
+			out[i] = snorm16(in[i]);
+	}
+
+	inline void unpack(const snorm16* in, float* out, size_t count)
+	{
+		size_t i = 0;
+	#if defined(GM_SIMD_AVX2)
+		const __m256 minusOne = _mm256_set1_ps(-1.0f), scale = _mm256_set1_ps(1.0f / 32767.0f);
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i)));
+			_mm256_storeu_ps(out + i, _mm256_max_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(v), scale), minusOne));
+		}
+	#elif defined(GM_SIMD_SSE2)
+		const __m128 minusOne = _mm_set1_ps(-1.0f), scale = _mm_set1_ps(1.0f / 32767.0f);
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+			// sign extend by placing each int16 in the high half and shifting back
+			__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+			__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+			_mm_storeu_ps(out + i, _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(lo), scale), minusOne));
+			_mm_storeu_ps(out + i + 4, _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(hi), scale), minusOne));
+		}
+	#endif
+		for (; i < count; ++i)
+			out[i] = (float)in[i];
+	}
+
+	inline void pack(const float* in, unorm8* out, size_t count)
+	{
+		size_t i = 0;
+	#if defined(GM_SIMD_SSE2)
+		const __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps(), scale = _mm_set1_ps(255.0f);
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i v[4];
+			for (int k = 0; k < 4; ++k)
+				v[k] = _mm_cvtps_epi32(_mm_mul_ps(_mm_max_ps(_mm_min_ps(_mm_loadu_ps(in + i + 4 * k), one), zero), scale));
+			_mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3])));
+		}
+	#endif
+		for (; i < count; ++i)
+			out[i] = unorm8(in[i]);
+	}
+
+	inline void unpack(const unorm8* in, float* out, size_t count)
+	{
+		size_t i = 0;
+	#if defined(GM_SIMD_AVX2)
+		const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(in + i)));
+			_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+		}
+	#elif defined(GM_SIMD_SSE2)
+		const __m128i zero = _mm_setzero_si128();
+		const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+			__m128i lo = _mm_unpacklo_epi8(v, zero);
+			__m128i hi = _mm_unpackhi_epi8(v, zero);
+			_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+			_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+			_mm_storeu_ps(out + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+			_mm_storeu_ps(out + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+		}
+	#endif
+		for (; i < count; ++i)
+			out[i] = (float)in[i];
+	}
+
+	template<int L, typename Q>
+	inline void pack(const Vec<L, float>* in, Vec<L, Q>* out, size_t count)
+	{
+		static_assert(sizeof(Vec<L, float>) == L * sizeof(float) && sizeof(Vec<L, Q>) == L * sizeof(Q), "vectors must be tightly packed");
+		pack(reinterpret_cast<const float*>(in), reinterpret_cast<Q*>(out), count * L);
+	}
+
+	template<int L, typename Q>
+	inline void unpack(const Vec<L, Q>* in, Vec<L, float>* out, size_t count)
+	{
+		static_assert(sizeof(Vec<L, float>) == L * sizeof(float) && sizeof(Vec<L, Q>) == L * sizeof(Q), "vectors must be tightly packed");
+		unpack(reinterpret_cast<const Q*>(in), reinterpret_cast<float*>(out), count * L);
+	}
+
+	inline void pack(const Quat<float>* in, PackedQuat* out, size_t count)
+	{
+		static_assert(sizeof(PackedQuat) == 4 * sizeof(snorm16), "PackedQuat must be tightly packed");
+		pack(reinterpret_cast<const float*>(in), reinterpret_cast<snorm16*>(out), count * 4);
+	}
+
+	inline void unpack(const PackedQuat* in, Quat<float>* out, size_t count)
+	{
+		unpack(reinterpret_cast<const snorm16*>(in), reinterpret_cast<float*>(out), count * 4);
+	}
+}
@@ -0,0 +1,292 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "SIMD.h"
+#include "Span.h"
+#include "Matrices.h"
+#include "Quaternion.h"
+#include "Normalize.h"
+
+namespace gm
+{
+	namespace parallel
+	{
+		// Bulk kernels over arrays, split into chunks of about chunkBytes of input plus output that run on an Executor.
+		// The chunk size depends only on the element types, never on the number of threads, and every element goes
+		// through the same single element operator or Pack kernel, so results are bit identical on any executor
+		// with any thread count.
+		// Arrays of at most one chunk run on the calling thread.
+		//
+		// multiply(a, b, out, count) is out[i] = a[i] * b[i] for every operator * of the library: Mat * Mat, Mat * Vec,
+		// Quat * Quat, Mat<4, 4> * Mat<3, 4>, DualQuat... multiply(a, b, out, count) with a single a is out[i] = a * b[i],
+		// e.g. viewProjection * model for every instance. normalize() and normalizeFast() work on Vec and Quat (Normalize.h),
+		// slerp() takes one t or one per element.
+		// out may be the same array as an input. forChunks(count, chunk, fn) runs fn(begin, end) over any other loop.
+		//
+		// An Executor runs task(context, i) for every i < count and returns when all have finished, implement it
+		// to run the chunks on an engine's own job system. ThreadPool is the default one: persistent workers, each starts
+		// on its own contiguous share of the chunks and takes chunks from the others' shares once it runs out.
+		// The thread calling run() works as one of them, run() from inside a task runs inline.
+		// defaultExecutor() is a ThreadPool with hardware_concurrency() threads created on first use,
+		// setDefaultExecutor() replaces it, every kernel also takes an executor as last argument.
+		struct Executor
+		{
+			typedef void (*Task)(void* context, size_t index);
+
+			virtual ~Executor() = default;
+			virtual void run(size_t count, Task task, void* context) = 0;
+		};
+
+		struct SerialExecutor : Executor
+		{
+			inline void run(size_t count, Task task, void* context) override
+			{
+				for (size_t i = 0; i < count; ++i)
+					task(context, i);
+			}
+		};
+
+		struct ThreadPool : Executor
+		{
+			// threads in total, including the one calling run(), 0: hardware_concurrency()
+			inline explicit ThreadPool(unsigned threads = 0);
+			inline ~ThreadPool();
+			ThreadPool(const ThreadPool&) = delete;
+			ThreadPool& operator=(const ThreadPool&) = delete;
+
+			inline unsigned size() const { return (unsigned)ranges.size(); }
+			inline void run(size_t count, Task task, void* context) override;
+
+		private:
+			// chunks [next, end) of one thread's share not taken yet, a cache line each
+			struct alignas(64) Range
+			{
+				std::atomic<size_t> next;
+				size_t end;
+			};
+
+			std::vector<Range, simd::AlignedAllocator<Range>> ranges;
+			std::vector<std::thread> workers;
+			std::mutex submit;
+			std::mutex mutex;
+			std::condition_variable wake;
+			std::condition_variable done;
+			uint64_t generation = 0;
+			unsigned pending = 0;
+			bool stop = false;
+			Task task = nullptr;
+			void* context = nullptr;
+
+			static inline bool& insideTask()
+			{
+				static thread_local bool inside = false;
+				return inside;
+			}
+			inline void work(size_t self);
+			inline void loop(size_t self);
+		};
+
+		inline ThreadPool::ThreadPool(unsigned threads)
+			: ranges(threads ? threads : std::max(std::thread::hardware_concurrency(), 1u))
+		{
+			for (size_t i = 1; i < ranges.size(); ++i)
+				workers.emplace_back([this, i] { loop(i); });
+		}
+
+		inline ThreadPool::~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stop = true;
+			}
+			wake.notify_all();
+			for (std::thread& worker : workers)
+				worker.join();
+		}
+
+		inline void ThreadPool::run(size_t count, Task task, void* context)
+		{
+			if (workers.empty() || count <= 1 || insideTask())
+			{
+				for (size_t i = 0; i < count; ++i)
+					task(context, i);
+				return;
+			}
+
+			std::lock_guard<std::mutex> serial(submit);
+			size_t n = ranges.size();
+			for (size_t k = 0; k < n; ++k)
+			{
+				ranges[k].next.store(count * k / n, std::memory_order_relaxed);
+				ranges[k].end = count * (k + 1) / n;
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				this->task = task;
+				this->context = context;
+				pending = (unsigned)workers.size();
+				++generation;
+			}
+			wake.notify_all();
+
+			insideTask() = true;
+			work(0);
+			insideTask() = false;
+
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [this] { return pending == 0; });
+		}
+
+		inline void ThreadPool::work(size_t self)
+		{
+			size_t n = ranges.size();
+			for (size_t k = 0; k < n; ++k)
+			{
+				Range& range = ranges[(self + k) % n];
+				for (size_t i = range.next.fetch_add(1, std::memory_order_relaxed); i < range.end; i = range.next.fetch_add(1, std::memory_order_relaxed))
+					task(context, i);
+			}
+		}
+
+		inline void ThreadPool::loop(size_t self)
+		{
+			insideTask() = true;
+			uint64_t seen = 0;
+			for (;;)
+			{
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					wake.wait(lock, [&] { return stop || generation != seen; });
+					if (stop)
+						return;
+					seen = generation;
+				}
+				work(self);
+				std::lock_guard<std::mutex> lock(mutex);
+				if (--pending == 0)
+					done.notify_one();
+			}
+		}
+
+		namespace detail
+		{
+			inline std::atomic<Executor*>& customExecutor()
+			{
+				static std::atomic<Executor*> executor(nullptr);
+				return executor;
+			}
+		}
+
+		// nullptr restores the default ThreadPool
+		inline void setDefaultExecutor(Executor* executor)
+		{
+			detail::customExecutor().store(executor);
+		}
+
+		inline Executor& defaultExecutor()
+		{
+			if (Executor* executor = detail::customExecutor().load())
+				return *executor;
+			static ThreadPool pool;
+			return pool;
+		}
+
+		// Input plus output bytes per chunk, small enough to stay in L2 while it is streamed,
+		// big enough that taking a chunk costs nothing against working on it.
+		const size_t chunkBytes = 64 * 1024;
+
+		inline size_t chunkSize(size_t bytesPerElement)
+		{
+			return std::max(chunkBytes / bytesPerElement, (size_t)1);
+		}
+
+		// fn(begin, end) for consecutive ranges of chunk elements covering [0, count)
+		template<typename F>
+		inline void forChunks(size_t count, size_t chunk, const F& fn, Executor& executor = defaultExecutor())
+		{
+			if (count <= chunk)
+			{
+				if (count)
+					fn((size_t)0, count);
+				return;
+			}
+			struct Context
+			{
+				const F* fn;
+				size_t count;
+				size_t chunk;
+			} context = { &fn, count, chunk };
+			executor.run((count + chunk - 1) / chunk, [](void* p, size_t i)
+			{
+				const Context& c = *static_cast<const Context*>(p);
+				size_t begin = i * c.chunk;
+				(*c.fn)(begin, std::min(begin + c.chunk, c.count));
+			}, &context);
+		}
+
+		template<typename A, typename B, typename Y>
+		inline void multiply(const A* a, const B* b, Y* out, size_t count, Executor& executor = defaultExecutor())
+		{
+			forChunks(count, chunkSize(sizeof(A) + sizeof(B) + sizeof(Y)), [=](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+					out[i] = a[i] * b[i];
+			}, executor);
+		}
+
+		template<typename A, typename B, typename Y, typename std::enable_if<!std::is_pointer<A>::value, int>::type = 0>
+		inline void multiply(const A& a, const B* b, Y* out, size_t count, Executor& executor = defaultExecutor())
+		{
+			forChunks(count, chunkSize(sizeof(B) + sizeof(Y)), [=](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+					out[i] = a * b[i];
+			}, executor);
+		}
+
+		template<typename V>
+		inline void normalize(const V* in, V* out, size_t count, Executor& executor = defaultExecutor())
+		{
+			forChunks(count, chunkSize(2 * sizeof(V)), [=](size_t begin, size_t end)
+			{
+				gm::normalize(in + begin, out + begin, end - begin);
+			}, executor);
+		}
+
+		template<typename V>
+		inline void normalizeFast(const V* in, V* out, size_t count, Executor& executor = defaultExecutor())
+		{
+			forChunks(count, chunkSize(2 * sizeof(V)), [=](size_t begin, size_t end)
+			{
+				gm::normalizeFast(in + begin, out + begin, end - begin);
+			}, executor);
+		}
+
+		template<typename T>
+		inline void slerp(const Quat<T>* a, const Quat<T>* b, NoDeduce<T> t, Quat<T>* out, size_t count, Executor& executor = defaultExecutor())
+		{
+			forChunks(count, chunkSize(3 * sizeof(Quat<T>)), [=](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+					out[i] = slerp(a[i], b[i], t);
+			}, executor);
+		}
+
+		template<typename T>
+		inline void slerp(const Quat<T>* a, const Quat<T>* b, const T* t, Quat<T>* out, size_t count, Executor& executor = defaultExecutor())
+		{
+			forChunks(count, chunkSize(3 * sizeof(Quat<T>) + sizeof(T)), [=](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+					out[i] = slerp(a[i], b[i], t[i]);
+			}, executor);
+		}
+	}
+}
@@ -0,0 +1,229 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "Quaternion.h"
+#include "Pack.h"
+
+namespace gm
+{
+	// Smallest-three quaternion compression in 29, 32 or 48 bits.
+	// The largest |component| is dropped and rebuilt from the unit length, its 2 bit index is stored
+	// with the other three quantized to (Bits - 2) / 3 = 9, 10 or 15 bits each over [-1 / sqrt(2), 1 / sqrt(2)],
+	// an odd number of levels 2^K - 1 centred on 0 so 0 is exact and the identity decodes to (0, 0, 0, 1).
+	// q and -q encode the same: the quaternion is negated when the dropped component is negative,
+	// the same hemisphere choice slerp makes, so the decoded quaternion is the same rotation but may be -q.
+	// Inputs are expected to be normalized.
+	//
+	// Layout of value(): index << 3K | a << 2K | b << K | c, stored in 16 bit words (4 bytes for 29 / 32, 6 for 48).
+	// Encoding only uses exact or correctly rounded float operations, the bits are identical on every target,
+	// scalar and batched encode / decode of one build agree bit for bit.
+	//
+	// pack(in, out, count) / unpack(in, out, count) convert arrays Pack<T>::size quaternions at a time.
+	// maxComponentError() bounds the error of every component: the stored three are within half a step,
+	// the rebuilt one is at least 1 / 2 and within 3 half steps (29 bits 0.0041, 32 bits 0.0021, 48 bits 0.000065).
+	// compressionError(q, count) reports the actual component and rotation angle error over a data set.
+	template<int Bits>
+	struct CompressedQuat
+	{
+		static_assert(Bits == 29 || Bits == 32 || Bits == 48, "CompressedQuat supports 29, 32 and 48 bits");
+		static const int componentBits = (Bits - 2) / 3;
+		static const int words = (Bits + 15) / 16;
+
+		uint16_t bits[words];
+
+		inline CompressedQuat() = default;
+		template<typename T>
+		inline explicit CompressedQuat(const Quat<T>& q);
+		template<typename T>
+		inline explicit operator Quat<T>() const;
+
+		inline uint64_t value() const
+		{
+			uint64_t v = 0;
+			for (int i = 0; i < words; ++i)
+				v |= (uint64_t)bits[i] << (16 * i);
+			return v;
+		}
+		inline void value(uint64_t v)
+		{
+			for (int i = 0; i < words; ++i)
+				bits[i] = (uint16_t)(v >> (16 * i));
+		}
+
+		static constexpr float maxComponentError() { return 3 * 0.7071067811865475f / ((1 << componentBits) - 2); }
+	};
+
+	namespace detail
+	{
+		template<int K, typename T>
+		struct SmallestThree
+		{
+			typedef simd::Pack<T> P;
+
+			// levels [0, 2^K - 2], 0 is the center level
+			static inline T maxLevel() { return (T)((1 << K) - 2); }
+			static inline T center() { return (T)((1 << (K - 1)) - 1); }
+
+			// index of the largest |component|, the first one wins ties, and the other three in order quantized to [0, 2^K - 2]
+			static inline void encode(P x, P y, P z, P w, P& index, P& a, P& b, P& c)
+			{
+				const P zero((T)0), one((T)1), two((T)2), three((T)3);
+				P m = simd::abs(x);
+				index = zero;
+				P t = simd::abs(y);
+				index = simd::select(t > m, one, index);
+				m = simd::max(m, t);
+				t = simd::abs(z);
+				index = simd::select(t > m, two, index);
+				m = simd::max(m, t);
+				index = simd::select(simd::abs(w) > m, three, index);
+
+				P largest = simd::select(index == zero, x, simd::select(index == one, y, simd::select(index == two, z, w)));
+				a = simd::select(index == zero, y, x);
+				b = simd::select(index <= one, z, y);
+				c = simd::select(index == three, z, w);
+
+				typename P::Mask negative = largest < zero;
+				// rounding before adding the center keeps the levels symmetric around 0 and every step exact or correctly rounded
+				const P scale(maxLevel() * (T)0.7071067811865475), mid(center());
+				a = simd::round(simd::min(simd::max(simd::select(negative, -a, a) * scale, -mid), mid)) + mid;
+				b = simd::round(simd::min(simd::max(simd::select(negative, -b, b) * scale, -mid), mid)) + mid;
+				c = simd::round(simd::min(simd::max(simd::select(negative, -c, c) * scale, -mid), mid)) + mid;
+			}
+
+			static inline void decode(const P& index, P a, P b, P c, P& x, P& y, P& z, P& w)
+			{
+				const P zero((T)0), one((T)1), two((T)2), three((T)3);
+				const P mid(center()), step((T)1.4142135623730951 / maxLevel());
+				a = (a - mid) * step;
+				b = (b - mid) * step;
+				c = (c - mid) * step;
+				P largest = simd::sqrt(simd::max(simd::nmadd(c, c, simd::nmadd(b, b, simd::nmadd(a, a, one))), zero));
+				x = simd::select(index == zero, largest, a);
+				y = simd::select(index == zero, a, simd::select(index == one, largest, b));
+				z = simd::select(index <= one, b, simd::select(index == two, largest, c));
+				w = simd::select(index == three, largest, c);
+			}
+
+			static inline uint64_t combine(T index, T a, T b, T c)
+			{
+				// through int, float to 64 bit unsigned is a slow conversion before AVX-512
+				return (uint64_t)(int)index << (3 * K) | (uint64_t)(int)a << (2 * K) | (uint64_t)(int)b << K | (uint64_t)(int)c;
+			}
+
+			static inline void split(uint64_t v, T& index, T& a, T& b, T& c)
+			{
+				const uint64_t mask = (1u << K) - 1;
+				index = (T)(int)(v >> (3 * K));
+				a = (T)(int)((v >> (2 * K)) & mask);
+				b = (T)(int)((v >> K) & mask);
+				c = (T)(int)(v & mask);
+			}
+		};
+
+		template<int Bits, typename T>
+		inline void packLanes(const simd::Pack<T>& x, const simd::Pack<T>& y, const simd::Pack<T>& z, const simd::Pack<T>& w, CompressedQuat<Bits>* out, int n)
+		{
+			typedef SmallestThree<CompressedQuat<Bits>::componentBits, T> S;
+			typedef simd::Pack<T> P;
+			P index, a, b, c;
+			S::encode(x, y, z, w, index, a, b, c);
+			alignas(64) T t[4][P::size];
+			index.store(t[0]);
+			a.store(t[1]);
+			b.store(t[2]);
+			c.store(t[3]);
+			for (int i = 0; i < n; ++i)
+				out[i].value(S::combine(t[0][i], t[1][i], t[2][i], t[3][i]));
+		}
+
+		template<int Bits, typename T>
+		inline void unpackLanes(const CompressedQuat<Bits>* in, simd::Pack<T>& x, simd::Pack<T>& y, simd::Pack<T>& z, simd::Pack<T>& w)
+		{
+			typedef SmallestThree<CompressedQuat<Bits>::componentBits, T> S;
+			typedef simd::Pack<T> P;
+			alignas(64) T t[4][P::size];
+			for (int i = 0; i < P::size; ++i)
+				S::split(in[i].value(), t[0][i], t[1][i], t[2][i], t[3][i]);
+			S::decode(P::load(t[0]), P::load(t[1]), P::load(t[2]), P::load(t[3]), x, y, z, w);
+		}
+	}
+
+	template<int Bits>
+	template<typename T>
+	inline CompressedQuat<Bits>::CompressedQuat(const Quat<T>& q)
+	{
+		typedef simd::Pack<T> P;
+		detail::packLanes(P(q.x), P(q.y), P(q.z), P(q.w), this, 1);
+	}
+
+	template<int Bits>
+	template<typename T>
+	inline CompressedQuat<Bits>::operator Quat<T>() const
+	{
+		typedef simd::Pack<T> P;
+		T index, a, b, c;
+		detail::SmallestThree<componentBits, T>::split(value(), index, a, b, c);
+		P x, y, z, w;
+		detail::SmallestThree<componentBits, T>::decode(P(index), P(a), P(b), P(c), x, y, z, w);
+		return Quat<T>(x[0], y[0], z[0], w[0]);
+	}
+
+	template<int Bits, typename T>
+	inline void pack(const Quat<T>* in, CompressedQuat<Bits>* out, size_t count)
+	{
+		typedef simd::Pack<T> P;
+		size_t i = 0;
+		P x, y, z, w;
+		for (; i + P::size <= count; i += P::size)
+		{
+			simd::loadAoS4(&in[i].x, x, y, z, w);
+			detail::packLanes(x, y, z, w, out + i, P::size);
+		}
+		for (; i < count; ++i)
+			out[i] = CompressedQuat<Bits>(in[i]);
+	}
+
+	template<int Bits, typename T>
+	inline void unpack(const CompressedQuat<Bits>* in, Quat<T>* out, size_t count)
+	{
+		typedef simd::Pack<T> P;
+		size_t i = 0;
+		P x, y, z, w;
+		for (; i + P::size <= count; i += P::size)
+		{
+			detail::unpackLanes(in + i, x, y, z, w);
+			simd::storeAoS4(&out[i].x, x, y, z, w);
+		}
+		for (; i < count; ++i)
+			out[i] = Quat<T>(in[i]);
+	}
+
+	struct QuatCompressionError
+	{
+		double maxComponent;	// largest |component| difference to q or -q, whichever is closer
+		double maxAngle;		// largest angle in radians between the original and the decoded rotation
+	};
+
+	template<int Bits, typename T>
+	inline QuatCompressionError compressionError(const Quat<T>* q, size_t count)
+	{
+		QuatCompressionError e = { 0, 0 };
+		for (size_t i = 0; i < count; ++i)
+		{
+			Quat<T> d = Quat<T>(CompressedQuat<Bits>(q[i]));
+			double dot = 0, plus = 0, minus = 0;
+			for (int k = 0; k < 4; ++k)
+			{
+				dot += (double)q[i][k] * d[k];
+				plus = std::max(plus, std::abs((double)q[i][k] - d[k]));
+				minus = std::max(minus, std::abs((double)q[i][k] + d[k]));
+			}
+			e.maxComponent = std::max(e.maxComponent, std::min(plus, minus));
+			e.maxAngle = std::max(e.maxAngle, 2 * std::acos(std::min(std::abs(dot), 1.0)));
+		}
+		return e;
+	}
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include "Vectors.h"
+#include "VectorGloabalFuncs.h"
+#include "ConstexprMath.h"
 #include <ostream>
 #include <cmath>
 
@@ -18,21 +20,27 @@ namespace gm
 
 		static const Quat identity;
 
-		T& operator[](int i)
+		// Constant evaluation only allows the x, y, z, w view of the union,
+		// n, vec4 and i, j, k are run time aliases
+		constexpr T& operator[](int i)
 		{
+			if (GM_IS_CONSTANT_EVALUATED())
+				return i == 0 ? x : i == 1 ? y : i == 2 ? z : w;
 			return *((T*)this + i);
 		}
-		const T& operator[](int i) const
+		constexpr const T& operator[](int i) const
 		{
+			if (GM_IS_CONSTANT_EVALUATED())
+				return i == 0 ? x : i == 1 ? y : i == 2 ? z : w;
 			return *((T*)this + i);
 		}
 
-		Quat() = default;
-		Quat(const Quat<T>& v) = default;
-		Quat(const Vec<3, T>& n, T w) : x(n.x), y(n.y), z(n.z), w(w) {}
-		Quat(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) {}
+		constexpr Quat() = default;
+		constexpr Quat(const Quat<T>& v) = default;
+		constexpr Quat(const Vec<3, T>& n, T w) : x(n[0]), y(n[1]), z(n[2]), w(w) {}
+		constexpr Quat(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) {}
 
-		Vec<3, T> right() const
+		constexpr Vec<3, T> right() const
 		{
 			const T _1 = 1;
 			const T _2 = 2;
@@ -44,7 +52,7 @@ namespace gm
 			};
 		}
 
-		Vec<3, T> up() const
+		constexpr Vec<3, T> up() const
 		{
 			const T _1 = 1;
 			const T _2 = 2;
@@ -56,7 +64,7 @@ namespace gm
 			};
 		}
 
-		Vec<3, T> forward() const
+		constexpr Vec<3, T> forward() const
 		{
 			const T _1 = 1;
 			const T _2 = 2;
@@ -68,107 +76,117 @@ namespace gm
 			};
 		}
 
-		static Quat angleAxis(const Vec<3, T>& axis, T angle);
-		static Quat euler(const Vec<3, T>& euler);
-		static Quat euler(const T& x, const T& y, const T& z);
+		static constexpr Quat angleAxis(const Vec<3, T>& axis, T angle);
+		static constexpr Quat euler(const Vec<3, T>& euler);
+		static constexpr Quat euler(const T& x, const T& y, const T& z);
 	};
 
 	template<class T>
 	const Quat<T> Quat<T>::identity(0, 0, 0, 1);
 
 	template<class T>
-	Quat<T> Quat<T>::angleAxis(const Vec<3, T>& axis, T angle)
+	constexpr Quat<T> Quat<T>::angleAxis(const Vec<3, T>& axis, T angle)
 	{
-		T halfAngle = angle * (T)0.5;
-		return Quat<T>(axis * std::sin(halfAngle), std::cos(halfAngle));
+		T sinA, cosA;
+		sincos(angle * (T)0.5, sinA, cosA);
+		return Quat<T>(axis * sinA, cosA);
 	}
 
 	template<class T>
-	Quat<T> Quat<T>::euler(const Vec<3, T>& degrees)
+	constexpr Quat<T> Quat<T>::euler(const Vec<3, T>& degrees)
 	{
 		Vec<3, T> halfRad = degrees * (T)0.00872664625995;
-		Vec<3, T> cosA = cos(halfRad);
-		Vec<3, T> sinA = sin(halfRad);
+		Vec<3, T> sinA, cosA;
+		sincos(halfRad, sinA, cosA);
 		return Quat<T>(
-			sinA.x * cosA.y * cosA.z + cosA.x * sinA.y * sinA.z,
-			cosA.x * sinA.y * cosA.z - sinA.x * cosA.y * sinA.z,
-			cosA.x * cosA.y * sinA.z + sinA.x * sinA.y * cosA.z,
-			cosA.x * cosA.y * cosA.z - sinA.x * sinA.y * sinA.z);
+			sinA[0] * cosA[1] * cosA[2] + cosA[0] * sinA[1] * sinA[2],
+			cosA[0] * sinA[1] * cosA[2] - sinA[0] * cosA[1] * sinA[2],
+			cosA[0] * cosA[1] * sinA[2] + sinA[0] * sinA[1] * cosA[2],
+			cosA[0] * cosA[1] * cosA[2] - sinA[0] * sinA[1] * sinA[2]);
 	}
 
 	template<class T>
-	Quat<T> Quat<T>::euler(const T& xDegrees, const T& yDegrees, const T& zDegrees)
+	constexpr Quat<T> Quat<T>::euler(const T& xDegrees, const T& yDegrees, const T& zDegrees)
 	{
 		return Quat<T>::euler(Vec<3, T>(xDegrees, yDegrees, zDegrees));
 	}
 
 	template<typename T>
-	inline Quat<T> lerp(const Quat<T> &a, const Quat<T> &b, T t)
+	inline constexpr Quat<T> lerp(const Quat<T> &a, const Quat<T> &b, T t)
 	{
 		return a + (b - a) * t;
 	}
 
 	template<typename T>
-	inline Quat<T> slerp(Quat<T> a, const Quat<T> &b, T t)
+	inline constexpr Quat<T> slerp(Quat<T> a, const Quat<T> &b, T t)
 	{
 		const T _0 = 0;
 		const T _1 = 1;
 
-		T cosA = dot(a.vec4, b.vec4);
+		T cosA = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
 		if (cosA < _0)
 		{
-			a.vec4 = -a.vec4;
+			a = Quat<T>(-a.x, -a.y, -a.z, -a.w);
 			cosA = -cosA;
 		}
-		cosA = std::fmin(cosA, _1);
+		cosA = cx::fmin(cosA, _1);
 
 
 
 		T aMul, bMul;
-		if (std::abs(cosA) > static_cast<T>(0.9999))
+		if (cx::abs(cosA) > static_cast<T>(0.9999))
 		{
 			aMul = _1 - t;
 			bMul = t;
 		}
 		else
 		{
-			T angle = std::acos(cosA);
-			T sin = std::sin(angle);
+			T angle = cx::acos(cosA);
+			T sin = cx::sin(angle);
 
 			T invSin = _1 / sin;
-			aMul = invSin * std::sin(angle * (_1 - t));
-			bMul = invSin * std::sin(angle * t);
+			aMul = invSin * cx::sin(angle * (_1 - t));
+			bMul = invSin * cx::sin(angle * t);
 		}
 		return a * aMul + b * bMul;
 	}
 
 	template<typename T>
-	inline Quat<T> pow(const Quat<T> &q, const T p)
+	inline constexpr Quat<T> pow(const Quat<T> &q, const T p)
 	{
-		T aOld = std::acos(q.w);
+		T aOld = cx::acos(q.w);
 		T aNew = aOld * p;
 		//todo n *= sqrt(1-aNew*aNew) / sqrt(1-a.w*a.w)
-		return Quat<T>(q.n * std::sin(aNew) / std::sin(aOld), std::cos(aNew));
+		T sinA, cosA;
+		sincos(aNew, sinA, cosA);
+		return Quat<T>(Vec<3, T>(q.x, q.y, q.z) * sinA / cx::sin(aOld), cosA);
 	}
 
 	template<typename T>
-	inline Quat<T> inverse(const Quat<T> &q)
+	inline constexpr Quat<T> inverse(const Quat<T> &q)
 	{
 		return Quat<T>{-q.x, -q.y, -q.z, q.w};
 	}
 
 	template<typename T>
-	inline Quat<T> operator*(const Quat<T>& a, const T &b)
+	inline constexpr Quat<T> normalize(const Quat<T> &q)
+	{
+		T invLength = (T)1 / cx::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+		return Quat<T>{q.x * invLength, q.y * invLength, q.z * invLength, q.w * invLength};
+	}
+
+	template<typename T>
+	inline constexpr Quat<T> operator*(const Quat<T>& a, const T &b)
 	{
 		return Quat<T>{a.x * b, a.y * b, a.z * b, a.w * b};
 	}
 	template<typename T>
-	inline Quat<T> operator*(const T &a, const Quat<T>& b)
+	inline constexpr Quat<T> operator*(const T &a, const Quat<T>& b)
 	{
 		return Quat<T>{b.x * a, b.y * a, b.z * a, b.w * a};
 	}
 	template<typename T>
-	inline Quat<T> & operator *= (Quat<T> &a, const T &b)
+	inline constexpr Quat<T> & operator *= (Quat<T> &a, const T &b)
 	{
 		a.x *= b;
 		a.y *= b;
@@ -178,17 +196,17 @@ namespace gm
 	}
 
 	template<typename T>
-	inline Quat<T> operator+(const Quat<T>& a, const T &b)
+	inline constexpr Quat<T> operator+(const Quat<T>& a, const T &b)
 	{
 		return Quat<T>{a.x + b, a.y + b, a.z + b, a.w + b};
 	}
 	template<typename T>
-	inline Quat<T> operator+(const T &a, const Quat<T>& b)
+	inline constexpr Quat<T> operator+(const T &a, const Quat<T>& b)
 	{
 		return Quat<T>{b.x + a, b.y + a, b.z + a, b.w + a};
 	}
 	template<typename T>
-	inline Quat<T> & operator += (Quat<T> &a, const T &b)
+	inline constexpr Quat<T> & operator += (Quat<T> &a, const T &b)
 	{
 		a.x += b;
 		a.y += b;
@@ -197,12 +215,12 @@ namespace gm
 		return a;
 	}
 	template<typename T>
-	inline Quat<T> operator+(const Quat<T>& a, const Quat<T>& b)
+	inline constexpr Quat<T> operator+(const Quat<T>& a, const Quat<T>& b)
 	{
 		return Quat<T>{a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w};
 	}
 	template<typename T>
-	inline Quat<T> & operator += (Quat<T> &a, const Quat<T>& b)
+	inline constexpr Quat<T> & operator += (Quat<T> &a, const Quat<T>& b)
 	{
 		a.x += b.x;
 		a.y += b.y;
@@ -212,17 +230,17 @@ namespace gm
 	}
 
 	template<typename T>
-	inline Quat<T> operator-(const Quat<T>& a, const T &b)
+	inline constexpr Quat<T> operator-(const Quat<T>& a, const T &b)
 	{
 		return Quat<T>{a.x - b, a.y - b, a.z - b, a.w - b};
 	}
 	template<typename T>
-	inline Quat<T> operator-(const T &a, const Quat<T>& b)
+	inline constexpr Quat<T> operator-(const T &a, const Quat<T>& b)
 	{
-		return Quat<T>{b.x - a, b.y - a, b.z - a, b.w - a};
+		return Quat<T>{a - b.x, a - b.y, a - b.z, a - b.w};
 	}
 	template<typename T>
-	inline Quat<T> & operator -= (Quat<T> &a, const T &b)
+	inline constexpr Quat<T> & operator -= (Quat<T> &a, const T &b)
 	{
 		a.x -= b;
 		a.y -= b;
@@ -231,12 +249,12 @@ namespace gm
 		return a;
 	}
 	template<typename T>
-	inline Quat<T> operator-(const Quat<T>& a, const Quat<T>& b)
+	inline constexpr Quat<T> operator-(const Quat<T>& a, const Quat<T>& b)
 	{
 		return Quat<T>{a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w};
 	}
 	template<typename T>
-	inline Quat<T> & operator -= (Quat<T> &a, const Quat<T>& b)
+	inline constexpr Quat<T> & operator -= (Quat<T> &a, const Quat<T>& b)
 	{
 		a.x -= b.x;
 		a.y -= b.y;
@@ -246,7 +264,7 @@ namespace gm
 	}
 
 	template<typename T>
-	inline Quat<T> operator*(const Quat<T>& a, const Quat<T>& b)
+	inline constexpr Quat<T> operator*(const Quat<T>& a, const Quat<T>& b)
 	{
 		return Quat<T>
 		{
@@ -257,20 +275,17 @@ namespace gm
 		};
 	}
 	template<typename T>
-	inline Quat<T> & operator *= (Quat<T> &a, const Quat<T>& b)
+	inline constexpr Quat<T> & operator *= (Quat<T> &a, const Quat<T>& b)
 	{
-		a.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
-		a.y = a.w * b.y + a.y * b.w + a.z * b.x - a.x * b.z;
-		a.z = a.w * b.z + a.z * b.w + a.x * b.y - a.y * b.x;
-		a.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
-		return a;
+		return a = a * b;
 	}
 
 	template<typename T>
-	inline Vec<3, T> operator*(const Quat<T>& q, const Vec<3, T>& v)
+	inline constexpr Vec<3, T> operator*(const Quat<T>& q, const Vec<3, T>& v)
 	{
-		const Vec<3, T> t = 2.0f * cross(q.n, v);
-		return v + q.w * t + cross(q.n, t);
+		const Vec<3, T> n(q.x, q.y, q.z);
+		const Vec<3, T> t = cross(n, v) * (T)2;
+		return v + q.w * t + cross(n, t);
 	}
 
 	template<typename T>
@@ -279,4 +294,6 @@ namespace gm
 		out << "(" << q.i << "i + " << q.j << "j + " << q.k << "k + " << q.w << ")";
 		return out;
 	}
-}
\ No newline at end of file
+}
+
+#include "QuaternionSIMD.h"
\ No newline at end of file
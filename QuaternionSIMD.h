@@ -0,0 +1,142 @@
+#pragma once
+#include "Quaternion.h"
+
+#if defined(GM_SIMD_SSE2)
+namespace gm
+{
+	namespace simd
+	{
+		GM_FORCEINLINE __m128 load(const Quat<float>& q)
+		{
+			return _mm_load_ps(&q.x);
+		}
+
+		GM_FORCEINLINE Quat<float> toQuat(__m128 v)
+		{
+			Quat<float> q;
+			_mm_store_ps(&q.x, v);
+			return q;
+		}
+
+		GM_FORCEINLINE __m128 signMaskW()
+		{
+			return _mm_castsi128_ps(_mm_set_epi32(0x80000000, 0, 0, 0));
+		}
+
+		GM_FORCEINLINE __m128 quatMul(__m128 a, __m128 b)
+		{
+			__m128 r = _mm_mul_ps(splat<3>(a), b);
+			r = madd(_mm_xor_ps(shuffle<0, 1, 2, 0>(a), signMaskW()), shuffle<3, 3, 3, 0>(b), r);
+			r = madd(_mm_xor_ps(shuffle<1, 2, 0, 1>(a), signMaskW()), shuffle<2, 0, 1, 1>(b), r);
+			return nmadd(shuffle<2, 0, 1, 2>(a), shuffle<1, 2, 0, 2>(b), r);
+		}
+	}
+
+
+	inline GM_CONSTEXPR Quat<float> inverse(const Quat<float>& q)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return inverse<float>(q);
+		return simd::toQuat(_mm_xor_ps(simd::load(q), _mm_castsi128_ps(_mm_set_epi32(0, 0x80000000, 0x80000000, 0x80000000))));
+	}
+
+	// the squared length is summed pairwise like dot(Vec<4, float>), the last ulp can differ from normalize<float>()
+	inline GM_CONSTEXPR Quat<float> normalize(const Quat<float>& q)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return normalize<float>(q);
+		__m128 v = simd::load(q);
+		return simd::toQuat(_mm_div_ps(v, _mm_sqrt_ps(simd::hsum(_mm_mul_ps(v, v)))));
+	}
+
+	inline GM_CONSTEXPR Quat<float> lerp(const Quat<float>& a, const Quat<float>& b, float t)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return lerp<float>(a, b, t);
+		__m128 va = simd::load(a);
+		return simd::toQuat(simd::madd(_mm_sub_ps(simd::load(b), va), _mm_set1_ps(t), va));
+	}
+
+#define OVERLOAD_OP_QUAT_SIMD(op, intrin)												\
+	inline GM_CONSTEXPR Quat<float> operator op (const Quat<float>& a, const float& b)	\
+	{																					\
+		if (GM_IS_CONSTANT_EVALUATED())													\
+			return operator op <float>(a, b);											\
+		return simd::toQuat(intrin(simd::load(a), _mm_set1_ps(b)));						\
+	}																					\
+	inline GM_CONSTEXPR Quat<float> operator op (const float& a, const Quat<float>& b)	\
+	{																					\
+		if (GM_IS_CONSTANT_EVALUATED())													\
+			return operator op <float>(a, b);											\
+		return simd::toQuat(intrin(_mm_set1_ps(a), simd::load(b)));						\
+	}																					\
+	inline GM_CONSTEXPR Quat<float>& operator op##= (Quat<float>& a, const float& b)	\
+	{																					\
+		if (GM_IS_CONSTANT_EVALUATED())													\
+			return a = a op b;															\
+		_mm_store_ps(&a.x, intrin(simd::load(a), _mm_set1_ps(b)));						\
+		return a;																		\
+	}
+
+	OVERLOAD_OP_QUAT_SIMD(*, _mm_mul_ps)
+	OVERLOAD_OP_QUAT_SIMD(+, _mm_add_ps)
+	OVERLOAD_OP_QUAT_SIMD(-, _mm_sub_ps)
+#undef OVERLOAD_OP_QUAT_SIMD
+
+	inline GM_CONSTEXPR Quat<float> operator+(const Quat<float>& a, const Quat<float>& b)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return operator+<float>(a, b);
+		return simd::toQuat(_mm_add_ps(simd::load(a), simd::load(b)));
+	}
+	inline GM_CONSTEXPR Quat<float>& operator+=(Quat<float>& a, const Quat<float>& b)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return a = a + b;
+		_mm_store_ps(&a.x, _mm_add_ps(simd::load(a), simd::load(b)));
+		return a;
+	}
+	inline GM_CONSTEXPR Quat<float> operator-(const Quat<float>& a, const Quat<float>& b)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return operator-<float>(a, b);
+		return simd::toQuat(_mm_sub_ps(simd::load(a), simd::load(b)));
+	}
+	inline GM_CONSTEXPR Quat<float>& operator-=(Quat<float>& a, const Quat<float>& b)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return a = a - b;
+		_mm_store_ps(&a.x, _mm_sub_ps(simd::load(a), simd::load(b)));
+		return a;
+	}
+
+	inline GM_CONSTEXPR Quat<float> operator*(const Quat<float>& a, const Quat<float>& b)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return operator*<float>(a, b);
+		return simd::toQuat(simd::quatMul(simd::load(a), simd::load(b)));
+	}
+	inline GM_CONSTEXPR Quat<float>& operator*=(Quat<float>& a, const Quat<float>& b)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return a = a * b;
+		_mm_store_ps(&a.x, simd::quatMul(simd::load(a), simd::load(b)));
+		return a;
+	}
+
+	inline GM_CONSTEXPR Vec<3, float> operator*(const Quat<float>& q, const Vec<3, float>& v)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return operator*<float>(q, v);
+		__m128 vq = simd::load(q);
+		__m128 vv = _mm_set_ps(0.0f, v.z, v.y, v.x);
+		__m128 t = simd::cross3(vq, vv);
+		t = _mm_add_ps(t, t);
+		__m128 r = simd::madd(simd::splat<3>(vq), t, vv);
+		r = _mm_add_ps(r, simd::cross3(vq, t));
+		alignas(16) float out[4];
+		_mm_store_ps(out, r);
+		return Vec<3, float>(out[0], out[1], out[2]);
+	}
+}
+#endif
@@ -0,0 +1,110 @@
+#pragma once
+#include <cmath>
+#include "Matrices.h"
+#include "AABB.h"
+
+namespace gm
+{
+	// Ray origin + t * direction, t >= 0. direction need not be normalized, t is then in units of its length.
+	// transform(m, ray) moves a ray into another space (e.g. an instance's object space by its inverse world matrix),
+	// the direction is not renormalized so hit distances t stay comparable between spaces.
+	// RayPacket.h tests packets of rays against one primitive and one ray against packets of primitives.
+	template<typename T>
+	struct Ray
+	{
+		Vec<3, T> origin;
+		Vec<3, T> direction;
+
+		inline Ray() = default;
+		inline Ray(const Vec<3, T>& origin, const Vec<3, T>& direction) : origin(origin), direction(direction) {}
+
+		inline Vec<3, T> at(T t) const { return origin + direction * t; }
+	};
+
+	template<typename T>
+	inline Ray<T> transform(const Mat<4, 4, T>& m, const Ray<T>& ray)
+	{
+		Vec<3, T> o, d;
+		for (int r = 0; r < 3; ++r)
+		{
+			o[r] = m[12 + r] + m[r] * ray.origin[0] + m[4 + r] * ray.origin[1] + m[8 + r] * ray.origin[2];
+			d[r] = m[r] * ray.direction[0] + m[4 + r] * ray.direction[1] + m[8 + r] * ray.direction[2];
+		}
+		return Ray<T>(o, d);
+	}
+
+	// Slab test for t in [0, tMax] with invDirection = 1 / direction precomputed per ray,
+	// zero direction components give infinities and still work unless the origin lies exactly on that slab.
+	// tNear is the entry distance, 0 when the origin is inside the box.
+	template<typename T>
+	inline bool intersectSlabs(const Vec<3, T>& origin, const Vec<3, T>& invDirection, const AABB<3, T>& box, T tMax, T& tNear)
+	{
+		T t0 = 0, t1 = tMax;
+		for (int i = 0; i < 3; ++i)
+		{
+			T a = (box.min[i] - origin[i]) * invDirection[i];
+			T b = (box.max[i] - origin[i]) * invDirection[i];
+			T lo = a < b ? a : b, hi = a < b ? b : a;
+			t0 = lo > t0 ? lo : t0;
+			t1 = hi < t1 ? hi : t1;
+		}
+		tNear = t0;
+		return t0 <= t1;
+	}
+
+	template<typename T>
+	inline bool intersect(const Ray<T>& ray, const AABB<3, T>& box, T tMax, T& tNear)
+	{
+		return intersectSlabs(ray.origin, (T)1 / ray.direction, box, tMax, tNear);
+	}
+
+	namespace detail
+	{
+		// dot and cross rounded like the RayPacket.h kernels: a0 * b0 + (a1 * b1 + a2 * b2),
+		// fused exactly where simd::madd / nmadd are
+		template<typename T>
+		inline T rayMadd(T a, T b, T c)
+		{
+		#if defined(GM_SIMD_FMA)
+			return std::fma(a, b, c);
+		#else
+			return a * b + c;
+		#endif
+		}
+
+		template<typename T>
+		inline T rayDot(const Vec<3, T>& a, const Vec<3, T>& b)
+		{
+			return rayMadd(a[0], b[0], rayMadd(a[1], b[1], a[2] * b[2]));
+		}
+
+		template<typename T>
+		inline Vec<3, T> rayCross(const Vec<3, T>& a, const Vec<3, T>& b)
+		{
+			return Vec<3, T>(rayMadd(-a[2], b[1], a[1] * b[2]), rayMadd(-a[0], b[2], a[2] * b[0]), rayMadd(-a[1], b[0], a[0] * b[1]));
+		}
+	}
+
+	// Möller-Trumbore, both sides. A hit at t in [0, tMax) shortens tMax to it, u and v are the barycentrics of v1 and v2.
+	// There is no epsilon: rays parallel to the plane give infinities or NaN that fail the barycentric tests.
+	// Rounds exactly like the RayPacket.h kernels, so t, u, v and edge hits are bit identical to theirs, unless the compiler
+	// fuses a * b + c on its own (GCC's default -ffp-contract=fast for an FMA target with GM_NO_SIMD).
+	template<typename T>
+	inline bool intersect(const Ray<T>& ray, const Vec<3, T>& v0, const Vec<3, T>& v1, const Vec<3, T>& v2, T& tMax, T& u, T& v)
+	{
+		Vec<3, T> e1 = v1 - v0, e2 = v2 - v0;
+		Vec<3, T> p = detail::rayCross(ray.direction, e2);
+		T invDet = (T)1 / detail::rayDot(e1, p);
+		Vec<3, T> s = ray.origin - v0;
+		T bu = detail::rayDot(s, p) * invDet;
+		Vec<3, T> q = detail::rayCross(s, e1);
+		T bv = detail::rayDot(ray.direction, q) * invDet;
+		T t = detail::rayDot(e2, q) * invDet;
+		if (!(bu >= 0 && bv >= 0 && bu + bv <= 1 && t >= 0 && t < tMax))
+			return false;
+		tMax = t;
+		u = bu;
+		v = bv;
+		return true;
+	}
+}
@@ -0,0 +1,274 @@
+#pragma once
+#include <cstdint>
+#include "Ray.h"
+#include "Pack.h"
+
+namespace gm
+{
+	// SoA packets for ray queries, N = 4, 8, 16 (at most 32) rays or primitives, padded to whole simd::Packs
+	// (4 floats with SSE, 8 with AVX, 16 with AVX-512) and tested one Pack per iteration.
+	// RayPacket keeps origin, direction, the precomputed 1 / direction and tMax of every ray, plus u, v of its closest hit.
+	// TrianglePacket keeps v0 and the edges v1 - v0, v2 - v0, BoxPacket min and max.
+	//
+	// intersect(rays, v0, v1, v2)        every ray against one triangle (Möller-Trumbore), hits shorten tMax and set u, v
+	// intersect(rays, box, tNear)        every ray against one box (slabs), tNear may be null
+	// intersect(ray, triangles, ...)     one ray against N triangles, the closest hit in [0, tMax)
+	// intersect(ray, boxes, tMax, tNear) one ray against N boxes, intersectSlabs() takes 1 / direction precomputed
+	// The packet forms return bit i for ray or primitive i that was hit. Padding lanes never hit.
+	// Padding lanes are computed too, an N below the Pack width can be slower than N scalar tests.
+	template<int N, typename T>
+	struct RayPacket
+	{
+		static_assert(N >= 1 && N <= 32, "hit masks are 32 bit");
+		static const int lanes = (N + simd::Pack<T>::size - 1) / simd::Pack<T>::size * simd::Pack<T>::size;
+
+		// [axis][ray], padding rays have tMax 0
+		alignas(64) T origin[3][lanes];
+		alignas(64) T direction[3][lanes];
+		alignas(64) T invDirection[3][lanes];
+		alignas(64) T tMax[lanes];
+		alignas(64) T u[lanes];
+		alignas(64) T v[lanes];
+
+		inline RayPacket() : origin(), direction(), invDirection(), tMax(), u(), v() {}
+		inline RayPacket(const Ray<T>* rays, T maxDistance) : RayPacket()
+		{
+			for (int i = 0; i < N; ++i)
+				set(i, rays[i], maxDistance);
+		}
+
+		inline void set(int i, const Ray<T>& ray, T maxDistance)
+		{
+			for (int a = 0; a < 3; ++a)
+			{
+				origin[a][i] = ray.origin[a];
+				direction[a][i] = ray.direction[a];
+				invDirection[a][i] = (T)1 / ray.direction[a];
+			}
+			tMax[i] = maxDistance;
+		}
+
+		inline Ray<T> ray(int i) const
+		{
+			return Ray<T>(Vec<3, T>(origin[0][i], origin[1][i], origin[2][i]), Vec<3, T>(direction[0][i], direction[1][i], direction[2][i]));
+		}
+	};
+
+	template<int N, typename T>
+	struct TrianglePacket
+	{
+		static_assert(N >= 1 && N <= 32, "hit masks are 32 bit");
+		static const int lanes = (N + simd::Pack<T>::size - 1) / simd::Pack<T>::size * simd::Pack<T>::size;
+
+		// [axis][triangle], padding triangles are degenerate
+		alignas(64) T v0[3][lanes];
+		alignas(64) T edge1[3][lanes];
+		alignas(64) T edge2[3][lanes];
+
+		inline TrianglePacket() : v0(), edge1(), edge2() {}
+
+		inline void set(int i, const Vec<3, T>& a, const Vec<3, T>& b, const Vec<3, T>& c)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				v0[k][i] = a[k];
+				edge1[k][i] = b[k] - a[k];
+				edge2[k][i] = c[k] - a[k];
+			}
+		}
+	};
+
+	template<int N, typename T>
+	struct BoxPacket
+	{
+		static_assert(N >= 1 && N <= 32, "hit masks are 32 bit");
+		static const int lanes = (N + simd::Pack<T>::size - 1) / simd::Pack<T>::size * simd::Pack<T>::size;
+
+		// [axis][box]
+		alignas(64) T min[3][lanes];
+		alignas(64) T max[3][lanes];
+
+		inline BoxPacket() : min(), max() {}
+
+		inline void set(int i, const AABB<3, T>& box)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				min[k][i] = box.min[k];
+				max[k][i] = box.max[k];
+			}
+		}
+	};
+
+	namespace detail
+	{
+		// Möller-Trumbore on one Pack of lanes, rays or triangles broadcast as needed: s = origin - v0
+		template<typename P>
+		inline typename P::Mask intersectTriangle(const P d[3], const P s[3], const P e1[3], const P e2[3], const P& tMax, P& t, P& u, P& v)
+		{
+			P p[3] =
+			{
+				simd::nmadd(d[2], e2[1], d[1] * e2[2]),
+				simd::nmadd(d[0], e2[2], d[2] * e2[0]),
+				simd::nmadd(d[1], e2[0], d[0] * e2[1])
+			};
+			P invDet = P(1) / simd::madd(e1[0], p[0], simd::madd(e1[1], p[1], e1[2] * p[2]));
+			u = simd::madd(s[0], p[0], simd::madd(s[1], p[1], s[2] * p[2])) * invDet;
+			P q[3] =
+			{
+				simd::nmadd(s[2], e1[1], s[1] * e1[2]),
+				simd::nmadd(s[0], e1[2], s[2] * e1[0]),
+				simd::nmadd(s[1], e1[0], s[0] * e1[1])
+			};
+			v = simd::madd(d[0], q[0], simd::madd(d[1], q[1], d[2] * q[2])) * invDet;
+			t = simd::madd(e2[0], q[0], simd::madd(e2[1], q[1], e2[2] * q[2])) * invDet;
+			P zero(0);
+			return (u >= zero) & (v >= zero) & (u + v <= P(1)) & (t >= zero) & (t < tMax);
+		}
+
+		// slab test on one Pack of lanes, tNear is the entry distance clamped to 0
+		template<typename P>
+		inline typename P::Mask intersectSlabs(const P o[3], const P inv[3], const P lo[3], const P hi[3], const P& tMax, P& tNear)
+		{
+			P t0(0), t1 = tMax;
+			for (int a = 0; a < 3; ++a)
+			{
+				P x = (lo[a] - o[a]) * inv[a];
+				P y = (hi[a] - o[a]) * inv[a];
+				t0 = simd::max(t0, simd::min(x, y));
+				t1 = simd::min(t1, simd::max(x, y));
+			}
+			tNear = t0;
+			return t0 <= t1;
+		}
+	}
+
+	template<int N, typename T>
+	inline uint32_t intersect(RayPacket<N, T>& rays, const Vec<3, T>& v0, const Vec<3, T>& v1, const Vec<3, T>& v2)
+	{
+		typedef simd::Pack<T> P;
+		const P e1[3] = { P(v1[0] - v0[0]), P(v1[1] - v0[1]), P(v1[2] - v0[2]) };
+		const P e2[3] = { P(v2[0] - v0[0]), P(v2[1] - v0[1]), P(v2[2] - v0[2]) };
+		const P p0[3] = { P(v0[0]), P(v0[1]), P(v0[2]) };
+		uint32_t hits = 0;
+		for (int i = 0; i < RayPacket<N, T>::lanes; i += P::size)
+		{
+			P d[3], s[3];
+			for (int a = 0; a < 3; ++a)
+			{
+				d[a] = P::loadu(rays.direction[a] + i);
+				s[a] = P::loadu(rays.origin[a] + i) - p0[a];
+			}
+			P tMax = P::loadu(rays.tMax + i), t, u, v;
+			typename P::Mask hit = detail::intersectTriangle(d, s, e1, e2, tMax, t, u, v);
+			simd::select(hit, t, tMax).storeu(rays.tMax + i);
+			simd::select(hit, u, P::loadu(rays.u + i)).storeu(rays.u + i);
+			simd::select(hit, v, P::loadu(rays.v + i)).storeu(rays.v + i);
+			hits |= (uint32_t)simd::bits(hit) << i;
+		}
+		return hits;
+	}
+
+	template<int N, typename T>
+	inline uint32_t intersect(const RayPacket<N, T>& rays, const AABB<3, T>& box, T* tNear = nullptr)
+	{
+		typedef simd::Pack<T> P;
+		const P lo[3] = { P(box.min[0]), P(box.min[1]), P(box.min[2]) };
+		const P hi[3] = { P(box.max[0]), P(box.max[1]), P(box.max[2]) };
+		alignas(64) T near[RayPacket<N, T>::lanes];
+		uint32_t hits = 0;
+		for (int i = 0; i < RayPacket<N, T>::lanes; i += P::size)
+		{
+			P o[3], inv[3];
+			for (int a = 0; a < 3; ++a)
+			{
+				o[a] = P::loadu(rays.origin[a] + i);
+				inv[a] = P::loadu(rays.invDirection[a] + i);
+			}
+			P t;
+			hits |= (uint32_t)simd::bits(detail::intersectSlabs(o, inv, lo, hi, P::loadu(rays.tMax + i), t)) << i;
+			t.store(near + i);
+		}
+		if (tNear)
+			for (int i = 0; i < N; ++i)
+				tNear[i] = near[i];
+		// padding rays have tMax 0, a box around their origin still passes
+		return N == 32 ? hits : hits & ((1u << N) - 1);
+	}
+
+	// Index of the closest triangle hit in [0, tMax), -1 for none. A hit shortens tMax and sets u, v,
+	// equal distances go to the lowest index.
+	template<int N, typename T>
+	inline int intersect(const Ray<T>& ray, const TrianglePacket<N, T>& triangles, T& tMax, T& u, T& v)
+	{
+		typedef simd::Pack<T> P;
+		const P d[3] = { P(ray.direction[0]), P(ray.direction[1]), P(ray.direction[2]) };
+		const P o[3] = { P(ray.origin[0]), P(ray.origin[1]), P(ray.origin[2]) };
+		const int lanes = TrianglePacket<N, T>::lanes;
+		alignas(64) T bestT[lanes], bestU[lanes], bestV[lanes];
+		P limit(tMax);
+		for (int i = 0; i < lanes; i += P::size)
+		{
+			P s[3], e1[3], e2[3];
+			for (int a = 0; a < 3; ++a)
+			{
+				s[a] = o[a] - P::loadu(triangles.v0[a] + i);
+				e1[a] = P::loadu(triangles.edge1[a] + i);
+				e2[a] = P::loadu(triangles.edge2[a] + i);
+			}
+			P t, bu, bv;
+			typename P::Mask hit = detail::intersectTriangle(d, s, e1, e2, limit, t, bu, bv);
+			simd::select(hit, t, limit).store(bestT + i);
+			bu.store(bestU + i);
+			bv.store(bestV + i);
+		}
+		// branchless, hits are unpredictable
+		int best = -1;
+		for (int i = 0; i < N; ++i)
+		{
+			bool closer = bestT[i] < tMax;
+			tMax = closer ? bestT[i] : tMax;
+			best = closer ? i : best;
+		}
+		if (best >= 0)
+		{
+			u = bestU[best];
+			v = bestV[best];
+		}
+		return best;
+	}
+
+	template<int N, typename T>
+	inline uint32_t intersectSlabs(const Vec<3, T>& origin, const Vec<3, T>& invDirection, const BoxPacket<N, T>& boxes, T tMax, T* tNear = nullptr)
+	{
+		typedef simd::Pack<T> P;
+		const P o[3] = { P(origin[0]), P(origin[1]), P(origin[2]) };
+		const P inv[3] = { P(invDirection[0]), P(invDirection[1]), P(invDirection[2]) };
+		const P limit(tMax);
+		alignas(64) T near[BoxPacket<N, T>::lanes];
+		uint32_t hits = 0;
+		for (int i = 0; i < BoxPacket<N, T>::lanes; i += P::size)
+		{
+			P lo[3], hi[3];
+			for (int a = 0; a < 3; ++a)
+			{
+				lo[a] = P::loadu(boxes.min[a] + i);
+				hi[a] = P::loadu(boxes.max[a] + i);
+			}
+			P t;
+			hits |= (uint32_t)simd::bits(detail::intersectSlabs(o, inv, lo, hi, limit, t)) << i;
+			t.store(near + i);
+		}
+		if (tNear)
+			for (int i = 0; i < N; ++i)
+				tNear[i] = near[i];
+		// padding boxes are empty points at 0
+		return N == 32 ? hits : hits & ((1u << N) - 1);
+	}
+
+	template<int N, typename T>
+	inline uint32_t intersect(const Ray<T>& ray, const BoxPacket<N, T>& boxes, T tMax, T* tNear = nullptr)
+	{
+		return intersectSlabs(ray.origin, (T)1 / ray.direction, boxes, tMax, tNear);
+	}
+}
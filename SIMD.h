@@ -0,0 +1,207 @@
+#pragma once
+
+// SIMD configuration.
+// Define GM_NO_SIMD before including any gm header to fall back to the scalar templates.
+// Otherwise the instruction set is picked from the compiler flags (-msse2, -mavx, -mfma, /arch:AVX2 ...).
+
+#if !defined(GM_NO_SIMD)
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define GM_SIMD_SSE2 1
+	#endif
+	#if defined(GM_SIMD_SSE2) && (defined(__SSE4_1__) || defined(__AVX__))
+		#define GM_SIMD_SSE4 1
+	#endif
+	#if defined(GM_SIMD_SSE2) && defined(__AVX__)
+		#define GM_SIMD_AVX 1
+	#endif
+	#if defined(GM_SIMD_AVX) && (defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__)))
+		#define GM_SIMD_FMA 1
+	#endif
+	#if defined(GM_SIMD_AVX) && defined(__AVX2__)
+		#define GM_SIMD_AVX2 1
+	#endif
+	#if defined(GM_SIMD_AVX) && (defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__)))
+		#define GM_SIMD_F16C 1
+	#endif
+	#if defined(GM_SIMD_AVX2) && defined(__AVX512F__) && defined(__AVX512DQ__) && defined(__AVX512BW__) && defined(__AVX512VL__)
+		#define GM_SIMD_AVX512 1
+	#endif
+#endif
+
+#if defined(GM_SIMD_SSE2)
+	#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+	#define GM_FORCEINLINE __forceinline
+#else
+	#define GM_FORCEINLINE inline __attribute__((always_inline))
+#endif
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#if defined(_MSC_VER)
+	#include <malloc.h>
+#endif
+
+// Constant evaluation.
+// Templates are constexpr in every language mode, but they only evaluate at compile time from C++20 on,
+// which allows uninitialized locals and writing a union member that is not active yet.
+// GM_CONSTEXPR marks the non-template SIMD specializations, which are constexpr from C++20 only.
+// GM_IS_CONSTANT_EVALUATED() picks the scalar path of those and of the cx:: math functions during constant evaluation.
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201907L
+	#define GM_CONSTEXPR constexpr
+#else
+	#define GM_CONSTEXPR
+#endif
+
+#if defined(__has_builtin)
+	#if __has_builtin(__builtin_is_constant_evaluated)
+		#define GM_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+	#endif
+#endif
+#if !defined(GM_IS_CONSTANT_EVALUATED) && ((defined(__GNUC__) && __GNUC__ >= 9) || (defined(_MSC_VER) && _MSC_VER >= 1925))
+	#define GM_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#if !defined(GM_IS_CONSTANT_EVALUATED)
+	#define GM_IS_CONSTANT_EVALUATED() false
+#endif
+
+// Output size in bytes above which StoreMode::Auto switches to non-temporal stores,
+// roughly the L2 size: bigger outputs would only evict the inputs from cache.
+#if !defined(GM_STREAMING_THRESHOLD)
+	#define GM_STREAMING_THRESHOLD (1024 * 1024)
+#endif
+
+namespace gm
+{
+	// How bulk kernels write their output: through the cache or with non-temporal (streaming) stores.
+	enum class StoreMode
+	{
+		Auto,
+		Cached,
+		Streaming
+	};
+
+	inline bool useStreaming(StoreMode mode, const void* in, const void* out, size_t bytes)
+	{
+		if (mode == StoreMode::Cached)
+			return false;
+		if (mode == StoreMode::Streaming)
+			return in != out;
+		return in != out && bytes > GM_STREAMING_THRESHOLD;
+	}
+
+	namespace simd
+	{
+		inline void* alignedAlloc(size_t bytes, size_t alignment = 64)
+		{
+		#if defined(_MSC_VER)
+			return _aligned_malloc(bytes, alignment);
+		#else
+			void* p = nullptr;
+			return posix_memalign(&p, alignment, bytes) == 0 ? p : nullptr;
+		#endif
+		}
+
+		inline void alignedFree(void* p)
+		{
+		#if defined(_MSC_VER)
+			_aligned_free(p);
+		#else
+			free(p);
+		#endif
+		}
+
+		// std::allocator replacement for containers of cache line aligned data
+		template<typename T, size_t Alignment = 64>
+		struct AlignedAllocator
+		{
+			typedef T value_type;
+			template<typename U>
+			struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+			inline AlignedAllocator() = default;
+			template<typename U>
+			inline AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+			inline T* allocate(size_t n)
+			{
+				void* p = alignedAlloc(n * sizeof(T), Alignment);
+				if (!p)
+					throw std::bad_alloc();
+				return static_cast<T*>(p);
+			}
+			inline void deallocate(T* p, size_t) { alignedFree(p); }
+
+			template<typename U>
+			inline bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+			template<typename U>
+			inline bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+		};
+	}
+}
+
+#if defined(GM_SIMD_SSE2)
+namespace gm
+{
+	namespace simd
+	{
+		// a * b + c, fused when FMA is available
+		GM_FORCEINLINE __m128 madd(__m128 a, __m128 b, __m128 c)
+		{
+		#if defined(GM_SIMD_FMA)
+			return _mm_fmadd_ps(a, b, c);
+		#else
+			return _mm_add_ps(_mm_mul_ps(a, b), c);
+		#endif
+		}
+
+		// c - a * b, fused when FMA is available
+		GM_FORCEINLINE __m128 nmadd(__m128 a, __m128 b, __m128 c)
+		{
+		#if defined(GM_SIMD_FMA)
+			return _mm_fnmadd_ps(a, b, c);
+		#else
+			return _mm_sub_ps(c, _mm_mul_ps(a, b));
+		#endif
+		}
+
+		template<int X, int Y, int Z, int W>
+		GM_FORCEINLINE __m128 shuffle(__m128 v)
+		{
+		#if defined(GM_SIMD_AVX)
+			return _mm_permute_ps(v, _MM_SHUFFLE(W, Z, Y, X));
+		#else
+			return _mm_shuffle_ps(v, v, _MM_SHUFFLE(W, Z, Y, X));
+		#endif
+		}
+
+		template<int I>
+		GM_FORCEINLINE __m128 splat(__m128 v)
+		{
+			return shuffle<I, I, I, I>(v);
+		}
+
+		// horizontal sum broadcasted to all lanes
+		GM_FORCEINLINE __m128 hsum(__m128 v)
+		{
+			__m128 s = _mm_add_ps(v, shuffle<1, 0, 3, 2>(v));
+			return _mm_add_ps(s, shuffle<2, 3, 0, 1>(s));
+		}
+
+		// cross product of the xyz lanes, w lane is 0
+		GM_FORCEINLINE __m128 cross3(__m128 a, __m128 b)
+		{
+			__m128 r = _mm_mul_ps(shuffle<1, 2, 0, 3>(a), shuffle<2, 0, 1, 3>(b));
+			return nmadd(shuffle<2, 0, 1, 3>(a), shuffle<1, 2, 0, 3>(b), r);
+		}
+
+		GM_FORCEINLINE __m128 signMask()
+		{
+			return _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+		}
+	}
+}
+#endif
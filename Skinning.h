@@ -0,0 +1,355 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include "Matrices.h"
+#include "Affine.h"
+#include "DualQuat.h"
+#include "Pack.h"
+
+namespace gm
+{
+	// Linear blend skinning: every vertex is moved by the weighted sum of its bones' matrices,
+	// p' = sum(weights[i] * palette[bones[i]]) * (p, 1), normals by the 3x3 part of the same sum, renormalized.
+	//
+	// The palette holds the affine part of every skinning matrix, bone world * inverse bind, as Mat<3, 4, T>:
+	// 4 columns of 3 rows, 48 bytes for float (Affine.h). skinningPalette() builds it from 4x4 or 3x4 matrices.
+	// SkinInfluences<N, T> holds 4 or 8 influences per vertex, weights should sum to 1,
+	// unused influences have weight 0 and any valid bone.
+	//
+	// skin(palette, influences, positions, normals, outPositions, outNormals, count) skins count vertices,
+	// normals and outNormals may be null, out may be the same array as in. For float with SSE2 the bones of one vertex
+	// are blended as 12 floats in registers (one masked load per bone with AVX-512), 4 vertices are transposed
+	// into one register per matrix entry and transformed together.
+	// More than 16384 vertices are split between up to threads std::threads (0: hardware_concurrency()).
+	//
+	// skin(dualQuatPalette, ...) is dual quaternion skinning with the same influences, 32 bytes per bone:
+	// the bones are blended with dlb(), which keeps volume at twisted joints where the blended matrices collapse.
+	// The normals need no renormalization.
+	template<int N, typename T>
+	struct SkinInfluences
+	{
+		T weights[N];
+		uint16_t bones[N];
+	};
+
+	template<typename T>
+	inline void skinningPalette(const DualQuat<T>* bones, const DualQuat<T>* inverseBind, DualQuat<T>* palette, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			palette[i] = bones[i] * inverseBind[i];
+	}
+
+	template<typename T>
+	inline void skinningPalette(const Mat<4, 4, T>* bones, const Mat<4, 4, T>* inverseBind, Mat<3, 4, T>* palette, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			palette[i] = toAffine(bones[i] * inverseBind[i]);
+	}
+
+	template<typename T>
+	inline void skinningPalette(const Mat<3, 4, T>* bones, const Mat<3, 4, T>* inverseBind, Mat<3, 4, T>* palette, size_t count)
+	{
+		multiply(bones, inverseBind, palette, count);
+	}
+
+	namespace detail
+	{
+		template<int N, typename T>
+		inline void skinRange(const Mat<3, 4, T>* palette, const SkinInfluences<N, T>* influences, const Vec<3, T>* positions, const Vec<3, T>* normals,
+			Vec<3, T>* outPositions, Vec<3, T>* outNormals, size_t begin, size_t end)
+		{
+			for (size_t v = begin; v < end; ++v)
+			{
+				T m[12] = {};
+				for (int i = 0; i < N; ++i)
+				{
+					const T* b = palette[influences[v].bones[i]].values;
+					T w = influences[v].weights[i];
+					for (int k = 0; k < 12; ++k)
+						m[k] += w * b[k];
+				}
+				Vec<3, T> p = positions[v], n;
+				if (normals)
+					n = normals[v];
+				for (int r = 0; r < 3; ++r)
+					outPositions[v][r] = m[r] * p[0] + m[3 + r] * p[1] + m[6 + r] * p[2] + m[9 + r];
+				if (normals)
+				{
+					Vec<3, T> y;
+					for (int r = 0; r < 3; ++r)
+						y[r] = m[r] * n[0] + m[3 + r] * n[1] + m[6 + r] * n[2];
+					outNormals[v] = y * ((T)1 / std::sqrt(y[0] * y[0] + y[1] * y[1] + y[2] * y[2]));
+				}
+			}
+		}
+
+		template<int N, typename T>
+		inline void skinRange(const DualQuat<T>* palette, const SkinInfluences<N, T>* influences, const Vec<3, T>* positions, const Vec<3, T>* normals,
+			Vec<3, T>* outPositions, Vec<3, T>* outNormals, size_t begin, size_t end)
+		{
+			for (size_t v = begin; v < end; ++v)
+			{
+				DualQuat<T> bones[N];
+				for (int i = 0; i < N; ++i)
+					bones[i] = palette[influences[v].bones[i]];
+				DualQuat<T> dq = dlb(bones, influences[v].weights, N);
+				Vec<3, T> n;
+				if (normals)
+					n = normals[v];
+				outPositions[v] = transformPoint(dq, positions[v]);
+				if (normals)
+					outNormals[v] = transformVector(dq, n);
+			}
+		}
+
+	#if defined(GM_SIMD_SSE2)
+		// weighted sum of the vertex's bones, matrix entries 0-3, 4-7 and 8-11 in a, b and c
+		template<int N>
+		GM_FORCEINLINE void blendBones(const Mat<3, 4, float>* palette, const SkinInfluences<N, float>& v, __m128& a, __m128& b, __m128& c)
+		{
+		#if defined(GM_SIMD_AVX512)
+			__m512 m = _mm512_setzero_ps();
+			for (int i = 0; i < N; ++i)
+				m = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(0x0fff, palette[v.bones[i]].values), _mm512_set1_ps(v.weights[i]), m);
+			a = _mm512_castps512_ps128(m);
+			b = _mm512_extractf32x4_ps(m, 1);
+			c = _mm512_extractf32x4_ps(m, 2);
+		#elif defined(GM_SIMD_AVX)
+			__m256 ab = _mm256_setzero_ps();
+			c = _mm_setzero_ps();
+			for (int i = 0; i < N; ++i)
+			{
+				const float* p = palette[v.bones[i]].values;
+				__m256 w = _mm256_set1_ps(v.weights[i]);
+			#if defined(GM_SIMD_FMA)
+				ab = _mm256_fmadd_ps(_mm256_loadu_ps(p), w, ab);
+			#else
+				ab = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(p), w), ab);
+			#endif
+				c = simd::madd(_mm_loadu_ps(p + 8), _mm256_castps256_ps128(w), c);
+			}
+			a = _mm256_castps256_ps128(ab);
+			b = _mm256_extractf128_ps(ab, 1);
+		#else
+			a = b = c = _mm_setzero_ps();
+			for (int i = 0; i < N; ++i)
+			{
+				const float* p = palette[v.bones[i]].values;
+				__m128 w = _mm_set1_ps(v.weights[i]);
+				a = simd::madd(_mm_loadu_ps(p), w, a);
+				b = simd::madd(_mm_loadu_ps(p + 4), w, b);
+				c = simd::madd(_mm_loadu_ps(p + 8), w, c);
+			}
+		#endif
+		}
+
+		// 4 vertices, 12 floats of positions / normals each
+		template<int N>
+		GM_FORCEINLINE void skinQuad(const Mat<3, 4, float>* palette, const SkinInfluences<N, float>* v, const float* p, const float* n, float* op, float* on)
+		{
+			__m128 a0, b0, c0, a1, b1, c1, a2, b2, c2, a3, b3, c3;
+			blendBones(palette, v[0], a0, b0, c0);
+			blendBones(palette, v[1], a1, b1, c1);
+			blendBones(palette, v[2], a2, b2, c2);
+			blendBones(palette, v[3], a3, b3, c3);
+			// entry k of the 4 matrices in one register: columns (a0 a1 a2) (a3 b0 b1) (b2 b3 c0), translation (c1 c2 c3)
+			simd::transpose4(a0, a1, a2, a3);
+			simd::transpose4(b0, b1, b2, b3);
+			simd::transpose4(c0, c1, c2, c3);
+
+			__m128 x, y, z;
+			simd::deinterleave3(_mm_loadu_ps(p), _mm_loadu_ps(p + 4), _mm_loadu_ps(p + 8), x, y, z);
+			__m128 rx = simd::madd(b2, z, simd::madd(a3, y, simd::madd(a0, x, c1)));
+			__m128 ry = simd::madd(b3, z, simd::madd(b0, y, simd::madd(a1, x, c2)));
+			__m128 rz = simd::madd(c0, z, simd::madd(b1, y, simd::madd(a2, x, c3)));
+			simd::interleave3(rx, ry, rz, x, y, z);
+			_mm_storeu_ps(op, x);
+			_mm_storeu_ps(op + 4, y);
+			_mm_storeu_ps(op + 8, z);
+
+			if (n)
+			{
+				simd::deinterleave3(_mm_loadu_ps(n), _mm_loadu_ps(n + 4), _mm_loadu_ps(n + 8), x, y, z);
+				rx = simd::madd(b2, z, simd::madd(a3, y, _mm_mul_ps(a0, x)));
+				ry = simd::madd(b3, z, simd::madd(b0, y, _mm_mul_ps(a1, x)));
+				rz = simd::madd(c0, z, simd::madd(b1, y, _mm_mul_ps(a2, x)));
+				__m128 s = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(simd::madd(rz, rz, simd::madd(ry, ry, _mm_mul_ps(rx, rx)))));
+				simd::interleave3(_mm_mul_ps(rx, s), _mm_mul_ps(ry, s), _mm_mul_ps(rz, s), x, y, z);
+				_mm_storeu_ps(on, x);
+				_mm_storeu_ps(on + 4, y);
+				_mm_storeu_ps(on + 8, z);
+			}
+		}
+
+		// dlb() without the normalization: weighted sum of real and dual parts, each flipped into the first bone's hemisphere
+		template<int N>
+		GM_FORCEINLINE void blendBones(const DualQuat<float>* palette, const SkinInfluences<N, float>& v, __m128& r, __m128& d)
+		{
+			const DualQuat<float>& first = palette[v.bones[0]];
+			__m128 pivot = _mm_loadu_ps(&first.real.x), w = _mm_set1_ps(v.weights[0]);
+			r = _mm_mul_ps(pivot, w);
+			d = _mm_mul_ps(_mm_loadu_ps(&first.dual.x), w);
+			for (int i = 1; i < N; ++i)
+			{
+				const DualQuat<float>& b = palette[v.bones[i]];
+				__m128 q = _mm_loadu_ps(&b.real.x);
+				__m128 flip = _mm_and_ps(_mm_cmplt_ps(simd::hsum(_mm_mul_ps(pivot, q)), _mm_setzero_ps()), simd::signMask());
+				w = _mm_xor_ps(_mm_set1_ps(v.weights[i]), flip);
+				r = simd::madd(q, w, r);
+				d = simd::madd(_mm_loadu_ps(&b.dual.x), w, d);
+			}
+		}
+
+		// v + 2 * cross(q.xyz, cross(q.xyz, v) + q.w * v) for 4 vertices
+		GM_FORCEINLINE void rotateQuad(__m128 qx, __m128 qy, __m128 qz, __m128 qw, __m128& x, __m128& y, __m128& z)
+		{
+			__m128 tx = simd::madd(qw, x, simd::nmadd(qz, y, _mm_mul_ps(qy, z)));
+			__m128 ty = simd::madd(qw, y, simd::nmadd(qx, z, _mm_mul_ps(qz, x)));
+			__m128 tz = simd::madd(qw, z, simd::nmadd(qy, x, _mm_mul_ps(qx, y)));
+			__m128 cx = simd::nmadd(qz, ty, _mm_mul_ps(qy, tz));
+			__m128 cy = simd::nmadd(qx, tz, _mm_mul_ps(qz, tx));
+			__m128 cz = simd::nmadd(qy, tx, _mm_mul_ps(qx, ty));
+			x = _mm_add_ps(x, _mm_add_ps(cx, cx));
+			y = _mm_add_ps(y, _mm_add_ps(cy, cy));
+			z = _mm_add_ps(z, _mm_add_ps(cz, cz));
+		}
+
+		template<int N>
+		GM_FORCEINLINE void skinQuad(const DualQuat<float>* palette, const SkinInfluences<N, float>* v, const float* p, const float* n, float* op, float* on)
+		{
+			__m128 rx, ry, rz, rw, dx, dy, dz, dw;
+			blendBones(palette, v[0], rx, dx);
+			blendBones(palette, v[1], ry, dy);
+			blendBones(palette, v[2], rz, dz);
+			blendBones(palette, v[3], rw, dw);
+			simd::transpose4(rx, ry, rz, rw);
+			simd::transpose4(dx, dy, dz, dw);
+			__m128 s = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(simd::madd(rw, rw, simd::madd(rz, rz, simd::madd(ry, ry, _mm_mul_ps(rx, rx))))));
+			rx = _mm_mul_ps(rx, s);
+			ry = _mm_mul_ps(ry, s);
+			rz = _mm_mul_ps(rz, s);
+			rw = _mm_mul_ps(rw, s);
+			dx = _mm_mul_ps(dx, s);
+			dy = _mm_mul_ps(dy, s);
+			dz = _mm_mul_ps(dz, s);
+			dw = _mm_mul_ps(dw, s);
+			// DualQuat::translation() / 2
+			__m128 tx = simd::nmadd(rz, dy, simd::madd(ry, dz, simd::nmadd(dw, rx, _mm_mul_ps(rw, dx))));
+			__m128 ty = simd::nmadd(rx, dz, simd::madd(rz, dx, simd::nmadd(dw, ry, _mm_mul_ps(rw, dy))));
+			__m128 tz = simd::nmadd(ry, dx, simd::madd(rx, dy, simd::nmadd(dw, rz, _mm_mul_ps(rw, dz))));
+
+			__m128 x, y, z;
+			simd::deinterleave3(_mm_loadu_ps(p), _mm_loadu_ps(p + 4), _mm_loadu_ps(p + 8), x, y, z);
+			rotateQuad(rx, ry, rz, rw, x, y, z);
+			simd::interleave3(_mm_add_ps(x, _mm_add_ps(tx, tx)), _mm_add_ps(y, _mm_add_ps(ty, ty)), _mm_add_ps(z, _mm_add_ps(tz, tz)), x, y, z);
+			_mm_storeu_ps(op, x);
+			_mm_storeu_ps(op + 4, y);
+			_mm_storeu_ps(op + 8, z);
+
+			if (n)
+			{
+				simd::deinterleave3(_mm_loadu_ps(n), _mm_loadu_ps(n + 4), _mm_loadu_ps(n + 8), x, y, z);
+				rotateQuad(rx, ry, rz, rw, x, y, z);
+				simd::interleave3(x, y, z, x, y, z);
+				_mm_storeu_ps(on, x);
+				_mm_storeu_ps(on + 4, y);
+				_mm_storeu_ps(on + 8, z);
+			}
+		}
+
+		template<typename B, int N>
+		inline void skinQuads(const B* palette, const SkinInfluences<N, float>* influences, const Vec<3, float>* positions, const Vec<3, float>* normals,
+			Vec<3, float>* outPositions, Vec<3, float>* outNormals, size_t begin, size_t end)
+		{
+			// influences are the biggest stream, a few lines ahead of the hardware prefetcher
+			const size_t prefetchDistance = 256 / sizeof(SkinInfluences<N, float>) * 4;
+			size_t v = begin;
+			for (; v + 4 <= end; v += 4)
+			{
+				_mm_prefetch((const char*)(influences + v + prefetchDistance), _MM_HINT_T0);
+				skinQuad(palette, influences + v, &positions[v].x, normals ? &normals[v].x : nullptr, &outPositions[v].x, outNormals ? &outNormals[v].x : nullptr);
+			}
+			if (v == end)
+				return;
+
+			// the last 1-3 vertices padded with weightless ones
+			SkinInfluences<N, float> in[4] = {};
+			Vec<3, float> p[4], n[4], op[4], on[4];
+			for (size_t i = 0; i < 4; ++i)
+			{
+				p[i] = n[i] = Vec<3, float>(1.0f);
+				if (v + i < end)
+				{
+					in[i] = influences[v + i];
+					p[i] = positions[v + i];
+					if (normals)
+						n[i] = normals[v + i];
+				}
+			}
+			skinQuad(palette, in, &p[0].x, normals ? &n[0].x : nullptr, &op[0].x, &on[0].x);
+			for (size_t i = 0; v + i < end; ++i)
+			{
+				outPositions[v + i] = op[i];
+				if (normals)
+					outNormals[v + i] = on[i];
+			}
+		}
+
+		template<int N>
+		inline void skinRange(const Mat<3, 4, float>* palette, const SkinInfluences<N, float>* influences, const Vec<3, float>* positions, const Vec<3, float>* normals,
+			Vec<3, float>* outPositions, Vec<3, float>* outNormals, size_t begin, size_t end)
+		{
+			skinQuads(palette, influences, positions, normals, outPositions, outNormals, begin, end);
+		}
+
+		template<int N>
+		inline void skinRange(const DualQuat<float>* palette, const SkinInfluences<N, float>* influences, const Vec<3, float>* positions, const Vec<3, float>* normals,
+			Vec<3, float>* outPositions, Vec<3, float>* outNormals, size_t begin, size_t end)
+		{
+			skinQuads(palette, influences, positions, normals, outPositions, outNormals, begin, end);
+		}
+	#endif
+
+		template<typename B, int N, typename T>
+		inline void skinParallel(const B* palette, const SkinInfluences<N, T>* influences, const Vec<3, T>* positions, const Vec<3, T>* normals,
+			Vec<3, T>* outPositions, Vec<3, T>* outNormals, size_t count, unsigned threads)
+		{
+			const size_t parallelSize = 16384;
+			if (count >= 2 * parallelSize && !threads)
+				threads = std::max(std::thread::hardware_concurrency(), 1u);
+			size_t chunks = std::min((size_t)threads, count / parallelSize);
+			if (chunks <= 1)
+			{
+				skinRange(palette, influences, positions, normals, outPositions, outNormals, 0, count);
+				return;
+			}
+
+			// whole quads per chunk, rounded up so there are at most chunks of them
+			size_t step = ((count + chunks - 1) / chunks + 3) / 4 * 4;
+			std::vector<std::thread> workers;
+			for (size_t begin = step; begin < count; begin += step)
+				workers.emplace_back([=] { skinRange(palette, influences, positions, normals, outPositions, outNormals, begin, std::min(begin + step, count)); });
+			skinRange(palette, influences, positions, normals, outPositions, outNormals, 0, step);
+			for (std::thread& w : workers)
+				w.join();
+		}
+	}
+
+	template<int N, typename T>
+	inline void skin(const Mat<3, 4, T>* palette, const SkinInfluences<N, T>* influences, const Vec<3, T>* positions, const Vec<3, T>* normals,
+		Vec<3, T>* outPositions, Vec<3, T>* outNormals, size_t count, unsigned threads = 0)
+	{
+		detail::skinParallel(palette, influences, positions, normals, outPositions, outNormals, count, threads);
+	}
+
+	template<int N, typename T>
+	inline void skin(const DualQuat<T>* palette, const SkinInfluences<N, T>* influences, const Vec<3, T>* positions, const Vec<3, T>* normals,
+		Vec<3, T>* outPositions, Vec<3, T>* outNormals, size_t count, unsigned threads = 0)
+	{
+		detail::skinParallel(palette, influences, positions, normals, outPositions, outNormals, count, threads);
+	}
+}
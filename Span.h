@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+
+namespace gm
+{
+	// Non-owning view of count contiguous T, like std::span.
+	// Converts implicitly from arrays, containers with data()/size() and Span<non-const T>.
+	template<typename T>
+	struct Span
+	{
+		inline Span() : ptr(nullptr), count(0) {}
+		inline Span(T* data, size_t size) : ptr(data), count(size) {}
+		template<size_t N>
+		inline Span(T (&array)[N]) : ptr(array), count(N) {}
+		template<typename C, typename = decltype(std::declval<C&>().data()), typename = decltype(std::declval<C&>().size())>
+		inline Span(C& container) : ptr(container.data()), count(container.size()) {}
+		template<typename T2, typename std::enable_if<std::is_same<const T2, T>::value, int>::type = 0>
+		inline Span(const Span<T2>& other) : ptr(other.data()), count(other.size()) {}
+
+		inline T* data() const { return ptr; }
+		inline size_t size() const { return count; }
+		inline bool empty() const { return count == 0; }
+		inline T& operator[](size_t i) const { return ptr[i]; }
+		inline T* begin() const { return ptr; }
+		inline T* end() const { return ptr + count; }
+		inline Span subspan(size_t offset, size_t size) const { return Span(ptr + offset, size); }
+
+	private:
+		T* ptr;
+		size_t count;
+	};
+
+	// Keeps a parameter out of template argument deduction,
+	// so spans can be passed to functions that deduce T from another argument.
+	template<typename T>
+	struct Identity { typedef T type; };
+	template<typename T>
+	using NoDeduce = typename Identity<T>::type;
+}
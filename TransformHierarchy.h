@@ -0,0 +1,325 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include "Matrices.h"
+#include "VecArraySoA.h"
+#include "Pack.h"
+
+namespace gm
+{
+	// Parent / child hierarchy of local position, rotation and scale, composed into world matrices
+	// world = parent world * translate(rotation(q) * diag(scale), position). Rotations must be normalized.
+	//
+	// Nodes are addressed by the handle add() returns, internally they are stored sorted by depth with the locals
+	// in VecArraySoA streams, so every level is one contiguous range whose parents all lie in the level above.
+	// Adding nodes or setParent() re-sorts once on the next update(), adding parents before their children
+	// in breadth first order keeps the order and skips the copy.
+	//
+	// Setters mark a node dirty, update() propagates the flag down level by level and recomputes only dirty nodes:
+	// one simd::Pack of nodes at a time builds the locals and multiplies them by the parents' worlds gathered into lanes,
+	// world matrices are affine with a last row of 0, 0, 0, 1.
+	// Levels bigger than 4096 nodes are split between up to threads std::threads (0: hardware_concurrency()).
+	// update() returns right away when nothing changed, and starts at the topmost dirty level otherwise.
+	template<typename T>
+	struct TransformHierarchy
+	{
+		static const uint32_t NoParent = ~0u;
+		static const size_t parallelSize = 4096;
+
+		inline TransformHierarchy() : count(0), sorted(true), dirtyLevel(0) {}
+
+		inline uint32_t add(uint32_t parent = NoParent, const Vec<3, T>& position = Vec<3, T>((T)0),
+			const Quat<T>& rotation = Quat<T>::identity, const Vec<3, T>& scale = Vec<3, T>((T)1));
+
+		// parent must not be node or one of its descendants
+		inline void setParent(uint32_t node, uint32_t parent);
+		inline void setPosition(uint32_t node, const Vec<3, T>& position) { positions.set(slots[node], position); markDirty(slots[node]); }
+		inline void setRotation(uint32_t node, const Quat<T>& rotation) { rotations.set(slots[node], Vec<4, T>(rotation.x, rotation.y, rotation.z, rotation.w)); markDirty(slots[node]); }
+		inline void setScale(uint32_t node, const Vec<3, T>& scale) { scales.set(slots[node], scale); markDirty(slots[node]); }
+		inline void setLocal(uint32_t node, const Vec<3, T>& position, const Quat<T>& rotation, const Vec<3, T>& scale)
+		{
+			uint32_t s = slots[node];
+			positions.set(s, position);
+			rotations.set(s, Vec<4, T>(rotation.x, rotation.y, rotation.z, rotation.w));
+			scales.set(s, scale);
+			markDirty(s);
+		}
+
+		inline size_t size() const { return count; }
+		inline uint32_t parent(uint32_t node) const { return parents[node]; }
+		inline Vec<3, T> position(uint32_t node) const { return positions.get(slots[node]); }
+		inline Quat<T> rotation(uint32_t node) const { Vec<4, T> q = rotations.get(slots[node]); return Quat<T>(q[0], q[1], q[2], q[3]); }
+		inline Vec<3, T> scale(uint32_t node) const { return scales.get(slots[node]); }
+		// as of the last update()
+		inline const Mat<4, 4, T>& world(uint32_t node) const { return worlds[slots[node]]; }
+
+		inline void update(unsigned threads = 0);
+
+	private:
+		inline void markDirty(uint32_t s)
+		{
+			dirty[s] = 1;
+			if (sorted && depths[s] < dirtyLevel)
+				dirtyLevel = depths[s];
+		}
+
+		inline void reserve(size_t size);
+		inline void sort();
+		inline void updateRange(size_t begin, size_t end);
+
+		// by handle
+		std::vector<uint32_t> parents;
+		std::vector<uint32_t> slots;
+		// by slot, the SoA streams keep at least one Pack past count so whole Packs load from any slot
+		VecArraySoA<3, T> positions, scales;
+		VecArraySoA<4, T> rotations;
+		std::vector<Mat<4, 4, T>, simd::AlignedAllocator<Mat<4, 4, T>, 64>> worlds;
+		std::vector<uint32_t> parentSlots;
+		std::vector<uint32_t> depths;
+		std::vector<uint8_t> dirty;
+		// first slot of every depth, then count
+		std::vector<size_t> levels;
+		size_t count;
+		bool sorted;
+		uint32_t dirtyLevel;
+	};
+
+	template<typename T>
+	const uint32_t TransformHierarchy<T>::NoParent;
+	template<typename T>
+	const size_t TransformHierarchy<T>::parallelSize;
+
+	template<typename T>
+	inline void TransformHierarchy<T>::reserve(size_t size)
+	{
+		size_t padded = size + simd::Pack<T>::size;
+		if (padded <= positions.size())
+			return;
+		padded = std::max(padded, positions.size() * 2);
+		positions.resize(padded);
+		scales.resize(padded);
+		rotations.resize(padded);
+	}
+
+	template<typename T>
+	inline uint32_t TransformHierarchy<T>::add(uint32_t parent, const Vec<3, T>& position, const Quat<T>& rotation, const Vec<3, T>& scale)
+	{
+		assert(parent == NoParent || parent < count);
+		uint32_t node = (uint32_t)count;
+		reserve(count + 1);
+		parents.push_back(parent);
+		slots.push_back(node);
+		worlds.emplace_back();
+		parentSlots.push_back(parent == NoParent ? NoParent : slots[parent]);
+		depths.push_back(0);
+		dirty.push_back(1);
+		++count;
+		sorted = false;
+		setLocal(node, position, rotation, scale);
+		return node;
+	}
+
+	template<typename T>
+	inline void TransformHierarchy<T>::setParent(uint32_t node, uint32_t parent)
+	{
+		for (uint32_t p = parent; p != NoParent; p = parents[p])
+			assert(p != node);
+		parents[node] = parent;
+		sorted = false;
+		markDirty(slots[node]);
+	}
+
+	template<typename T>
+	inline void TransformHierarchy<T>::sort()
+	{
+		// depths by handle, walking up to the first known depth
+		const uint32_t unknown = ~0u;
+		std::vector<uint32_t> depth(count, unknown), chain;
+		uint32_t maxDepth = 0;
+		for (size_t h = 0; h < count; ++h)
+		{
+			uint32_t n = (uint32_t)h;
+			while (n != NoParent && depth[n] == unknown)
+			{
+				chain.push_back(n);
+				n = parents[n];
+			}
+			uint32_t d = n == NoParent ? 0 : depth[n] + 1;
+			for (size_t i = chain.size(); i-- > 0; ++d)
+				depth[chain[i]] = d;
+			chain.clear();
+			maxDepth = std::max(maxDepth, depth[h]);
+		}
+
+		// counting sort by depth, stable in the current slot order
+		levels.assign(maxDepth + 2, 0);
+		for (size_t h = 0; h < count; ++h)
+			++levels[depth[h] + 1];
+		for (size_t d = 1; d < levels.size(); ++d)
+			levels[d] += levels[d - 1];
+		std::vector<uint32_t> nodes(count), newSlots(count);
+		for (size_t h = 0; h < count; ++h)
+			nodes[slots[h]] = (uint32_t)h;
+		std::vector<size_t> next(levels.begin(), levels.end() - 1);
+		bool moved = false;
+		for (size_t s = 0; s < count; ++s)
+		{
+			uint32_t h = nodes[s];
+			newSlots[h] = (uint32_t)next[depth[h]]++;
+			moved |= newSlots[h] != s;
+		}
+
+		if (moved)
+		{
+			VecArraySoA<3, T> p(positions.size()), sc(scales.size());
+			VecArraySoA<4, T> r(rotations.size());
+			std::vector<Mat<4, 4, T>, simd::AlignedAllocator<Mat<4, 4, T>, 64>> w(count);
+			std::vector<uint8_t> d(count);
+			for (size_t h = 0; h < count; ++h)
+			{
+				uint32_t from = slots[h], to = newSlots[h];
+				p.set(to, positions.get(from));
+				sc.set(to, scales.get(from));
+				r.set(to, rotations.get(from));
+				w[to] = worlds[from];
+				d[to] = dirty[from];
+			}
+			positions = std::move(p);
+			scales = std::move(sc);
+			rotations = std::move(r);
+			worlds = std::move(w);
+			dirty = std::move(d);
+			slots = std::move(newSlots);
+		}
+
+		dirtyLevel = maxDepth + 1;
+		for (size_t h = 0; h < count; ++h)
+		{
+			uint32_t s = slots[h];
+			parentSlots[s] = parents[h] == NoParent ? NoParent : slots[parents[h]];
+			depths[s] = depth[h];
+			if (dirty[s])
+				dirtyLevel = std::min(dirtyLevel, depth[h]);
+		}
+		sorted = true;
+	}
+
+	template<typename T>
+	inline void TransformHierarchy<T>::updateRange(size_t begin, size_t end)
+	{
+		typedef simd::Pack<T> P;
+		const int W = P::size;
+		const T _0 = 0, _1 = 1;
+		// parents' and results' upper 3 rows, column by column, one lane per node
+		alignas(64) T pm[12][W], t[12][W];
+		const T identity[16] = { _1, _0, _0, _0, _0, _1, _0, _0, _0, _0, _1, _0, _0, _0, _0, _1 };
+		const T *px = positions.stream(0), *py = positions.stream(1), *pz = positions.stream(2);
+		const T *sx = scales.stream(0), *sy = scales.stream(1), *sz = scales.stream(2);
+		const T *qx = rotations.stream(0), *qy = rotations.stream(1), *qz = rotations.stream(2), *qw = rotations.stream(3);
+		// locals, the byte stores to the flags would reload the members otherwise
+		uint8_t* flags = dirty.data();
+		const uint32_t* parent = parentSlots.data();
+		Mat<4, 4, T>* world = worlds.data();
+
+		for (size_t i = begin; i < end; i += W)
+		{
+			const size_t n = std::min((size_t)W, end - i);
+			bool any = false;
+			for (size_t j = 0; j < n; ++j)
+			{
+				uint32_t p = parent[i + j];
+				if (p != NoParent && flags[p])
+					flags[i + j] = 1;
+				any |= flags[i + j] != 0;
+			}
+			if (!any)
+				continue;
+			// spelled out, the loops over the 12 entries do not unroll at -O2
+			for (size_t j = 0; j < W; ++j)
+			{
+				uint32_t p = j < n ? parent[i + j] : NoParent;
+				const T* m = p == NoParent ? identity : world[p].values;
+				pm[0][j] = m[0]; pm[1][j] = m[1]; pm[2][j] = m[2];
+				pm[3][j] = m[4]; pm[4][j] = m[5]; pm[5][j] = m[6];
+				pm[6][j] = m[8]; pm[7][j] = m[9]; pm[8][j] = m[10];
+				pm[9][j] = m[12]; pm[10][j] = m[13]; pm[11][j] = m[14];
+			}
+
+			// rotation(q) columns scaled by s, same terms as rotation(const Quat<T>&)
+			P x = P::loadu(qx + i), y = P::loadu(qy + i), z = P::loadu(qz + i), w = P::loadu(qw + i);
+			P x2 = x + x, y2 = y + y, z2 = z + z;
+			P xx = x2 * x, xy = x2 * y, xz = x2 * z, xw = x2 * w;
+			P yy = y2 * y, yz = y2 * z, yw = y2 * w, zz = z2 * z, zw = z2 * w;
+			P s0 = P::loadu(sx + i), s1 = P::loadu(sy + i), s2 = P::loadu(sz + i);
+
+			// parent * local, both affine, column c of the result is a0 * l[c].x + a1 * l[c].y + a2 * l[c].z (+ a3)
+			P a0[3] = { P::load(pm[0]), P::load(pm[1]), P::load(pm[2]) };
+			P a1[3] = { P::load(pm[3]), P::load(pm[4]), P::load(pm[5]) };
+			P a2[3] = { P::load(pm[6]), P::load(pm[7]), P::load(pm[8]) };
+			auto column = [&](const P& lx, const P& ly, const P& lz, T (*out)[W])
+			{
+				simd::madd(a2[0], lz, simd::madd(a1[0], ly, a0[0] * lx)).store(out[0]);
+				simd::madd(a2[1], lz, simd::madd(a1[1], ly, a0[1] * lx)).store(out[1]);
+				simd::madd(a2[2], lz, simd::madd(a1[2], ly, a0[2] * lx)).store(out[2]);
+			};
+			column((P(_1) - yy - zz) * s0, (xy + zw) * s0, (xz - yw) * s0, t);
+			column((xy - zw) * s1, (P(_1) - xx - zz) * s1, (yz + xw) * s1, t + 3);
+			column((xz + yw) * s2, (yz - xw) * s2, (P(_1) - xx - yy) * s2, t + 6);
+			column(P::loadu(px + i), P::loadu(py + i), P::loadu(pz + i), t + 9);
+			(P::load(t[9]) + P::load(pm[9])).store(t[9]);
+			(P::load(t[10]) + P::load(pm[10])).store(t[10]);
+			(P::load(t[11]) + P::load(pm[11])).store(t[11]);
+
+			for (size_t j = 0; j < n; ++j)
+			{
+				if (!flags[i + j])
+					continue;
+				T* m = world[i + j].values;
+				m[0] = t[0][j]; m[1] = t[1][j]; m[2] = t[2][j]; m[3] = _0;
+				m[4] = t[3][j]; m[5] = t[4][j]; m[6] = t[5][j]; m[7] = _0;
+				m[8] = t[6][j]; m[9] = t[7][j]; m[10] = t[8][j]; m[11] = _0;
+				m[12] = t[9][j]; m[13] = t[10][j]; m[14] = t[11][j]; m[15] = _1;
+			}
+		}
+	}
+
+	template<typename T>
+	inline void TransformHierarchy<T>::update(unsigned threads)
+	{
+		if (!sorted)
+			sort();
+		if (dirtyLevel + 1 >= levels.size())
+			return;
+
+		std::vector<std::thread> workers;
+		for (size_t d = dirtyLevel; d + 1 < levels.size(); ++d)
+		{
+			size_t begin = levels[d], end = levels[d + 1];
+			// hardware_concurrency() reads sysfs, only asked for when a level is big enough to split
+			if (!threads && end - begin >= 2 * parallelSize)
+				threads = std::max(std::thread::hardware_concurrency(), 1u);
+			size_t chunks = std::min((size_t)threads, (end - begin) / parallelSize);
+			if (chunks > 1)
+			{
+				// whole Packs per chunk, rounded up so there are at most chunks of them,
+				// the dirty bytes of neighbouring chunks still share lines
+				size_t step = ((end - begin + chunks - 1) / chunks + simd::Pack<T>::size - 1) / simd::Pack<T>::size * simd::Pack<T>::size;
+				for (size_t c = begin + step; c < end; c += step)
+					workers.emplace_back([this, c, step, end] { updateRange(c, std::min(c + step, end)); });
+				updateRange(begin, begin + step);
+				for (std::thread& w : workers)
+					w.join();
+				workers.clear();
+			}
+			else
+				updateRange(begin, end);
+		}
+		std::memset(dirty.data() + levels[dirtyLevel], 0, count - levels[dirtyLevel]);
+		dirtyLevel = (uint32_t)levels.size() - 1;
+	}
+}
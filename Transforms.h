@@ -0,0 +1,460 @@
+#pragma once
+#include <cstdint>
+#include <cassert>
+#include "Matrices.h"
+#include "VecArraySoA.h"
+#include "Span.h"
+#include "Pack.h"
+#include "FastMath.h"
+
+namespace gm
+{
+	// Batched transforms of Vec<3, T> by a Mat<4, 4, T>:
+	//   transformPoints            m * (p, 1), w of the result is ignored
+	//   transformVectors           m * (v, 0)
+	//   transformPointsProjective  m * (p, 1) divided by its w
+	// in and out may be the same buffer. Both AoS spans and VecArraySoA are accepted,
+	// StoreMode::Auto uses streaming stores when out does not alias in and is bigger than GM_STREAMING_THRESHOLD.
+	//
+	// Batched rotation of Vec<3, T> by normalized quaternions:
+	//   rotateVectors(q, in, out)         q * in[i]
+	//   rotateVectors(qs, in, out, count) qs[i] * in[i]
+	// Lanes hold one element each, quaternions and vectors are transposed into one Pack per component.
+	//
+	// Batched rotation builders, one fast::sincos per Pack of angles:
+	//   eulerToQuat(degrees, out, count)    Quat<T>::euler(degrees[i])
+	//   eulerToMatrix(radians, out, count)  rotation(radians[i])
+
+	enum class TransformKind
+	{
+		Point,
+		Vector,
+		Projective
+	};
+
+	template<TransformKind K, typename T>
+	struct TransformKernel
+	{
+		typedef simd::Pack<T> P;
+		P m[16];
+
+		inline explicit TransformKernel(const Mat<4, 4, T> &mat)
+		{
+			for (int i = 0; i < 16; ++i)
+				m[i] = P(mat[i]);
+		}
+
+		inline void operator()(const P& x, const P& y, const P& z, P& ox, P& oy, P& oz) const
+		{
+			P rx = x * m[0], ry = x * m[1], rz = x * m[2];
+			if (K != TransformKind::Vector)
+			{
+				rx += m[12];
+				ry += m[13];
+				rz += m[14];
+			}
+			rx = simd::madd(y, m[4], rx);
+			ry = simd::madd(y, m[5], ry);
+			rz = simd::madd(y, m[6], rz);
+			rx = simd::madd(z, m[8], rx);
+			ry = simd::madd(z, m[9], ry);
+			rz = simd::madd(z, m[10], rz);
+			if (K == TransformKind::Projective)
+			{
+				P invW = P((T)1) / simd::madd(z, m[11], simd::madd(y, m[7], simd::madd(x, m[3], m[15])));
+				rx *= invW;
+				ry *= invW;
+				rz *= invW;
+			}
+			ox = rx;
+			oy = ry;
+			oz = rz;
+		}
+	};
+
+	template<typename T, typename Kernel>
+	inline void transformAoS(const Kernel &kernel, const Vec<3, T> *in, Vec<3, T> *out, size_t count, StoreMode mode)
+	{
+		typedef simd::Pack<T> P;
+		const int W = P::size;
+		bool stream = useStreaming(mode, in, out, count * sizeof(Vec<3, T>)) && W > 1 && std::is_same<T, float>::value;
+
+		size_t i = 0;
+		P x, y, z;
+		// scalar head until out is 16 byte aligned for the streaming stores
+		while (stream && i < count && (reinterpret_cast<uintptr_t>(out + i) & 15))
+		{
+			kernel(P(in[i].x), P(in[i].y), P(in[i].z), x, y, z);
+			out[i] = Vec<3, T>(x[0], y[0], z[0]);
+			++i;
+		}
+		for (; i + W <= count; i += W)
+		{
+			simd::loadAoS3(&in[i].x, x, y, z);
+			kernel(x, y, z, x, y, z);
+			simd::storeAoS3(&out[i].x, x, y, z, stream);
+		}
+		for (; i < count; ++i)
+		{
+			kernel(P(in[i].x), P(in[i].y), P(in[i].z), x, y, z);
+			out[i] = Vec<3, T>(x[0], y[0], z[0]);
+		}
+		if (stream)
+			simd::streamFence();
+	}
+
+	template<typename T, typename Kernel>
+	inline void transformSoA(const Kernel &kernel, const VecArraySoA<3, T> &in, VecArraySoA<3, T> &out, StoreMode mode)
+	{
+		typedef simd::Pack<T> P;
+		if (out.size() != in.size())
+			out = VecArraySoA<3, T>::uninitialized(in.size());
+		bool stream = useStreaming(mode, in.stream(0), out.stream(0), out.stride() * 3 * sizeof(T)) && P::size > 1;
+
+		const T *ix = in.stream(0), *iy = in.stream(1), *iz = in.stream(2);
+		T *ox = out.stream(0), *oy = out.stream(1), *oz = out.stream(2);
+		P x, y, z;
+		for (size_t i = 0; i < in.stride(); i += P::size)
+		{
+			kernel(P::load(ix + i), P::load(iy + i), P::load(iz + i), x, y, z);
+			if (stream)
+			{
+				x.stream(ox + i);
+				y.stream(oy + i);
+				z.stream(oz + i);
+			}
+			else
+			{
+				x.store(ox + i);
+				y.store(oy + i);
+				z.store(oz + i);
+			}
+		}
+		if (stream)
+			simd::streamFence();
+	}
+
+	template<TransformKind K, typename T>
+	inline void transform(const Mat<4, 4, T> &m, const Vec<3, T> *in, Vec<3, T> *out, size_t count, StoreMode mode)
+	{
+		transformAoS(TransformKernel<K, T>(m), in, out, count, mode);
+	}
+
+	template<TransformKind K, typename T>
+	inline void transform(const Mat<4, 4, T> &m, const VecArraySoA<3, T> &in, VecArraySoA<3, T> &out, StoreMode mode)
+	{
+		transformSoA(TransformKernel<K, T>(m), in, out, mode);
+	}
+
+	template<typename T>
+	inline void transformPoints(const Mat<4, 4, T> &m, NoDeduce<Span<const Vec<3, T>>> in, NoDeduce<Span<Vec<3, T>>> out, StoreMode mode = StoreMode::Auto)
+	{
+		assert(out.size() >= in.size());
+		transform<TransformKind::Point>(m, in.data(), out.data(), in.size(), mode);
+	}
+
+	template<typename T>
+	inline void transformVectors(const Mat<4, 4, T> &m, NoDeduce<Span<const Vec<3, T>>> in, NoDeduce<Span<Vec<3, T>>> out, StoreMode mode = StoreMode::Auto)
+	{
+		assert(out.size() >= in.size());
+		transform<TransformKind::Vector>(m, in.data(), out.data(), in.size(), mode);
+	}
+
+	template<typename T>
+	inline void transformPointsProjective(const Mat<4, 4, T> &m, NoDeduce<Span<const Vec<3, T>>> in, NoDeduce<Span<Vec<3, T>>> out, StoreMode mode = StoreMode::Auto)
+	{
+		assert(out.size() >= in.size());
+		transform<TransformKind::Projective>(m, in.data(), out.data(), in.size(), mode);
+	}
+
+	template<typename T>
+	inline void transformPoints(const Mat<4, 4, T> &m, NoDeduce<Span<Vec<3, T>>> inOut)
+	{
+		transform<TransformKind::Point>(m, inOut.data(), inOut.data(), inOut.size(), StoreMode::Cached);
+	}
+
+	template<typename T>
+	inline void transformVectors(const Mat<4, 4, T> &m, NoDeduce<Span<Vec<3, T>>> inOut)
+	{
+		transform<TransformKind::Vector>(m, inOut.data(), inOut.data(), inOut.size(), StoreMode::Cached);
+	}
+
+	template<typename T>
+	inline void transformPointsProjective(const Mat<4, 4, T> &m, NoDeduce<Span<Vec<3, T>>> inOut)
+	{
+		transform<TransformKind::Projective>(m, inOut.data(), inOut.data(), inOut.size(), StoreMode::Cached);
+	}
+
+
+	template<typename T>
+	inline void transformPoints(const Mat<4, 4, T> &m, const VecArraySoA<3, T> &in, VecArraySoA<3, T> &out, StoreMode mode = StoreMode::Auto)
+	{
+		transform<TransformKind::Point>(m, in, out, mode);
+	}
+
+	template<typename T>
+	inline void transformVectors(const Mat<4, 4, T> &m, const VecArraySoA<3, T> &in, VecArraySoA<3, T> &out, StoreMode mode = StoreMode::Auto)
+	{
+		transform<TransformKind::Vector>(m, in, out, mode);
+	}
+
+	template<typename T>
+	inline void transformPointsProjective(const Mat<4, 4, T> &m, const VecArraySoA<3, T> &in, VecArraySoA<3, T> &out, StoreMode mode = StoreMode::Auto)
+	{
+		transform<TransformKind::Projective>(m, in, out, mode);
+	}
+
+	template<typename T>
+	inline void transformPoints(const Mat<4, 4, T> &m, VecArraySoA<3, T> &inOut)
+	{
+		transform<TransformKind::Point>(m, inOut, inOut, StoreMode::Cached);
+	}
+
+	template<typename T>
+	inline void transformVectors(const Mat<4, 4, T> &m, VecArraySoA<3, T> &inOut)
+	{
+		transform<TransformKind::Vector>(m, inOut, inOut, StoreMode::Cached);
+	}
+
+	template<typename T>
+	inline void transformPointsProjective(const Mat<4, 4, T> &m, VecArraySoA<3, T> &inOut)
+	{
+		transform<TransformKind::Projective>(m, inOut, inOut, StoreMode::Cached);
+	}
+
+
+	template<typename T>
+	struct RotationKernel
+	{
+		typedef simd::Pack<T> P;
+		P qx, qy, qz, qw;
+
+		inline RotationKernel() = default;
+		inline explicit RotationKernel(const Quat<T> &q) : qx(q.x), qy(q.y), qz(q.z), qw(q.w) {}
+		inline RotationKernel(const P& x, const P& y, const P& z, const P& w) : qx(x), qy(y), qz(z), qw(w) {}
+
+		// v + w * t + cross(n, t), t = 2 * cross(n, v), same as operator * (Quat, Vec<3, T>)
+		inline void operator()(const P& x, const P& y, const P& z, P& ox, P& oy, P& oz) const
+		{
+			P tx = simd::nmadd(qz, y, qy * z);
+			P ty = simd::nmadd(qx, z, qz * x);
+			P tz = simd::nmadd(qy, x, qx * y);
+			tx += tx;
+			ty += ty;
+			tz += tz;
+			P rx = simd::nmadd(qz, ty, simd::madd(qy, tz, simd::madd(qw, tx, x)));
+			P ry = simd::nmadd(qx, tz, simd::madd(qz, tx, simd::madd(qw, ty, y)));
+			P rz = simd::nmadd(qy, tx, simd::madd(qx, ty, simd::madd(qw, tz, z)));
+			ox = rx;
+			oy = ry;
+			oz = rz;
+		}
+	};
+
+	template<typename T>
+	inline void rotate(const Quat<T> *q, const Vec<3, T> *in, Vec<3, T> *out, size_t count, StoreMode mode)
+	{
+		typedef simd::Pack<T> P;
+		const int W = P::size;
+		bool stream = useStreaming(mode, in, out, count * sizeof(Vec<3, T>)) && W > 1 && std::is_same<T, float>::value;
+
+		size_t i = 0;
+		P x, y, z;
+		RotationKernel<T> kernel;
+		while (stream && i < count && (reinterpret_cast<uintptr_t>(out + i) & 15))
+		{
+			out[i] = q[i] * in[i];
+			++i;
+		}
+		for (; i + W <= count; i += W)
+		{
+			simd::loadAoS4(&q[i].x, kernel.qx, kernel.qy, kernel.qz, kernel.qw);
+			simd::loadAoS3(&in[i].x, x, y, z);
+			kernel(x, y, z, x, y, z);
+			simd::storeAoS3(&out[i].x, x, y, z, stream);
+		}
+		for (; i < count; ++i)
+		{
+			kernel = RotationKernel<T>(q[i]);
+			kernel(P(in[i].x), P(in[i].y), P(in[i].z), x, y, z);
+			out[i] = Vec<3, T>(x[0], y[0], z[0]);
+		}
+		if (stream)
+			simd::streamFence();
+	}
+
+	template<typename T>
+	inline void rotate(const VecArraySoA<4, T> &q, const VecArraySoA<3, T> &in, VecArraySoA<3, T> &out, StoreMode mode)
+	{
+		typedef simd::Pack<T> P;
+		assert(q.size() == in.size());
+		if (out.size() != in.size())
+			out = VecArraySoA<3, T>::uninitialized(in.size());
+		bool stream = useStreaming(mode, in.stream(0), out.stream(0), out.stride() * 3 * sizeof(T)) && P::size > 1;
+
+		const T *ix = in.stream(0), *iy = in.stream(1), *iz = in.stream(2);
+		T *ox = out.stream(0), *oy = out.stream(1), *oz = out.stream(2);
+		P x, y, z;
+		for (size_t i = 0; i < in.stride(); i += P::size)
+		{
+			RotationKernel<T> kernel(P::load(q.stream(0) + i), P::load(q.stream(1) + i), P::load(q.stream(2) + i), P::load(q.stream(3) + i));
+			kernel(P::load(ix + i), P::load(iy + i), P::load(iz + i), x, y, z);
+			if (stream)
+			{
+				x.stream(ox + i);
+				y.stream(oy + i);
+				z.stream(oz + i);
+			}
+			else
+			{
+				x.store(ox + i);
+				y.store(oy + i);
+				z.store(oz + i);
+			}
+		}
+		if (stream)
+			simd::streamFence();
+	}
+
+
+	template<typename T>
+	inline void rotateVectors(const Quat<T> &q, NoDeduce<Span<const Vec<3, T>>> in, NoDeduce<Span<Vec<3, T>>> out, StoreMode mode = StoreMode::Auto)
+	{
+		assert(out.size() >= in.size());
+		transformAoS(RotationKernel<T>(q), in.data(), out.data(), in.size(), mode);
+	}
+
+	template<typename T>
+	inline void rotateVectors(const Quat<T> &q, NoDeduce<Span<Vec<3, T>>> inOut)
+	{
+		transformAoS(RotationKernel<T>(q), inOut.data(), inOut.data(), inOut.size(), StoreMode::Cached);
+	}
+
+	template<typename T>
+	inline void rotateVectors(const Quat<T> &q, const VecArraySoA<3, T> &in, VecArraySoA<3, T> &out, StoreMode mode = StoreMode::Auto)
+	{
+		transformSoA(RotationKernel<T>(q), in, out, mode);
+	}
+
+	template<typename T>
+	inline void rotateVectors(const Quat<T> &q, VecArraySoA<3, T> &inOut)
+	{
+		transformSoA(RotationKernel<T>(q), inOut, inOut, StoreMode::Cached);
+	}
+
+	template<typename T>
+	inline void rotateVectors(const Quat<T> *q, const Vec<3, T> *in, Vec<3, T> *out, size_t count, StoreMode mode = StoreMode::Auto)
+	{
+		rotate(q, in, out, count, mode);
+	}
+
+	// q holds the x, y, z, w components of one quaternion per element
+	template<typename T>
+	inline void rotateVectors(const VecArraySoA<4, T> &q, const VecArraySoA<3, T> &in, VecArraySoA<3, T> &out, StoreMode mode = StoreMode::Auto)
+	{
+		rotate(q, in, out, mode);
+	}
+
+	template<typename T>
+	inline void rotateVectors(const VecArraySoA<4, T> &q, VecArraySoA<3, T> &inOut)
+	{
+		rotate(q, inOut, inOut, StoreMode::Cached);
+	}
+
+
+	template<typename T>
+	struct EulerKernel
+	{
+		typedef simd::Pack<T> P;
+		P sx, cx, sy, cy, sz, cz;
+
+		inline EulerKernel(const P& x, const P& y, const P& z)
+		{
+			fast::sincos(x, sx, cx);
+			fast::sincos(y, sy, cy);
+			fast::sincos(z, sz, cz);
+		}
+
+		inline void quat(P& x, P& y, P& z, P& w) const
+		{
+			P cycz = cy * cz, sysz = sy * sz, sycz = sy * cz, cysz = cy * sz;
+			x = simd::madd(cx, sysz, sx * cycz);
+			y = simd::nmadd(sx, cysz, cx * sycz);
+			z = simd::madd(sx, sycz, cx * cysz);
+			w = simd::nmadd(sx, sysz, cx * cycz);
+		}
+
+		// column major, same as rotation(const Vec<3, T>&)
+		inline void matrix(P* m) const
+		{
+			P sxsy = sx * sy, cxsy = cx * sy;
+			m[0] = cy * cz;
+			m[1] = -(cy * sz);
+			m[2] = sy;
+			m[3] = simd::madd(sxsy, cz, cx * sz);
+			m[4] = simd::nmadd(sxsy, sz, cx * cz);
+			m[5] = -(cy * sx);
+			m[6] = simd::nmadd(cxsy, cz, sx * sz);
+			m[7] = simd::madd(cxsy, sz, cz * sx);
+			m[8] = cx * cy;
+		}
+	};
+
+	template<typename T>
+	inline void eulerToQuat(const Vec<3, T> *degrees, Quat<T> *out, size_t count)
+	{
+		typedef simd::Pack<T> P;
+		const int W = P::size;
+		const P toHalfRad((T)0.00872664625995);
+		P x, y, z, w;
+		for (size_t i = 0; i < count; i += W)
+		{
+			if (i + W <= count)
+			{
+				simd::loadAoS3(&degrees[i].x, x, y, z);
+				EulerKernel<T>(x * toHalfRad, y * toHalfRad, z * toHalfRad).quat(x, y, z, w);
+				simd::storeAoS4(&out[i].x, x, y, z, w);
+			}
+			else
+			{
+				Vec<3, T> in[W];
+				Quat<T> q[W];
+				for (size_t j = 0; j < W; ++j)
+					in[j] = i + j < count ? degrees[i + j] : Vec<3, T>((T)0);
+				simd::loadAoS3(&in[0].x, x, y, z);
+				EulerKernel<T>(x * toHalfRad, y * toHalfRad, z * toHalfRad).quat(x, y, z, w);
+				simd::storeAoS4(&q[0].x, x, y, z, w);
+				for (size_t j = 0; i + j < count; ++j)
+					out[i + j] = q[j];
+			}
+		}
+	}
+
+	template<typename T>
+	inline void eulerToMatrix(const Vec<3, T> *radians, Mat<3, 3, T> *out, size_t count)
+	{
+		typedef simd::Pack<T> P;
+		const int W = P::size;
+		Vec<3, T> in[W];
+		alignas(64) T t[9][W];
+		P x, y, z, m[9];
+		for (size_t i = 0; i < count; i += W)
+		{
+			const size_t n = i + W <= count ? W : count - i;
+			if (n == W)
+				simd::loadAoS3(&radians[i].x, x, y, z);
+			else
+			{
+				for (size_t j = 0; j < W; ++j)
+					in[j] = j < n ? radians[i + j] : Vec<3, T>((T)0);
+				simd::loadAoS3(&in[0].x, x, y, z);
+			}
+			EulerKernel<T>(x, y, z).matrix(m);
+			for (int k = 0; k < 9; ++k)
+				m[k].store(t[k]);
+			for (size_t j = 0; j < n; ++j)
+				for (int k = 0; k < 9; ++k)
+					out[i + j].values[k] = t[k][j];
+		}
+	}
+}
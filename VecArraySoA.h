@@ -0,0 +1,600 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+#include <new>
+#include <utility>
+#include <cstdint>
+#include <type_traits>
+#include "Vectors.h"
+#include "VectorGloabalFuncs.h"
+#include "Quaternion.h"
+#include "Pack.h"
+
+namespace gm
+{
+	// Structure of arrays storage of Vec<L, T>: one 64 byte aligned stream per component.
+	// Every stream is padded to a multiple of Padding elements, so bulk operations
+	// always run whole simd::Pack registers and never need a scalar tail. The padding is zeroed when the storage
+	// is allocated, bulk operations compute it along with the elements.
+	template<int L, typename T>
+	struct VecArraySoA
+	{
+		static const size_t Padding = 16;
+
+		struct Reference
+		{
+			VecArraySoA* array;
+			size_t index;
+
+			inline operator Vec<L, T>() const { return array->get(index); }
+			inline Reference& operator=(const Vec<L, T>& v) { array->set(index, v); return *this; }
+			inline Reference& operator=(const Reference& r) { array->set(index, r.array->get(r.index)); return *this; }
+			inline T& operator[](int c) const { return array->stream(c)[index]; }
+		};
+
+		inline VecArraySoA() : data(nullptr), count(0), padded(0) {}
+		inline explicit VecArraySoA(size_t size) : VecArraySoA()
+		{
+			allocate(size);
+			if (data)
+				std::memset(data, 0, sizeof(T) * L * padded);
+		}
+		inline VecArraySoA(size_t size, const Vec<L, T>& value) : VecArraySoA(size)
+		{
+			fill(value);
+		}
+		inline VecArraySoA(const Vec<L, T>* values, size_t size) : VecArraySoA()
+		{
+			allocate(size);
+			if (data)
+				toSoA(values, size, data, padded, StoreMode::Cached);
+		}
+		inline VecArraySoA(const VecArraySoA& other) : VecArraySoA()
+		{
+			allocate(other.count);
+			if (data)
+				std::memcpy(data, other.data, sizeof(T) * L * padded);
+		}
+		inline VecArraySoA(VecArraySoA&& other) noexcept : data(other.data), count(other.count), padded(other.padded)
+		{
+			other.data = nullptr;
+			other.count = other.padded = 0;
+		}
+		inline VecArraySoA& operator=(VecArraySoA other) noexcept
+		{
+			std::swap(data, other.data);
+			std::swap(count, other.count);
+			std::swap(padded, other.padded);
+			return *this;
+		}
+		inline ~VecArraySoA()
+		{
+			simd::alignedFree(data);
+		}
+
+		// Result storage for bulk operations, the elements are left uninitialized, the padding is zero.
+		static inline VecArraySoA uninitialized(size_t size)
+		{
+			VecArraySoA result;
+			result.allocate(size);
+			return result;
+		}
+
+		inline size_t size() const { return count; }
+		inline size_t stride() const { return padded; }
+		inline T* stream(int c) { return data + c * padded; }
+		inline const T* stream(int c) const { return data + c * padded; }
+
+		inline Vec<L, T> get(size_t i) const
+		{
+			Vec<L, T> v;
+			for (int c = 0; c < L; ++c)
+				v[c] = data[c * padded + i];
+			return v;
+		}
+		inline void set(size_t i, const Vec<L, T>& v)
+		{
+			for (int c = 0; c < L; ++c)
+				data[c * padded + i] = v[c];
+		}
+		inline Reference operator[](size_t i) { return Reference{this, i}; }
+		inline Vec<L, T> operator[](size_t i) const { return get(i); }
+
+		inline void fill(const Vec<L, T>& value)
+		{
+			for (int c = 0; c < L; ++c)
+			{
+				T* p = stream(c);
+				for (size_t i = 0; i < count; ++i)
+					p[i] = value[c];
+			}
+		}
+
+		inline void resize(size_t size)
+		{
+			VecArraySoA result(size);
+			size_t n = size < count ? size : count;
+			if (n)
+				for (int c = 0; c < L; ++c)
+					std::memcpy(result.stream(c), stream(c), sizeof(T) * n);
+			*this = std::move(result);
+		}
+
+	private:
+		inline void allocate(size_t size)
+		{
+			count = size;
+			padded = (size + Padding - 1) / Padding * Padding;
+			if (padded == 0)
+				return;
+			data = static_cast<T*>(simd::alignedAlloc(sizeof(T) * L * padded, 64));
+			if (!data)
+				throw std::bad_alloc();
+			// bulk operations read whole Packs, zero padding keeps them off NaN and denormal paths
+			for (int c = 0; c < L; ++c)
+				std::memset(stream(c) + size, 0, sizeof(T) * (padded - size));
+		}
+
+		T* data;
+		size_t count;
+		size_t padded;
+	};
+
+
+#pragma region OverloadOpMacro
+
+#define SOA_LOOP(y, ...)																	\
+	for (size_t i = 0; i < y.stride(); i += simd::Pack<T>::size)							\
+	{																						\
+		__VA_ARGS__;																		\
+	}
+
+#define OVERLOAD_OP_SOA(op)																	\
+	template<int L, typename T>																\
+	inline VecArraySoA<L, T> operator op (const VecArraySoA<L, T> &a, const VecArraySoA<L, T> &b)	\
+	{																						\
+		assert(a.size() == b.size());														\
+		typedef simd::Pack<T> P;															\
+		VecArraySoA<L, T> y = VecArraySoA<L, T>::uninitialized(a.size());					\
+		for (int c = 0; c < L; ++c)															\
+		{																					\
+			const T *pa = a.stream(c), *pb = b.stream(c);									\
+			T *py = y.stream(c);															\
+			SOA_LOOP(y, (P::load(pa + i) op P::load(pb + i)).store(py + i))					\
+		}																					\
+		return y;																			\
+	}																						\
+	template<int L, typename T>																\
+	inline VecArraySoA<L, T> operator op (const VecArraySoA<L, T> &a, const Vec<L, T> &b)	\
+	{																						\
+		typedef simd::Pack<T> P;															\
+		VecArraySoA<L, T> y = VecArraySoA<L, T>::uninitialized(a.size());					\
+		for (int c = 0; c < L; ++c)															\
+		{																					\
+			const T *pa = a.stream(c);														\
+			T *py = y.stream(c);															\
+			P pb(b[c]);																		\
+			SOA_LOOP(y, (P::load(pa + i) op pb).store(py + i))								\
+		}																					\
+		return y;																			\
+	}																						\
+	template<int L, typename T>																\
+	inline VecArraySoA<L, T> operator op (const VecArraySoA<L, T> &a, const T &b)			\
+	{																						\
+		return a op Vec<L, T>(b);															\
+	}																						\
+	template<int L, typename T>																\
+	inline VecArraySoA<L, T> operator op (const Vec<L, T> &a, const VecArraySoA<L, T> &b)	\
+	{																						\
+		typedef simd::Pack<T> P;															\
+		VecArraySoA<L, T> y = VecArraySoA<L, T>::uninitialized(b.size());					\
+		for (int c = 0; c < L; ++c)															\
+		{																					\
+			const T *pb = b.stream(c);														\
+			T *py = y.stream(c);															\
+			P pa(a[c]);																		\
+			SOA_LOOP(y, (pa op P::load(pb + i)).store(py + i))								\
+		}																					\
+		return y;																			\
+	}																						\
+	template<int L, typename T>																\
+	inline VecArraySoA<L, T> operator op (const T &a, const VecArraySoA<L, T> &b)			\
+	{																						\
+		return Vec<L, T>(a) op b;															\
+	}																						\
+	template<int L, typename T>																\
+	inline VecArraySoA<L, T> & operator op##= (VecArraySoA<L, T> &a, const VecArraySoA<L, T> &b)	\
+	{																						\
+		assert(a.size() == b.size());														\
+		typedef simd::Pack<T> P;															\
+		for (int c = 0; c < L; ++c)															\
+		{																					\
+			T *pa = a.stream(c);															\
+			const T *pb = b.stream(c);														\
+			SOA_LOOP(a, (P::load(pa + i) op P::load(pb + i)).store(pa + i))				\
+		}																					\
+		return a;																			\
+	}																						\
+	template<int L, typename T>																\
+	inline VecArraySoA<L, T> & operator op##= (VecArraySoA<L, T> &a, const Vec<L, T> &b)	\
+	{																						\
+		typedef simd::Pack<T> P;															\
+		for (int c = 0; c < L; ++c)															\
+		{																					\
+			T *pa = a.stream(c);															\
+			P pb(b[c]);																		\
+			SOA_LOOP(a, (P::load(pa + i) op pb).store(pa + i))								\
+		}																					\
+		return a;																			\
+	}																						\
+	template<int L, typename T>																\
+	inline VecArraySoA<L, T> & operator op##= (VecArraySoA<L, T> &a, const T &b)			\
+	{																						\
+		return a op##= Vec<L, T>(b);														\
+	}																						\
+	template<int L, typename T, IF<(L > 1)> = 0>											\
+	inline VecArraySoA<L, T> operator op (const VecArraySoA<L, T> &a, const VecArraySoA<1, T> &b)	\
+	{																						\
+		assert(a.size() == b.size());														\
+		typedef simd::Pack<T> P;															\
+		VecArraySoA<L, T> y = VecArraySoA<L, T>::uninitialized(a.size());					\
+		const T *pb = b.stream(0);															\
+		for (int c = 0; c < L; ++c)															\
+		{																					\
+			const T *pa = a.stream(c);														\
+			T *py = y.stream(c);															\
+			SOA_LOOP(y, (P::load(pa + i) op P::load(pb + i)).store(py + i))					\
+		}																					\
+		return y;																			\
+	}
+
+#define SOA_UN_FUNC(name)																	\
+	template<int L, typename T>																\
+	inline VecArraySoA<L, T> name(const VecArraySoA<L, T> &a)								\
+	{																						\
+		typedef simd::Pack<T> P;															\
+		VecArraySoA<L, T> y = VecArraySoA<L, T>::uninitialized(a.size());					\
+		for (int c = 0; c < L; ++c)															\
+		{																					\
+			const T *pa = a.stream(c);														\
+			T *py = y.stream(c);															\
+			SOA_LOOP(y, simd::name(P::load(pa + i)).store(py + i))							\
+		}																					\
+		return y;																			\
+	}
+
+#define SOA_BIN_FUNC(name)																	\
+	template<int L, typename T>																\
+	inline VecArraySoA<L, T> name(const VecArraySoA<L, T> &a, const VecArraySoA<L, T> &b)	\
+	{																						\
+		assert(a.size() == b.size());														\
+		typedef simd::Pack<T> P;															\
+		VecArraySoA<L, T> y = VecArraySoA<L, T>::uninitialized(a.size());					\
+		for (int c = 0; c < L; ++c)															\
+		{																					\
+			const T *pa = a.stream(c), *pb = b.stream(c);									\
+			T *py = y.stream(c);															\
+			SOA_LOOP(y, simd::name(P::load(pa + i), P::load(pb + i)).store(py + i))		\
+		}																					\
+		return y;																			\
+	}																						\
+	template<int L, typename T>																\
+	inline VecArraySoA<L, T> name(const VecArraySoA<L, T> &a, const Vec<L, T> &b)			\
+	{																						\
+		typedef simd::Pack<T> P;															\
+		VecArraySoA<L, T> y = VecArraySoA<L, T>::uninitialized(a.size());					\
+		for (int c = 0; c < L; ++c)															\
+		{																					\
+			const T *pa = a.stream(c);														\
+			T *py = y.stream(c);															\
+			P pb(b[c]);																		\
+			SOA_LOOP(y, simd::name(P::load(pa + i), pb).store(py + i))						\
+		}																					\
+		return y;																			\
+	}																						\
+	template<int L, typename T>																\
+	inline VecArraySoA<L, T> name(const VecArraySoA<L, T> &a, const T &b)					\
+	{																						\
+		return name(a, Vec<L, T>(b));														\
+	}
+
+#pragma endregion OverloadOpMacro
+
+
+	OVERLOAD_OP_SOA(+)
+	OVERLOAD_OP_SOA(-)
+	OVERLOAD_OP_SOA(*)
+	OVERLOAD_OP_SOA(/)
+
+	template<int L, typename T>
+	inline VecArraySoA<L, T> operator-(const VecArraySoA<L, T> &a)
+	{
+		return Vec<L, T>((T)0) - a;
+	}
+
+	SOA_UN_FUNC(abs)
+	SOA_UN_FUNC(sqrt)
+	SOA_UN_FUNC(floor)
+	SOA_UN_FUNC(ceil)
+	SOA_UN_FUNC(round)
+
+	SOA_BIN_FUNC(min)
+	SOA_BIN_FUNC(max)
+
+
+	template<int L, typename T>
+	inline VecArraySoA<1, T> dot(const VecArraySoA<L, T> &a, const VecArraySoA<L, T> &b)
+	{
+		assert(a.size() == b.size());
+		typedef simd::Pack<T> P;
+		VecArraySoA<1, T> y = VecArraySoA<1, T>::uninitialized(a.size());
+		T *py = y.stream(0);
+		SOA_LOOP(y,
+			P r = P::load(a.stream(0) + i) * P::load(b.stream(0) + i);
+			for (int c = 1; c < L; ++c)
+				r = simd::madd(P::load(a.stream(c) + i), P::load(b.stream(c) + i), r);
+			r.store(py + i))
+		return y;
+	}
+
+	template<int L, typename T>
+	inline VecArraySoA<1, T> sqrLength(const VecArraySoA<L, T> &a)
+	{
+		return dot(a, a);
+	}
+
+	template<int L, typename T>
+	inline VecArraySoA<1, T> length(const VecArraySoA<L, T> &a)
+	{
+		return sqrt(dot(a, a));
+	}
+
+	template<int L, typename T>
+	inline VecArraySoA<1, T> sqrDistance(const VecArraySoA<L, T> &a, const VecArraySoA<L, T> &b)
+	{
+		return sqrLength(a - b);
+	}
+
+	template<int L, typename T>
+	inline VecArraySoA<1, T> distance(const VecArraySoA<L, T> &a, const VecArraySoA<L, T> &b)
+	{
+		return length(a - b);
+	}
+
+	template<int L, typename T>
+	inline VecArraySoA<L, T> normalize(const VecArraySoA<L, T> &a)
+	{
+		typedef simd::Pack<T> P;
+		VecArraySoA<L, T> y = VecArraySoA<L, T>::uninitialized(a.size());
+		SOA_LOOP(y,
+			P d = P::load(a.stream(0) + i) * P::load(a.stream(0) + i);
+			for (int c = 1; c < L; ++c)
+				d = simd::madd(P::load(a.stream(c) + i), P::load(a.stream(c) + i), d);
+			P invLength = P((T)1) / simd::sqrt(d);
+			for (int c = 0; c < L; ++c)
+				(P::load(a.stream(c) + i) * invLength).store(y.stream(c) + i))
+		return y;
+	}
+
+	template<typename T>
+	inline VecArraySoA<3, T> cross(const VecArraySoA<3, T> &a, const VecArraySoA<3, T> &b)
+	{
+		assert(a.size() == b.size());
+		typedef simd::Pack<T> P;
+		VecArraySoA<3, T> y = VecArraySoA<3, T>::uninitialized(a.size());
+		SOA_LOOP(y,
+			P ax = P::load(a.stream(0) + i), ay = P::load(a.stream(1) + i), az = P::load(a.stream(2) + i);
+			P bx = P::load(b.stream(0) + i), by = P::load(b.stream(1) + i), bz = P::load(b.stream(2) + i);
+			simd::nmadd(az, by, ay * bz).store(y.stream(0) + i);
+			simd::nmadd(ax, bz, az * bx).store(y.stream(1) + i);
+			simd::nmadd(ay, bx, ax * by).store(y.stream(2) + i))
+		return y;
+	}
+
+	template<int L, typename T>
+	inline VecArraySoA<L, T> lerp(const VecArraySoA<L, T> &a, const VecArraySoA<L, T> &b, const T &t)
+	{
+		assert(a.size() == b.size());
+		typedef simd::Pack<T> P;
+		VecArraySoA<L, T> y = VecArraySoA<L, T>::uninitialized(a.size());
+		P pt(t);
+		for (int c = 0; c < L; ++c)
+		{
+			const T *pa = a.stream(c), *pb = b.stream(c);
+			T *py = y.stream(c);
+			SOA_LOOP(y,
+				P va = P::load(pa + i);
+				simd::madd(P::load(pb + i) - va, pt, va).store(py + i))
+		}
+		return y;
+	}
+
+	template<int L, typename T>
+	inline VecArraySoA<L, T> lerp(const VecArraySoA<L, T> &a, const VecArraySoA<L, T> &b, const VecArraySoA<1, T> &t)
+	{
+		assert(a.size() == b.size() && a.size() == t.size());
+		typedef simd::Pack<T> P;
+		VecArraySoA<L, T> y = VecArraySoA<L, T>::uninitialized(a.size());
+		const T *pt = t.stream(0);
+		for (int c = 0; c < L; ++c)
+		{
+			const T *pa = a.stream(c), *pb = b.stream(c);
+			T *py = y.stream(c);
+			SOA_LOOP(y,
+				P va = P::load(pa + i);
+				simd::madd(P::load(pb + i) - va, P::load(pt + i), va).store(py + i))
+		}
+		return y;
+	}
+
+	template<int L, typename T>
+	inline VecArraySoA<L, T> clamp(const VecArraySoA<L, T> &v, const Vec<L, T> &min, const Vec<L, T> &max)
+	{
+		typedef simd::Pack<T> P;
+		VecArraySoA<L, T> y = VecArraySoA<L, T>::uninitialized(v.size());
+		for (int c = 0; c < L; ++c)
+		{
+			const T *pv = v.stream(c);
+			T *py = y.stream(c);
+			P pmin(min[c]), pmax(max[c]);
+			SOA_LOOP(y, simd::max(pmin, simd::min(P::load(pv + i), pmax)).store(py + i))
+		}
+		return y;
+	}
+
+	template<int L, typename T>
+	inline VecArraySoA<L, T> clamp(const VecArraySoA<L, T> &v, const T &min, const T &max)
+	{
+		return clamp(v, Vec<L, T>(min), Vec<L, T>(max));
+	}
+
+	template<int L, typename T>
+	inline VecArraySoA<L, T> clamp(const VecArraySoA<L, T> &v, const VecArraySoA<L, T> &lo, const VecArraySoA<L, T> &hi)
+	{
+		return max(lo, min(v, hi));
+	}
+
+
+	// AoS <-> SoA conversion of count Vec<L, T> or Quat<T>, component c of element i is soa[c * stride + i]
+	// (VecArraySoA::stream(c) is data + c * stride()). One simd::Pack of elements per step, float triples and
+	// quadruples are shuffled in registers. StoreMode::Auto streams outputs bigger than GM_STREAMING_THRESHOLD,
+	// SoA outputs only when every stream is aligned to a whole Pack, AoS outputs only for 3 and 4 floats.
+	namespace detail
+	{
+		template<int L, typename T>
+		inline void aosToSoA(const T* in, size_t count, T* out, size_t stride, StoreMode mode)
+		{
+			typedef simd::Pack<T> P;
+			bool stream = useStreaming(mode, in, out, count * L * sizeof(T)) && P::size > 1 &&
+				reinterpret_cast<uintptr_t>(out) % sizeof(P) == 0 && stride * sizeof(T) % sizeof(P) == 0;
+			P c[L];
+			size_t i = 0;
+			for (; i + P::size <= count; i += P::size)
+			{
+				simd::loadAoS<L>(in + i * L, c);
+				for (int k = 0; k < L; ++k)
+				{
+					if (stream)
+						c[k].stream(out + k * stride + i);
+					else
+						c[k].storeu(out + k * stride + i);
+				}
+			}
+			if (i < count)
+			{
+				alignas(64) T t[L * P::size] = {};
+				size_t n = count - i;
+				for (size_t j = 0; j < n * L; ++j)
+					t[j] = in[i * L + j];
+				simd::loadAoS<L>(t, c);
+				for (int k = 0; k < L; ++k)
+				{
+					c[k].store(t);
+					for (size_t j = 0; j < n; ++j)
+						out[k * stride + i + j] = t[j];
+				}
+			}
+			if (stream)
+				simd::streamFence();
+		}
+
+		template<int L, typename T>
+		inline void soaToAoS(const T* in, size_t stride, T* out, size_t count, StoreMode mode)
+		{
+			typedef simd::Pack<T> P;
+			bool stream = useStreaming(mode, in, out, count * L * sizeof(T)) && P::size > 1 && std::is_same<T, float>::value &&
+				(L == 3 || (L == 4 && (reinterpret_cast<uintptr_t>(out) & 15) == 0));
+			P c[L];
+			size_t i = 0;
+			// scalar head until out is 16 byte aligned for the streaming stores
+			for (; stream && i < count && (reinterpret_cast<uintptr_t>(out + i * L) & 15); ++i)
+				for (int k = 0; k < L; ++k)
+					out[i * L + k] = in[k * stride + i];
+			for (; i + P::size <= count; i += P::size)
+			{
+				for (int k = 0; k < L; ++k)
+					c[k] = P::loadu(in + k * stride + i);
+				simd::storeAoS<L>(out + i * L, c, stream);
+			}
+			for (; i < count; ++i)
+				for (int k = 0; k < L; ++k)
+					out[i * L + k] = in[k * stride + i];
+			if (stream)
+				simd::streamFence();
+		}
+	}
+
+	template<int L, typename T>
+	inline void toSoA(const Vec<L, T>* in, size_t count, T* soa, size_t stride, StoreMode mode = StoreMode::Auto)
+	{
+		detail::aosToSoA<L>(in->values, count, soa, stride, mode);
+	}
+
+	template<typename T>
+	inline void toSoA(const Quat<T>* in, size_t count, T* soa, size_t stride, StoreMode mode = StoreMode::Auto)
+	{
+		detail::aosToSoA<4>(&in->x, count, soa, stride, mode);
+	}
+
+	template<int L, typename T>
+	inline void toAoS(const T* soa, size_t stride, Vec<L, T>* out, size_t count, StoreMode mode = StoreMode::Auto)
+	{
+		detail::soaToAoS<L>(soa, stride, out->values, count, mode);
+	}
+
+	template<typename T>
+	inline void toAoS(const T* soa, size_t stride, Quat<T>* out, size_t count, StoreMode mode = StoreMode::Auto)
+	{
+		detail::soaToAoS<4>(soa, stride, &out->x, count, mode);
+	}
+
+	namespace detail
+	{
+		// a reused array keeps whatever earlier bulk operations computed in its padding
+		template<int L, typename T>
+		inline void zeroPadding(VecArraySoA<L, T>& a)
+		{
+			if (a.stride() > a.size())
+				for (int c = 0; c < L; ++c)
+					std::memset(a.stream(c) + a.size(), 0, sizeof(T) * (a.stride() - a.size()));
+		}
+	}
+
+	// out is resized to count elements, its padding is zeroed
+	template<int L, typename T>
+	inline void toSoA(const Vec<L, T>* in, size_t count, VecArraySoA<L, T>& out, StoreMode mode = StoreMode::Auto)
+	{
+		if (out.size() != count)
+			out = VecArraySoA<L, T>::uninitialized(count);
+		toSoA(in, count, out.stream(0), out.stride(), mode);
+		detail::zeroPadding(out);
+	}
+
+	template<typename T>
+	inline void toSoA(const Quat<T>* in, size_t count, VecArraySoA<4, T>& out, StoreMode mode = StoreMode::Auto)
+	{
+		if (out.size() != count)
+			out = VecArraySoA<4, T>::uninitialized(count);
+		toSoA(in, count, out.stream(0), out.stride(), mode);
+		detail::zeroPadding(out);
+	}
+
+	// out holds in.size() elements
+	template<int L, typename T>
+	inline void toAoS(const VecArraySoA<L, T>& in, Vec<L, T>* out, StoreMode mode = StoreMode::Auto)
+	{
+		toAoS(in.stream(0), in.stride(), out, in.size(), mode);
+	}
+
+	template<typename T>
+	inline void toAoS(const VecArraySoA<4, T>& in, Quat<T>* out, StoreMode mode = StoreMode::Auto)
+	{
+		toAoS(in.stream(0), in.stride(), out, in.size(), mode);
+	}
+
+#undef SOA_LOOP
+#undef OVERLOAD_OP_SOA
+#undef SOA_UN_FUNC
+#undef SOA_BIN_FUNC
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <ostream>
 #include <cmath>
+#include "SIMD.h"
 
 namespace gm 
 {
@@ -142,32 +143,32 @@ namespace gm
 
 #define OVERLOAD_OP_A(op, Cond)															\
 	template<int L, typename T, Cond<T> = 0>											\
-	inline  Vec<L, T> operator op (const Vec<L, T> &a, const Vec<L, T> &b) 				\
+	inline constexpr Vec<L, T> operator op (const Vec<L, T> &a, const Vec<L, T> &b)		\
 	{																					\
 		Vec<L, T> y;																	\
-		for (int i = 0; i < L; ++i) 													\
+		for (int i = 0; i < L; ++i)														\
 			y[i] = a[i] op b[i];														\
 		return y;																		\
 	}																					\
 	template<int L, typename T, Cond<T> = 0>											\
-	inline Vec<L, T> & operator op##= (Vec<L, T> &a, const Vec<L, T> &b) 				\
+	inline constexpr Vec<L, T> & operator op##= (Vec<L, T> &a, const Vec<L, T> &b)		\
 	{																					\
-		for (int i = 0; i < L; ++i) 													\
+		for (int i = 0; i < L; ++i)														\
 			a[i] op##= b[i];															\
 		return a;																		\
 	}																					\
 	template<int L, typename T, Cond<T> = 0>											\
-	inline Vec<L, T> operator op (const Vec<L, T> &a, const T &b) 						\
+	inline constexpr Vec<L, T> operator op (const Vec<L, T> &a, const T &b)				\
 	{																					\
 		Vec<L, T> y;																	\
-		for (int i = 0; i < L; ++i) 													\
+		for (int i = 0; i < L; ++i)														\
 			y[i] = a[i] op b;															\
 		return y;																		\
 	}																					\
 	template<int L, typename T, Cond<T> = 0>											\
-	inline Vec<L, T> & operator op##= (Vec<L, T> &a, const T &b)						\
+	inline constexpr Vec<L, T> & operator op##= (Vec<L, T> &a, const T &b)				\
 	{																					\
-		for (int i = 0; i < L; ++i) 													\
+		for (int i = 0; i < L; ++i)														\
 			a[i] op##= b;																\
 		return a;																		\
 	}																					\
@@ -175,10 +176,10 @@ namespace gm
 
 #define OVERLOAD_OP_B(op, Cond)															\
 	template<int L, typename T, Cond<T> = 0>											\
-	inline Vec<L, T> operator op (const T &a, const Vec<L, T> &b) 						\
+	inline constexpr Vec<L, T> operator op (const T &a, const Vec<L, T> &b)				\
 	{																					\
 		Vec<L, T> y;																	\
-		for (int i = 0; i < L; ++i) 													\
+		for (int i = 0; i < L; ++i)														\
 			y[i] = a op b[i];															\
 		return y;																		\
 	}
@@ -187,6 +188,45 @@ namespace gm
 
 
 
+	#pragma region UniversalConstructor
+	template<typename T>
+	struct vsize{static const int I = 1; };
+	template<int L, typename T>
+	struct vsize<Vec<L, T>>{static const int I = L; };
+
+	template <typename... Rest>
+	struct numof;
+	template <typename T, typename...Rest>
+	struct numof<T, Rest...>{static const int N = vsize<T>::I + numof<Rest...>::N;};
+	template <typename T>
+	struct numof<T>{static const int N = vsize<T>::I;};
+
+	template<int Idx, typename T>
+	inline constexpr void setValues(T*){}
+	template<int Idx, typename T, int L2, typename T2, typename... Rest>
+	inline constexpr void setValues(T* values, const Vec<L2, T2>& other, const Rest&... rest);
+	template<int Idx, typename T, typename T2, typename... Rest>
+	inline constexpr void setValues(T* values, const T2& value, const Rest&... rest);
+
+	template<int Idx, typename T, int L2, typename T2, typename... Rest>
+	inline constexpr void setValues(T* values, const Vec<L2, T2>& other, const Rest&... rest)
+	{
+		for (int i = 0; i < L2; ++i)
+		{
+			values[Idx + i] = static_cast<T>(other.values[i]);
+		}
+		setValues<Idx+L2>(values, rest...);
+	}
+
+	template<int Idx, typename T, typename T2, typename... Rest>
+	inline constexpr void setValues(T* values, const T2& value, const Rest&... rest)
+	{
+		values[Idx] = static_cast<T>(value);
+		setValues<Idx+1>(values, rest...);
+	}
+	#pragma endregion UniversalConstructor
+
+
 	template<int L, typename T>
 	struct Vec: public VecBase<L, T>
 	{
@@ -219,6 +259,13 @@ namespace gm
 
 
 
+		inline constexpr Vec<L, T> operator-() const {
+			Vec<L, T> y;
+			for (int i = 0; i < L; ++i)
+				y.values[i] = -this->values[i];
+			return y;
+		}
+
 		OVERLOAD_OP_IN(+)
 		OVERLOAD_OP_IN(-)
 		OVERLOAD_OP_IN(*)
@@ -236,12 +283,12 @@ namespace gm
 				y.values[i] = this->values[i] * inv;
 			return y;
 		}
-		inline constexpr Vec<L, T> &operator/=(const Vec<L, T> &other) const {
+		inline constexpr Vec<L, T> &operator/=(const Vec<L, T> &other) {
 			for (int i = 0; i < L; ++i)
 				this->values[i] /= other.values[i];
 			return *this;
 		}
-		inline constexpr Vec<L, T> &operator/=(const T &other) const {
+		inline constexpr Vec<L, T> &operator/=(const T &other) {
 			T inv = static_cast<T>(1) / other;
 			for (int i = 0; i < L; ++i)
 				this->values[i] *= inv;
@@ -250,46 +297,11 @@ namespace gm
 
 
 		#pragma region UniversalConstructor
-	private:
-
-
-		template<typename T>
-		struct vsize{static const int I = 1; };
-		template<int L, typename T>
-		struct vsize<Vec<L, T>>{static const int I = L; };
-
-		template <typename... Rest>
-		struct numof;
-		template <typename T2, typename...Rest>
-		struct numof<T2, Rest...>{static const int N = vsize<T2>::I + numof<Rest...>::N;};
-		template <typename T2>
-		struct numof<T2>{static const int N = vsize<T2>::I;};
-
-		template<int Idx, int L2, typename T2, typename... Rest>
-		inline constexpr void setValues(const Vec<L2, T2>& other, const Rest&... rest)
-		{
-			for (int i = 0; i < L2; ++i)
-			{
-				this->values[Idx + i] = static_cast<T>(other.values[i]);
-			}
-			setValues<Idx+L2>(rest...);
-		}
-
-		template<int Idx, typename T2, typename... Rest>
-		inline constexpr void setValues(const T2& value, const Rest&... rest)
-		{
-			this->values[Idx] = static_cast<T>(value);
-			setValues<Idx+1>(rest...);
-		}
-
-		template<int I>
-		inline constexpr void setValues(){}
-
 	public:
 		template<typename... Args, IF<(numof<Args...>::N == L)> = 0>
-		Vec(Args... args)
+		constexpr Vec(Args... args)
 		{
-			setValues<0>(args...);
+			setValues<0>(this->values, args...);
 		}
 		#pragma endregion UniversalConstructor
 
@@ -339,4 +351,6 @@ OVERLOAD_OP_B( op,	Cond )
 #undef OVERLOAD_OP_IN
 
 
-}
\ No newline at end of file
+}
+
+#include "VectorsSIMD.h"
\ No newline at end of file
@@ -0,0 +1,286 @@
+#pragma once
+#include "Vectors.h"
+#include "VectorGloabalFuncs.h"
+
+#if defined(GM_SIMD_SSE2)
+namespace gm
+{
+	template<typename V>
+	struct VecConstants
+	{
+		static const V zero;
+		static const V one;
+	};
+
+	template<typename V>
+	const V VecConstants<V>::zero(0);
+	template<typename V>
+	const V VecConstants<V>::one(1);
+
+
+	template<>
+	struct alignas(16) Vec<4, float>: public VecBase<4, float>, public VecConstants<Vec<4, float>>
+	{
+		inline GM_CONSTEXPR float& operator[](int i)
+		{
+			return this->values[i];
+		}
+		inline GM_CONSTEXPR const float& operator[](int i) const
+		{
+			return this->values[i];
+		}
+
+		inline __m128 simd() const
+		{
+			return _mm_load_ps(this->values);
+		}
+		inline void simd(__m128 v)
+		{
+			_mm_store_ps(this->values, v);
+		}
+
+		inline Vec() = default;
+		inline Vec(const Vec<4, float>& v) = default;
+		inline Vec<4, float>& operator=(const Vec<4, float>& v) = default;
+		inline explicit Vec(__m128 v)
+		{
+			simd(v);
+		}
+		inline GM_CONSTEXPR Vec(const float x)
+		{
+			if (GM_IS_CONSTANT_EVALUATED())
+			{
+				for (int i = 0; i < 4; i++)
+					this->values[i] = x;
+			}
+			else
+				simd(_mm_set1_ps(x));
+		}
+
+		template<typename T2>
+		inline constexpr Vec(const Vec<4, T2>& val)
+		{
+			for (int i = 0; i < 4; i++)
+				this->values[i] = static_cast<float>(val.values[i]);
+		}
+
+		template<typename... Args, IF<(numof<Args...>::N == 4)> = 0>
+		constexpr Vec(Args... args)
+		{
+			setValues<0>(this->values, args...);
+		}
+
+
+		inline GM_CONSTEXPR Vec<4, float> operator-() const
+		{
+			if (GM_IS_CONSTANT_EVALUATED())
+				return Vec<4, float>(-this->values[0], -this->values[1], -this->values[2], -this->values[3]);
+			return Vec<4, float>(_mm_xor_ps(simd(), simd::signMask()));
+		}
+
+		// constant evaluation runs the same lane-wise op on values[]
+#define OVERLOAD_OP_SIMD(op, intrin)																\
+		inline GM_CONSTEXPR Vec<4, float> operator op (const Vec<4, float>& other) const {			\
+			if (GM_IS_CONSTANT_EVALUATED())															\
+				return Vec<4, float>(this->values[0] op other.values[0],							\
+					this->values[1] op other.values[1],												\
+					this->values[2] op other.values[2],												\
+					this->values[3] op other.values[3]);											\
+			return Vec<4, float>(intrin(simd(), other.simd()));										\
+		}																							\
+		inline GM_CONSTEXPR Vec<4, float> operator op (const float& other) const {					\
+			if (GM_IS_CONSTANT_EVALUATED())															\
+				return *this op Vec<4, float>(other);												\
+			return Vec<4, float>(intrin(simd(), _mm_set1_ps(other)));								\
+		}																							\
+		inline GM_CONSTEXPR Vec<4, float>& operator op##= (const Vec<4, float>& other) {			\
+			if (GM_IS_CONSTANT_EVALUATED())															\
+				return *this = *this op other;														\
+			simd(intrin(simd(), other.simd()));														\
+			return *this;																			\
+		}																							\
+		inline GM_CONSTEXPR Vec<4, float>& operator op##= (const float& other) {					\
+			if (GM_IS_CONSTANT_EVALUATED())															\
+				return *this = *this op Vec<4, float>(other);										\
+			simd(intrin(simd(), _mm_set1_ps(other)));												\
+			return *this;																			\
+		}
+
+		OVERLOAD_OP_SIMD(+, _mm_add_ps)
+		OVERLOAD_OP_SIMD(-, _mm_sub_ps)
+		OVERLOAD_OP_SIMD(*, _mm_mul_ps)
+#undef OVERLOAD_OP_SIMD
+
+		inline GM_CONSTEXPR Vec<4, float> operator/(const Vec<4, float>& other) const {
+			if (GM_IS_CONSTANT_EVALUATED())
+				return Vec<4, float>(this->values[0] / other.values[0], this->values[1] / other.values[1],
+					this->values[2] / other.values[2], this->values[3] / other.values[3]);
+			return Vec<4, float>(_mm_div_ps(simd(), other.simd()));
+		}
+		inline GM_CONSTEXPR Vec<4, float> operator/(const float& other) const {
+			if (GM_IS_CONSTANT_EVALUATED())
+				return *this * Vec<4, float>(1.0f / other);
+			return Vec<4, float>(_mm_mul_ps(simd(), _mm_set1_ps(1.0f / other)));
+		}
+		inline GM_CONSTEXPR Vec<4, float>& operator/=(const Vec<4, float>& other) {
+			if (GM_IS_CONSTANT_EVALUATED())
+				return *this = *this / other;
+			simd(_mm_div_ps(simd(), other.simd()));
+			return *this;
+		}
+		inline GM_CONSTEXPR Vec<4, float>& operator/=(const float& other) {
+			if (GM_IS_CONSTANT_EVALUATED())
+				return *this = *this / other;
+			simd(_mm_mul_ps(simd(), _mm_set1_ps(1.0f / other)));
+			return *this;
+		}
+
+	};
+
+
+	inline GM_CONSTEXPR Vec<4, float> operator+(const float& a, const Vec<4, float>& b)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return Vec<4, float>(a) + b;
+		return Vec<4, float>(_mm_add_ps(_mm_set1_ps(a), b.simd()));
+	}
+	inline GM_CONSTEXPR Vec<4, float> operator-(const float& a, const Vec<4, float>& b)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return Vec<4, float>(a) - b;
+		return Vec<4, float>(_mm_sub_ps(_mm_set1_ps(a), b.simd()));
+	}
+	inline GM_CONSTEXPR Vec<4, float> operator*(const float& a, const Vec<4, float>& b)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return Vec<4, float>(a) * b;
+		return Vec<4, float>(_mm_mul_ps(_mm_set1_ps(a), b.simd()));
+	}
+	inline GM_CONSTEXPR Vec<4, float> operator/(const float& a, const Vec<4, float>& b)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return Vec<4, float>(a) / b;
+		return Vec<4, float>(_mm_div_ps(_mm_set1_ps(a), b.simd()));
+	}
+
+
+	inline GM_CONSTEXPR Vec<4, float> abs(const Vec<4, float>& v) noexcept
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return abs<4, float>(v);
+		return Vec<4, float>(_mm_andnot_ps(simd::signMask(), v.simd()));
+	}
+	inline GM_CONSTEXPR Vec<4, float> sqrt(const Vec<4, float>& v) noexcept
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return sqrt<4, float>(v);
+		return Vec<4, float>(_mm_sqrt_ps(v.simd()));
+	}
+	inline GM_CONSTEXPR Vec<4, float> min(const Vec<4, float>& a, const Vec<4, float>& b) noexcept
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return min<4, float>(a, b);
+		return Vec<4, float>(_mm_min_ps(a.simd(), b.simd()));
+	}
+	inline GM_CONSTEXPR Vec<4, float> min(const Vec<4, float>& a, const float& b) noexcept
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return min<4, float>(a, b);
+		return Vec<4, float>(_mm_min_ps(a.simd(), _mm_set1_ps(b)));
+	}
+	inline GM_CONSTEXPR Vec<4, float> min(const float& a, const Vec<4, float>& b) noexcept
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return min<4, float>(a, b);
+		return Vec<4, float>(_mm_min_ps(_mm_set1_ps(a), b.simd()));
+	}
+	inline GM_CONSTEXPR Vec<4, float> max(const Vec<4, float>& a, const Vec<4, float>& b) noexcept
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return max<4, float>(a, b);
+		return Vec<4, float>(_mm_max_ps(a.simd(), b.simd()));
+	}
+	inline GM_CONSTEXPR Vec<4, float> max(const Vec<4, float>& a, const float& b) noexcept
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return max<4, float>(a, b);
+		return Vec<4, float>(_mm_max_ps(a.simd(), _mm_set1_ps(b)));
+	}
+	inline GM_CONSTEXPR Vec<4, float> max(const float& a, const Vec<4, float>& b) noexcept
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return max<4, float>(a, b);
+		return Vec<4, float>(_mm_max_ps(_mm_set1_ps(a), b.simd()));
+	}
+#if defined(GM_SIMD_SSE4)
+	inline Vec<4, float> floor(const Vec<4, float>& v) noexcept
+	{
+		return Vec<4, float>(_mm_floor_ps(v.simd()));
+	}
+	inline Vec<4, float> ceil(const Vec<4, float>& v) noexcept
+	{
+		return Vec<4, float>(_mm_ceil_ps(v.simd()));
+	}
+#endif
+
+	inline GM_CONSTEXPR Vec<4, float> lerp(const Vec<4, float>& a, const Vec<4, float>& b, const Vec<4, float>& t) noexcept
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return lerp<4, float>(a, b, t);
+		return Vec<4, float>(simd::madd(_mm_sub_ps(b.simd(), a.simd()), t.simd(), a.simd()));
+	}
+	inline GM_CONSTEXPR Vec<4, float> lerp(const Vec<4, float>& a, const Vec<4, float>& b, const float& t) noexcept
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return lerp<4, float>(a, b, t);
+		return Vec<4, float>(simd::madd(_mm_sub_ps(b.simd(), a.simd()), _mm_set1_ps(t), a.simd()));
+	}
+	inline GM_CONSTEXPR Vec<4, float> clamp(const Vec<4, float>& v, const Vec<4, float>& min, const Vec<4, float>& max) noexcept
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return clamp<4, float>(v, min, max);
+		return Vec<4, float>(_mm_max_ps(min.simd(), _mm_min_ps(v.simd(), max.simd())));
+	}
+	inline GM_CONSTEXPR Vec<4, float> clamp(const Vec<4, float>& v, const float& min, const float& max) noexcept
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return clamp<4, float>(v, min, max);
+		return Vec<4, float>(_mm_max_ps(_mm_set1_ps(min), _mm_min_ps(v.simd(), _mm_set1_ps(max))));
+	}
+
+	// dot, length and normalize sum the products pairwise, (x + y) + (z + w), where the scalar templates sum
+	// left to right, so results can differ from those and from constant evaluation in the last ulp
+	inline GM_CONSTEXPR float dot(const Vec<4, float>& a, const Vec<4, float>& b)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return dot<4, float>(a, b);
+		return _mm_cvtss_f32(simd::hsum(_mm_mul_ps(a.simd(), b.simd())));
+	}
+	inline GM_CONSTEXPR float sqrLength(const Vec<4, float>& a)
+	{
+		return dot(a, a);
+	}
+	inline GM_CONSTEXPR float length(const Vec<4, float>& a)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return length<4, float>(a);
+		__m128 v = a.simd();
+		return _mm_cvtss_f32(_mm_sqrt_ss(simd::hsum(_mm_mul_ps(v, v))));
+	}
+	inline GM_CONSTEXPR float sqrDistance(const Vec<4, float>& a, const Vec<4, float>& b)
+	{
+		return sqrLength(a - b);
+	}
+	inline GM_CONSTEXPR float distance(const Vec<4, float>& a, const Vec<4, float>& b)
+	{
+		return length(a - b);
+	}
+	inline GM_CONSTEXPR Vec<4, float> normalize(const Vec<4, float>& a)
+	{
+		if (GM_IS_CONSTANT_EVALUATED())
+			return normalize<4, float>(a);
+		__m128 v = a.simd();
+		return Vec<4, float>(_mm_div_ps(v, _mm_sqrt_ps(simd::hsum(_mm_mul_ps(v, v)))));
+	}
+}
+#endif
@@ -0,0 +1,69 @@
+#include "../math.h"
+#include "../BVH.h"
+#include "Bench.h"
+#include <vector>
+#include <random>
+
+using namespace gm;
+
+// 1M spheres in a flat slab, like instances scattered over a level
+int main()
+{
+	const size_t count = 1000000;
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f), radius(0.05f, 0.5f);
+
+	std::vector<float4> spheres(count);
+	std::vector<AABB<3, float>> bounds(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		float3 c(position(rng), position(rng) * 0.1f, position(rng));
+		float r = radius(rng);
+		spheres[i] = float4(c[0], c[1], c[2], r);
+		bounds[i] = AABB<3, float>(c - float3(r), c + float3(r));
+	}
+
+	BVH<float> bvh;
+	double ns = bench::measure([&](size_t) { bvh.build(bounds.data(), count); }, 1, 1.0);
+	bench::report("BVH::build, 1M primitives", ns);
+	ns = bench::measure([&](size_t) { bvh.build(bounds.data(), count, 4, 1); }, 1, 1.0);
+	bench::report("BVH::build, one thread", ns);
+	ns = bench::measure([&](size_t) { bvh.refit(bounds.data()); }, 1);
+	bench::report("BVH::refit, 1M primitives", ns);
+
+	const size_t rayCount = 10000;
+	std::vector<Ray<float>> rays(rayCount);
+	std::vector<float> tMax(rayCount);
+	for (size_t i = 0; i < rayCount; ++i)
+		rays[i] = Ray<float>(float3(position(rng), 20.0f, position(rng)), float3(position(rng), -100.0f, position(rng)));
+	size_t hits = 0;
+	ns = bench::measure([&](size_t)
+	{
+		std::fill(tMax.begin(), tMax.end(), 1.0f);
+		bvh.intersect(rays.data(), tMax.data(), rayCount, [&](size_t q, uint32_t p, float& t)
+		{
+			float3 oc = rays[q].origin - float3(spheres[p][0], spheres[p][1], spheres[p][2]);
+			float a = dot(rays[q].direction, rays[q].direction), b = dot(oc, rays[q].direction), c = dot(oc, oc) - spheres[p][3] * spheres[p][3];
+			float d = b * b - a * c;
+			if (d < 0)
+				return false;
+			float h = (-b - std::sqrt(d)) / a;
+			if (h < 0 || h > t)
+				return false;
+			t = h;
+			++hits;
+			return true;
+		});
+	}, 1) / rayCount;
+	bench::doNotOptimize(hits);
+	bench::report("BVH::intersect(rays) per ray", ns);
+
+	size_t found = 0;
+	std::vector<AABB<3, float>> boxes(rayCount);
+	for (size_t i = 0; i < rayCount; ++i)
+		boxes[i] = AABB<3, float>(rays[i].origin - float3(2.0f, 30.0f, 2.0f), rays[i].origin + float3(2.0f));
+	ns = bench::measure([&](size_t) { bvh.overlap(boxes.data(), rayCount, [&](size_t, uint32_t) { ++found; }); }, 1) / rayCount;
+	bench::doNotOptimize(found);
+	bench::report("BVH::overlap(boxes) per box", ns);
+	return 0;
+}
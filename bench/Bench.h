@@ -0,0 +1,213 @@
+#pragma once
+#include "../SIMD.h"
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace gm
+{
+	namespace bench
+	{
+		template<typename T>
+		inline void doNotOptimize(T const& value)
+		{
+		#if defined(_MSC_VER)
+			const volatile char* p = reinterpret_cast<const volatile char*>(&value);
+			(void)*p;
+		#else
+			asm volatile("" : : "r,m"(value) : "memory");
+		#endif
+		}
+
+		// Runs fn(i) for i in [0, count) repeatedly until minSeconds passed, returns ns per call.
+		template<typename F>
+		inline double measure(F fn, size_t count, double minSeconds = 0.2)
+		{
+			typedef std::chrono::steady_clock Clock;
+			for (size_t i = 0; i < count; ++i)
+				fn(i);
+
+			size_t calls = 0;
+			Clock::time_point start = Clock::now();
+			double elapsed = 0;
+			do
+			{
+				for (size_t i = 0; i < count; ++i)
+					fn(i);
+				calls += count;
+				elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+			} while (elapsed < minSeconds);
+			return elapsed * 1e9 / (double)calls;
+		}
+
+		inline void report(const char* name, double nsPerOp, double baselineNsPerOp = 0)
+		{
+			if (baselineNsPerOp > 0)
+				std::printf("%-40s %10.3f ns/op  %6.2fx\n", name, nsPerOp, baselineNsPerOp / nsPerOp);
+			else
+				std::printf("%-40s %10.3f ns/op\n", name, nsPerOp);
+		}
+
+		// 64 byte aligned array, std::vector ignores alignas above 16 before C++17
+		template<typename T>
+		struct Buffer
+		{
+			explicit Buffer(size_t size) : ptr((T*)simd::alignedAlloc(size * sizeof(T))), count(size) {}
+			Buffer(Buffer&& other) : ptr(other.ptr), count(other.count) { other.ptr = nullptr; }
+			Buffer(const Buffer&) = delete;
+			Buffer& operator=(const Buffer&) = delete;
+			~Buffer() { simd::alignedFree(ptr); }
+
+			T* data() const { return ptr; }
+			size_t size() const { return count; }
+			T& operator[](size_t i) const { return ptr[i]; }
+
+		private:
+			T* ptr;
+			size_t count;
+		};
+
+		// Bytes of inputs plus outputs an op streams over, sized to stay in L1, stay in L2 and miss all caches
+		struct WorkingSet
+		{
+			const char* name;
+			size_t bytes;
+		};
+		static const WorkingSet workingSets[] = { { "L1", 16 << 10 }, { "L2", 128 << 10 }, { "DRAM", 64 << 20 } };
+		static const int workingSetCount = sizeof(workingSets) / sizeof(workingSets[0]);
+
+		inline const char* simdName()
+		{
+		#if defined(GM_SIMD_AVX512)
+			return "AVX-512";
+		#elif defined(GM_SIMD_AVX2)
+			return "AVX2";
+		#elif defined(GM_SIMD_AVX)
+			return "AVX";
+		#elif defined(GM_SIMD_SSE4)
+			return "SSE4.1";
+		#elif defined(GM_SIMD_SSE2)
+			return "SSE2";
+		#else
+			return "none";
+		#endif
+		}
+
+		// Collects ns/op per working set, prints a table and optionally writes JSON for CI to diff.
+		// Arguments: --json <file>, --filter <substring>, --min-time <seconds per measurement>
+		class Suite
+		{
+		public:
+			double minSeconds = 0.05;
+
+			Suite(int argc, char** argv)
+			{
+				for (int i = 1; i < argc; ++i)
+				{
+					if (!std::strcmp(argv[i], "--json") && i + 1 < argc)
+						jsonPath = argv[++i];
+					else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc)
+						filter = argv[++i];
+					else if (!std::strcmp(argv[i], "--min-time") && i + 1 < argc)
+						minSeconds = std::atof(argv[++i]);
+				}
+				std::printf("%-52s", "");
+				for (int w = 0; w < workingSetCount; ++w)
+					std::printf(" %9s", workingSets[w].name);
+				std::printf("  ns/op   ");
+				for (int w = 0; w < workingSetCount; ++w)
+					std::printf(" %7s", workingSets[w].name);
+				std::printf("  GB/s\n");
+			}
+
+			~Suite()
+			{
+				if (!jsonPath.empty())
+					writeJson();
+			}
+
+			bool enabled(const std::string& name) const
+			{
+				return filter.empty() || name.find(filter) != std::string::npos;
+			}
+
+			void add(const std::string& name, size_t bytesPerOp, const double* nsPerOp)
+			{
+				Result r;
+				r.name = name;
+				r.bytesPerOp = bytesPerOp;
+				r.nsPerOp.assign(nsPerOp, nsPerOp + workingSetCount);
+				results.push_back(r);
+
+				std::printf("%-52s", name.c_str());
+				for (int w = 0; w < workingSetCount; ++w)
+					std::printf(" %9.3f", nsPerOp[w]);
+				std::printf("          ");
+				for (int w = 0; w < workingSetCount; ++w)
+					std::printf(" %7.2f", bytesPerOp / nsPerOp[w]);
+				std::printf("\n");
+			}
+
+		private:
+			struct Result
+			{
+				std::string name;
+				size_t bytesPerOp;
+				std::vector<double> nsPerOp;
+			};
+
+			std::vector<Result> results;
+			std::string jsonPath;
+			std::string filter;
+
+			static void writeString(FILE* f, const std::string& s)
+			{
+				std::fputc('"', f);
+				for (char c : s)
+				{
+					if (c == '"' || c == '\\')
+						std::fputc('\\', f);
+					std::fputc(c, f);
+				}
+				std::fputc('"', f);
+			}
+
+			void writeJson() const
+			{
+				FILE* f = std::fopen(jsonPath.c_str(), "w");
+				if (!f)
+				{
+					std::fprintf(stderr, "cannot write %s\n", jsonPath.c_str());
+					return;
+				}
+				std::fprintf(f, "{\n  \"compiler\": ");
+			#if defined(__VERSION__)
+				writeString(f, __VERSION__);
+			#else
+				writeString(f, "unknown");
+			#endif
+				std::fprintf(f, ",\n  \"simd\": \"%s\",\n  \"minSeconds\": %g,\n  \"workingSets\": {", simdName(), minSeconds);
+				for (int w = 0; w < workingSetCount; ++w)
+					std::fprintf(f, "%s\"%s\": %zu", w ? ", " : " ", workingSets[w].name, workingSets[w].bytes);
+				std::fprintf(f, " },\n  \"results\": [");
+				for (size_t i = 0; i < results.size(); ++i)
+				{
+					const Result& r = results[i];
+					std::fprintf(f, "%s\n    { \"name\": ", i ? "," : "");
+					writeString(f, r.name);
+					std::fprintf(f, ", \"bytesPerOp\": %zu", r.bytesPerOp);
+					for (int w = 0; w < workingSetCount; ++w)
+						std::fprintf(f, ", \"%s\": { \"nsPerOp\": %.4f, \"opsPerSecond\": %.6g, \"bytesPerSecond\": %.6g }",
+							workingSets[w].name, r.nsPerOp[w], 1e9 / r.nsPerOp[w], r.bytesPerOp * 1e9 / r.nsPerOp[w]);
+					std::fprintf(f, " }");
+				}
+				std::fprintf(f, "\n  ]\n}\n");
+				std::fclose(f);
+			}
+		};
+	}
+}
@@ -0,0 +1,331 @@
+#include "../math.h"
+#include "../Expressions.h"
+#include "../Packed.h"
+#include "../QuatCompression.h"
+#include "../AABB.h"
+#include "Bench.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+
+// Every operator and builder over arrays sized for L1, L2 and DRAM.
+// ./benchmarks [--json results.json] [--filter Quat] [--min-time 0.05]
+
+using namespace gm;
+
+typedef std::mt19937 Rng;
+
+template<typename T>
+struct TypeName;
+template<>
+struct TypeName<float> { static std::string get() { return "float"; } };
+template<>
+struct TypeName<double> { static std::string get() { return "double"; } };
+template<int L, typename T>
+struct TypeName<Vec<L, T>> { static std::string get() { return "Vec<" + std::to_string(L) + "," + TypeName<T>::get() + ">"; } };
+template<int R, int C, typename T>
+struct TypeName<Mat<R, C, T>> { static std::string get() { return "Mat<" + std::to_string(R) + "," + std::to_string(C) + "," + TypeName<T>::get() + ">"; } };
+template<typename T>
+struct TypeName<Quat<T>> { static std::string get() { return "Quat<" + TypeName<T>::get() + ">"; } };
+template<int L, typename T>
+struct TypeName<AABB<L, T>> { static std::string get() { return "AABB<" + std::to_string(L) + "," + TypeName<T>::get() + ">"; } };
+template<>
+struct TypeName<half> { static std::string get() { return "half"; } };
+template<>
+struct TypeName<snorm16> { static std::string get() { return "snorm16"; } };
+template<>
+struct TypeName<unorm8> { static std::string get() { return "unorm8"; } };
+template<>
+struct TypeName<PackedQuat> { static std::string get() { return "PackedQuat"; } };
+
+template<typename T>
+std::string name() { return TypeName<T>::get(); }
+
+template<typename T, IsFloat<T> = 0>
+void randomize(T& x, Rng& rng)
+{
+	x = std::uniform_real_distribution<T>(-1, 1)(rng);
+}
+
+template<typename T, IF<std::is_same<T, half>::value || std::is_same<T, snorm16>::value || std::is_same<T, unorm8>::value> = 0>
+void randomize(T& x, Rng& rng)
+{
+	float f;
+	randomize(f, rng);
+	x = T(f);
+}
+
+template<int L, typename T>
+void randomize(Vec<L, T>& v, Rng& rng)
+{
+	for (int i = 0; i < L; ++i)
+		randomize(v[i], rng);
+}
+
+// diagonally dominant, so inverse and lu never meet a singular matrix
+template<int R, int C, typename T>
+void randomize(Mat<R, C, T>& m, Rng& rng)
+{
+	for (int i = 0; i < R * C; ++i)
+		randomize(m[i], rng);
+	for (int i = 0; i < std::min(R, C); ++i)
+		m[i * R + i] += (T)C;
+}
+
+template<typename T>
+void randomize(Quat<T>& q, Rng& rng)
+{
+	randomize(q.vec4, rng);
+	q.vec4 = normalize(q.vec4);
+}
+
+void randomize(PackedQuat& q, Rng& rng)
+{
+	Quat<float> f;
+	randomize(f, rng);
+	q = PackedQuat(f);
+}
+
+template<int Bits>
+void randomize(CompressedQuat<Bits>& q, Rng& rng)
+{
+	Quat<float> f;
+	randomize(f, rng);
+	q = CompressedQuat<Bits>(f);
+}
+
+template<int L, typename T>
+void randomize(AABB<L, T>& b, Rng& rng)
+{
+	Vec<L, T> c, e;
+	randomize(c, rng);
+	randomize(e, rng);
+	b = AABB<L, T>(c - abs(e), c + abs(e));
+}
+
+template<typename Y, typename F, typename Inputs, size_t... I>
+double measureOp(F& f, Y* y, Inputs& in, size_t count, double minSeconds, std::index_sequence<I...>)
+{
+	Rng rng(42);
+	int fill[] = { 0, (std::for_each(std::get<I>(in).data(), std::get<I>(in).data() + count, [&](typename std::remove_reference<decltype(std::get<I>(in)[0])>::type& x) { randomize(x, rng); }), 0)... };
+	(void)fill;
+	auto p = std::make_tuple(std::get<I>(in).data()...);
+	double ns = bench::measure([&](size_t i) { y[i] = f(std::get<I>(p)[i]...); }, count, minSeconds);
+	bench::doNotOptimize(y[count - 1]);
+	return ns;
+}
+
+// y[i] = f(a[i]...) over random inputs, once per working set
+template<typename... A, typename F>
+void op(bench::Suite& suite, const std::string& opName, F f)
+{
+	if (!suite.enabled(opName))
+		return;
+	typedef decltype(f(std::declval<const A&>()...)) Y;
+	size_t sizes[] = { sizeof(A)... };
+	size_t bytesPerOp = sizeof(Y);
+	for (size_t s : sizes)
+		bytesPerOp += s;
+
+	double ns[bench::workingSetCount];
+	for (int w = 0; w < bench::workingSetCount; ++w)
+	{
+		size_t count = std::max<size_t>(bench::workingSets[w].bytes / bytesPerOp, 1);
+		bench::Buffer<Y> y(count);
+		std::tuple<bench::Buffer<A>...> in{ bench::Buffer<A>(count)... };
+		ns[w] = measureOp(f, y.data(), in, count, suite.minSeconds, std::index_sequence_for<A...>());
+	}
+	suite.add(opName, bytesPerOp, ns);
+}
+
+// f(a, y, count) over whole random arrays, once per working set, ns per element
+template<typename A, typename Y, typename F>
+void arrayOp(bench::Suite& suite, const std::string& opName, F f)
+{
+	if (!suite.enabled(opName))
+		return;
+	const size_t bytesPerOp = sizeof(A) + sizeof(Y);
+	double ns[bench::workingSetCount];
+	for (int w = 0; w < bench::workingSetCount; ++w)
+	{
+		size_t count = std::max<size_t>(bench::workingSets[w].bytes / bytesPerOp, 1);
+		bench::Buffer<Y> y(count);
+		bench::Buffer<A> a(count);
+		Rng rng(42);
+		std::for_each(a.data(), a.data() + count, [&](A& x) { randomize(x, rng); });
+		ns[w] = bench::measure([&](size_t) { f(a.data(), y.data(), count); }, 1, suite.minSeconds) / count;
+		bench::doNotOptimize(y[count - 1]);
+	}
+	suite.add(opName, bytesPerOp, ns);
+}
+
+template<int L, typename T>
+void vecOps(bench::Suite& s)
+{
+	typedef Vec<L, T> V;
+	const std::string v = name<V>();
+	op<V, V>(s, v + " + " + v, [](const V& a, const V& b) { return a + b; });
+	op<V, V>(s, v + " * " + v, [](const V& a, const V& b) { return a * b; });
+	op<V, T>(s, v + " * " + name<T>(), [](const V& a, const T& b) { return a * b; });
+	op<V, V>(s, v + " / " + v, [](const V& a, const V& b) { return a / b; });
+	op<V, V>(s, "dot(" + v + ")", [](const V& a, const V& b) { return dot(a, b); });
+	op<V>(s, "length(" + v + ")", [](const V& a) { return length(a); });
+	op<V>(s, "normalize(" + v + ")", [](const V& a) { return normalize(a); });
+	op<V, V>(s, "min(" + v + ")", [](const V& a, const V& b) { return min(a, b); });
+	op<V, V, V>(s, "lerp(" + v + ")", [](const V& a, const V& b, const V& t) { return lerp(a, b, t); });
+	op<V, V, V>(s, "lazy(a) + (b - a) * t " + v, [](const V& a, const V& b, const V& t) { return V(lazy(a) + (lazy(b) - a) * t); });
+}
+
+template<typename T>
+void crossOps(bench::Suite& s)
+{
+	typedef Vec<3, T> V;
+	op<V, V>(s, "cross(" + name<V>() + ")", [](const V& a, const V& b) { return cross(a, b); });
+}
+
+template<int N, typename T>
+void matMulOps(bench::Suite& s)
+{
+	typedef Mat<N, N, T> M;
+	typedef Vec<N, T> V;
+	const std::string m = name<M>();
+	op<M, M>(s, m + " * " + m, [](const M& a, const M& b) { return a * b; });
+	op<M, V>(s, m + " * " + name<V>(), [](const M& a, const V& b) { return a * b; });
+	op<M>(s, "transpose(" + m + ")", [](const M& a) { return transpose(a); });
+}
+
+template<int N, typename T>
+void matInverseOps(bench::Suite& s)
+{
+	typedef Mat<N, N, T> M;
+	const std::string m = name<M>();
+	op<M>(s, "determinant(" + m + ")", [](const M& a) { return determinant(a); });
+	op<M>(s, "inverse(" + m + ")", [](const M& a) { return inverse(a); });
+}
+
+template<typename T, int... N>
+void matInverseOps(bench::Suite& s, std::integer_sequence<int, N...>)
+{
+	int run[] = { (matInverseOps<N, T>(s), 0)... };
+	(void)run;
+}
+
+template<typename T>
+void builderOps(bench::Suite& s)
+{
+	typedef Vec<3, T> V3;
+	typedef Vec<4, T> V4;
+	typedef Mat<4, 4, T> M4;
+	typedef Quat<T> Q;
+	const std::string t = name<T>();
+	op<T>(s, "rotation(" + t + ")", [](const T& r) { return rotation(r); });
+	op<V3, T>(s, "rotation(" + name<V3>() + ", " + t + ")", [](const V3& n, const T& r) { return rotation(n, r); });
+	op<V3>(s, "rotation(" + name<V3>() + ")", [](const V3& e) { return rotation(e); });
+	op<Q>(s, "rotation(" + name<Q>() + ")", [](const Q& q) { return rotation(q); });
+	op<Q, V3>(s, "translate(rotation(" + name<Q>() + "), " + name<V3>() + ")", [](const Q& q, const V3& v) { return translate(rotation(q), v); });
+	op<V4>(s, "perspective(" + t + ")", [](const V4& p)
+	{
+		return perspective((T)1 + (T)0.25 * p.x, (T)1.5 + (T)0.25 * p.y, (T)0.2 + (T)0.1 * p.z, (T)100 + p.w);
+	});
+	op<V3, V3>(s, "ortho(" + name<V3>() + ")", [](const V3& max, const V3& min) { return ortho(max + (T)2, min - (T)2); });
+	op<M4>(s, "inverseAffine(" + name<M4>() + ")", [](const M4& m) { return inverseAffine(m); });
+	op<M4>(s, "inverseRigid(" + name<M4>() + ")", [](const M4& m) { return inverseRigid(m); });
+	op<V3, T>(s, "Quat<" + t + ">::angleAxis", [](const V3& n, const T& r) { return Q::angleAxis(n, r); });
+	op<V3>(s, "Quat<" + t + ">::euler", [](const V3& e) { return Q::euler(e * (T)180); });
+}
+
+template<typename T>
+void quatOps(bench::Suite& s)
+{
+	typedef Quat<T> Q;
+	typedef Vec<3, T> V3;
+	const std::string q = name<Q>();
+	op<Q, Q>(s, q + " * " + q, [](const Q& a, const Q& b) { return a * b; });
+	op<Q, V3>(s, q + " * " + name<V3>(), [](const Q& a, const V3& v) { return a * v; });
+	op<Q, Q, T>(s, "lerp(" + q + ")", [](const Q& a, const Q& b, const T& t) { return lerp(a, b, t); });
+	op<Q, Q, T>(s, "slerp(" + q + ")", [](const Q& a, const Q& b, const T& t) { return slerp(a, b, t); });
+	op<Q, T>(s, "pow(" + q + ")", [](const Q& a, const T& p) { return pow(a, p); });
+	op<Q>(s, "inverse(" + q + ")", [](const Q& a) { return inverse(a); });
+}
+
+template<typename T>
+void aabbOps(bench::Suite& s)
+{
+	typedef AABB<3, T> B;
+	typedef Mat<4, 4, T> M4;
+	const std::string b = name<B>();
+	op<B, B>(s, "unite(" + b + ")", [](const B& x, const B& y) { return unite(x, y); });
+	op<B, B>(s, b + "::intersects", [](const B& x, const B& y) { return x.intersects(y); });
+	op<M4, B>(s, "transform(" + name<M4>() + ", " + b + ")", [](const M4& m, const B& x) { return transform(m, x); });
+}
+
+template<int N, typename T>
+void lazyOps(bench::Suite& s)
+{
+	typedef Mat<N, N, T> M;
+	const std::string m = name<M>();
+	op<M, M, M>(s, m + " a * s + b * t - c", [](const M& a, const M& b, const M& c) { return a * (T)0.5 + b * (T)0.25 - c; });
+	op<M, M, M>(s, m + " lazy(a) * s + lazy(b) * t - c", [](const M& a, const M& b, const M& c) { return M(lazy(a) * (T)0.5 + lazy(b) * (T)0.25 - c); });
+}
+
+template<int L, typename Q>
+void packedOps(bench::Suite& s)
+{
+	typedef Vec<L, float> V;
+	typedef Vec<L, Q> P;
+	op<V>(s, name<P>() + "(" + name<V>() + ")", [](const V& v) { return P(v); });
+	op<P>(s, name<V>() + "(" + name<P>() + ")", [](const P& p) { return V(p); });
+}
+
+void packedQuatOps(bench::Suite& s)
+{
+	op<Quat<float>>(s, "PackedQuat(Quat<float>)", [](const Quat<float>& q) { return PackedQuat(q); });
+	op<PackedQuat>(s, "Quat<float>(PackedQuat)", [](const PackedQuat& q) { return Quat<float>(q); });
+}
+
+template<int Bits>
+void compressedQuatOps(bench::Suite& s)
+{
+	typedef CompressedQuat<Bits> C;
+	const std::string c = "CompressedQuat<" + std::to_string(Bits) + ">";
+	op<Quat<float>>(s, c + "(Quat<float>)", [](const Quat<float>& q) { return C(q); });
+	op<C>(s, "Quat<float>(" + c + ")", [](const C& q) { return Quat<float>(q); });
+	arrayOp<Quat<float>, C>(s, "pack(Quat<float>*, " + c + "*)", [](const Quat<float>* in, C* out, size_t n) { pack(in, out, n); });
+	arrayOp<C, Quat<float>>(s, "unpack(" + c + "*, Quat<float>*)", [](const C* in, Quat<float>* out, size_t n) { unpack(in, out, n); });
+}
+
+template<typename T>
+void run(bench::Suite& s)
+{
+	vecOps<2, T>(s);
+	vecOps<3, T>(s);
+	vecOps<4, T>(s);
+	crossOps<T>(s);
+	matMulOps<2, T>(s);
+	matMulOps<3, T>(s);
+	matMulOps<4, T>(s);
+	op<Mat<8, 8, T>>(s, "transpose(" + name<Mat<8, 8, T>>() + ")", [](const Mat<8, 8, T>& a) { return transpose(a); });
+	matInverseOps<T>(s, std::integer_sequence<int, 2, 3, 4, 5, 6, 7, 8>());
+	builderOps<T>(s);
+	quatOps<T>(s);
+	aabbOps<T>(s);
+	lazyOps<4, T>(s);
+	lazyOps<12, T>(s);
+}
+
+int main(int argc, char** argv)
+{
+	bench::Suite suite(argc, argv);
+	run<float>(suite);
+	run<double>(suite);
+	packedOps<3, half>(suite);
+	packedOps<3, snorm16>(suite);
+	packedOps<4, unorm8>(suite);
+	packedQuatOps(suite);
+	compressedQuatOps<29>(suite);
+	compressedQuatOps<32>(suite);
+	compressedQuatOps<48>(suite);
+	return 0;
+}
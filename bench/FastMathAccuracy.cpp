@@ -0,0 +1,169 @@
+#include "../FastMath.h"
+#include "Bench.h"
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+// Max ULP error of gm::fast against libm, evaluated one precision higher, and speed of both.
+// Every range is sampled with several seeds, the harness exits with 1 when an error exceeds the table
+// in FastMath.h by more than the margin.
+
+using namespace gm;
+
+template<typename T>
+struct Wider { typedef double type; };
+template<>
+struct Wider<double> { typedef long double type; };
+
+template<typename T>
+double ulpError(T got, typename Wider<T>::type ref)
+{
+	if (std::isnan(ref))
+		return std::isnan(got) ? 0 : INFINITY;
+	if (std::isinf(ref) || std::isinf(got))
+		return got == ref ? 0 : INFINITY;
+	T r = (T)ref;
+	int e = r == 0 ? std::numeric_limits<T>::min_exponent - 1 : std::max(std::ilogb(r), std::numeric_limits<T>::min_exponent - 1);
+	typename Wider<T>::type ulp = std::ldexp((typename Wider<T>::type)1, e - std::numeric_limits<T>::digits + 1);
+	return (double)(std::abs((typename Wider<T>::type)got - ref) / ulp);
+}
+
+const unsigned seeds[] = { 7, 1234, 99991, 2718281 };
+
+template<typename T>
+std::vector<T> samples(T lo, T hi, bool logScale, size_t count, unsigned seed)
+{
+	std::mt19937_64 rng(seed);
+	std::vector<T> x(count);
+	if (logScale)
+	{
+		std::uniform_real_distribution<double> d(std::log2((double)lo), std::log2((double)hi));
+		for (T& v : x)
+			v = (T)std::exp2(d(rng));
+	}
+	else
+	{
+		std::uniform_real_distribution<double> d((double)lo, (double)hi);
+		for (T& v : x)
+			v = (T)d(rng);
+	}
+	return x;
+}
+
+template<typename T, typename Fast, typename Ref>
+bool checkUnary(const char* name, T lo, T hi, bool logScale, double bound, Fast fast, Ref ref, bool absolute = false)
+{
+	const size_t count = 1 << 20;
+	std::vector<T> x, y(count), z(count);
+	double worst = 0;
+	T worstX = 0;
+	for (unsigned seed : seeds)
+	{
+		x = samples(lo, hi, logScale, count, seed);
+		fast(x.data(), y.data(), count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			typename Wider<T>::type r = ref((typename Wider<T>::type)x[i]);
+			double e = absolute ? (double)std::abs((typename Wider<T>::type)y[i] - r) : ulpError(y[i], r);
+			if (e > worst)
+			{
+				worst = e;
+				worstX = x[i];
+			}
+		}
+	}
+	double nsFast = bench::measure([&](size_t) { fast(x.data(), y.data(), count); }, 1, 0.1) / count;
+	double nsStd = bench::measure([&](size_t) { for (size_t i = 0; i < count; ++i) z[i] = (T)ref(x[i]); }, 1, 0.1) / count;
+	bench::doNotOptimize(y);
+	bench::doNotOptimize(z);
+	std::printf(absolute ? "%-8s %-6s [%g, %g]  max %8.2g abs at %.9g  %7.3f ns  std %7.3f ns%s\n" : "%-8s %-6s [%g, %g]  max %6.2f ulp at %.9g  %7.3f ns  std %7.3f ns%s\n",
+		name, sizeof(T) == 4 ? "float" : "double", (double)lo, (double)hi, worst, (double)worstX, nsFast, nsStd, worst > bound ? "  EXCEEDS BOUND" : "");
+	return worst <= bound;
+}
+
+template<typename T, typename Fast, typename Ref>
+bool checkBinary(const char* name, T lo0, T hi0, T lo1, T hi1, double bound, Fast fast, Ref ref)
+{
+	const size_t count = 1 << 20;
+	std::vector<T> a, b, y(count);
+	double worst = 0;
+	T worstA = 0, worstB = 0;
+	for (unsigned seed : seeds)
+	{
+		a = samples(lo0, hi0, false, count, seed);
+		b = samples(lo1, hi1, false, count, seed + 1);
+		fast(a.data(), b.data(), y.data(), count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			double e = ulpError(y[i], ref((typename Wider<T>::type)a[i], (typename Wider<T>::type)b[i]));
+			if (e > worst)
+			{
+				worst = e;
+				worstA = a[i];
+				worstB = b[i];
+			}
+		}
+	}
+	double nsFast = bench::measure([&](size_t) { fast(a.data(), b.data(), y.data(), count); }, 1, 0.1) / count;
+	bench::doNotOptimize(y);
+	std::printf("%-8s %-6s [%g, %g] x [%g, %g]  max %6.2f ulp at (%.9g, %.9g)  %7.3f ns%s\n",
+		name, sizeof(T) == 4 ? "float" : "double", (double)lo0, (double)hi0, (double)lo1, (double)hi1, worst, (double)worstA, (double)worstB, nsFast,
+		worst > bound ? "  EXCEEDS BOUND" : "");
+	return worst <= bound;
+}
+
+// The FastMath.h table: max ULP error of float / double with FMA, then without. The table holds the maxima
+// measured over the seeds, the checks allow margin over them for inputs no seed hit.
+struct Documented
+{
+	double f, d, fNoFma, dNoFma;
+};
+
+const double margin = 1.25;
+
+template<typename T>
+double bound(const Documented& b)
+{
+#if defined(GM_SIMD_FMA)
+	return margin * (sizeof(T) == 4 ? b.f : b.d);
+#else
+	return margin * (sizeof(T) == 4 ? b.fNoFma : b.dNoFma);
+#endif
+}
+
+template<typename T>
+bool run(T trigRange)
+{
+	typedef typename Wider<T>::type W;
+	const Documented trig = { 2, 2, 2, 2 }, exp = { 2, 2, 2, 2 }, log = { 2, 3, 2, 3 }, atan = { 4, 2, 4, 2 }, acos = { 4, 3, 4, 3 },
+		pow = { 8, 11, 30, 32 };
+	// float sin / cos beyond |x| = 4: absolute error, the ULP error has no bound near the zeros
+	const bool absolute = sizeof(T) == 4;
+	const double wide = absolute ? margin * 1e-7 : bound<T>(trig);
+	bool ok = true;
+	ok &= checkUnary<T>("sin", -trigRange, trigRange, false, wide, [](const T* x, T* y, size_t n) { fast::sin(x, y, n); }, [](W x) { return std::sin(x); }, absolute);
+	ok &= checkUnary<T>("cos", -trigRange, trigRange, false, wide, [](const T* x, T* y, size_t n) { fast::cos(x, y, n); }, [](W x) { return std::cos(x); }, absolute);
+	ok &= checkUnary<T>("sin", (T)-100, (T)100, false, wide, [](const T* x, T* y, size_t n) { fast::sin(x, y, n); }, [](W x) { return std::sin(x); }, absolute);
+	ok &= checkUnary<T>("cos", (T)-100, (T)100, false, wide, [](const T* x, T* y, size_t n) { fast::cos(x, y, n); }, [](W x) { return std::cos(x); }, absolute);
+	ok &= checkUnary<T>("sin", (T)-4, (T)4, false, bound<T>(trig), [](const T* x, T* y, size_t n) { fast::sin(x, y, n); }, [](W x) { return std::sin(x); });
+	ok &= checkUnary<T>("cos", (T)-4, (T)4, false, bound<T>(trig), [](const T* x, T* y, size_t n) { fast::cos(x, y, n); }, [](W x) { return std::cos(x); });
+	ok &= checkUnary<T>("exp", (T)-80, (T)80, false, bound<T>(exp), [](const T* x, T* y, size_t n) { fast::exp(x, y, n); }, [](W x) { return std::exp(x); });
+	ok &= checkUnary<T>("exp2", (T)-120, (T)120, false, bound<T>(exp), [](const T* x, T* y, size_t n) { fast::exp2(x, y, n); }, [](W x) { return std::exp2(x); });
+	ok &= checkUnary<T>("log", (T)1e-30, (T)1e30, true, bound<T>(log), [](const T* x, T* y, size_t n) { fast::log(x, y, n); }, [](W x) { return std::log(x); });
+	ok &= checkUnary<T>("log2", (T)1e-30, (T)1e30, true, bound<T>(log), [](const T* x, T* y, size_t n) { fast::log2(x, y, n); }, [](W x) { return std::log2(x); });
+	ok &= checkUnary<T>("atan", (T)-100, (T)100, false, bound<T>(atan), [](const T* x, T* y, size_t n) { fast::atan(x, y, n); }, [](W x) { return std::atan(x); });
+	ok &= checkUnary<T>("atan", (T)1e-6, (T)1e6, true, bound<T>(atan), [](const T* x, T* y, size_t n) { fast::atan(x, y, n); }, [](W x) { return std::atan(x); });
+	ok &= checkUnary<T>("acos", (T)-1, (T)1, false, bound<T>(acos), [](const T* x, T* y, size_t n) { fast::acos(x, y, n); }, [](W x) { return std::acos(x); });
+	ok &= checkBinary<T>("atan2", (T)-10, (T)10, (T)-10, (T)10, bound<T>(atan), [](const T* a, const T* b, T* y, size_t n) { fast::atan2(a, b, y, n); }, [](W a, W b) { return std::atan2(a, b); });
+	ok &= checkBinary<T>("pow", (T)0.01, (T)100, (T)-9, (T)9, bound<T>(pow), [](const T* a, const T* b, T* y, size_t n) { fast::pow(a, b, y, n); }, [](W a, W b) { return std::pow(a, b); });
+	return ok;
+}
+
+int main()
+{
+	bool ok = run<float>(8192.0f);
+	ok &= run<double>(1048576.0);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+#include "../math.h"
+#include "../Affine.h"
+#include "Bench.h"
+#include <vector>
+#include <random>
+
+using namespace gm;
+
+int main()
+{
+	const size_t count = 1024;
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+	std::vector<float4x4> a(count), b(count), y(count);
+	std::vector<float4> v(count), yv(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		for (int j = 0; j < 16; ++j)
+		{
+			a[i][j] = dist(rng);
+			b[i][j] = dist(rng);
+		}
+		v[i] = float4(dist(rng), dist(rng), dist(rng), 1.0f);
+	}
+
+	// the float4x4 kernels are bit identical to mulReference (MatricesSIMD.h)
+	size_t mismatches = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		float4x4 m = a[i] * b[i], mr = mulReference(a[i], b[i]);
+		float4 mv = a[i] * v[i], mvr = mulReference(a[i], v[i]);
+		mismatches += std::memcmp(&m, &mr, sizeof(m)) != 0;
+		mismatches += std::memcmp(&mv, &mvr, sizeof(mv)) != 0;
+	}
+	if (mismatches)
+	{
+		std::printf("float4x4 * float4x4 / float4: %zu of %zu products differ from mulReference\n", mismatches, 2 * count);
+		return 1;
+	}
+
+	double generic = bench::measure([&](size_t i) { y[i] = operator*<4, 4, 4, float>(a[i], b[i]); }, count);
+	bench::doNotOptimize(y);
+	bench::report("float4x4 * float4x4 (generic)", generic);
+	double reference = bench::measure([&](size_t i) { y[i] = mulReference(a[i], b[i]); }, count);
+	bench::doNotOptimize(y);
+	bench::report("float4x4 * float4x4 (reference)", reference, generic);
+	double special = bench::measure([&](size_t i) { y[i] = a[i] * b[i]; }, count);
+	bench::doNotOptimize(y);
+	bench::report("float4x4 * float4x4", special, generic);
+
+	generic = bench::measure([&](size_t i) { yv[i] = operator*<4, 4, float>(a[i], v[i]); }, count);
+	bench::doNotOptimize(yv);
+	bench::report("float4x4 * float4 (generic)", generic);
+	special = bench::measure([&](size_t i) { yv[i] = a[i] * v[i]; }, count);
+	bench::doNotOptimize(yv);
+	bench::report("float4x4 * float4", special, generic);
+
+	for (size_t i = 0; i < count; ++i)
+		a[i] = translate(rotation(Quaternion::euler(v[i].xyz * 180.0f)), v[i].xyz);
+
+	generic = bench::measure([&](size_t i) { y[i] = inverse(lu(a[i])); }, count);
+	bench::doNotOptimize(y);
+	bench::report("inverse(lu(float4x4))", generic);
+	special = bench::measure([&](size_t i) { y[i] = inverse(a[i]); }, count);
+	bench::doNotOptimize(y);
+	bench::report("inverse(float4x4)", special, generic);
+	special = bench::measure([&](size_t i) { y[i] = inverseAffine(a[i]); }, count);
+	bench::doNotOptimize(y);
+	bench::report("inverseAffine(float4x4)", special, generic);
+	special = bench::measure([&](size_t i) { y[i] = inverseRigid(a[i]); }, count);
+	bench::doNotOptimize(y);
+	bench::report("inverseRigid(float4x4)", special, generic);
+	special = bench::measure([&](size_t) { inverseRigid(a.data(), y.data(), count); }, 1) / count;
+	bench::doNotOptimize(y);
+	bench::report("inverseRigid(float4x4*, count)", special, generic);
+
+	// float3x4 against the float4x4 kernels on the same rigid transforms
+	std::vector<float3x4> a34(count), b34(count), y34(count);
+	std::vector<float3> p(count), yp(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		a34[i] = toAffine(a[i]);
+		b34[i] = toAffine(inverseRigid(a[i]));
+		b[i] = toMat4(b34[i]);
+		p[i] = v[i].xyz;
+	}
+
+	generic = bench::measure([&](size_t i) { y[i] = a[i] * b[i]; }, count);
+	bench::doNotOptimize(y);
+	bench::report("float4x4 * float4x4 (affine)", generic);
+	special = bench::measure([&](size_t i) { y34[i] = a34[i] * b34[i]; }, count);
+	bench::doNotOptimize(y34);
+	bench::report("float3x4 * float3x4", special, generic);
+
+	generic = bench::measure([&](size_t i) { yv[i] = a[i] * v[i]; }, count);
+	bench::doNotOptimize(yv);
+	bench::report("float4x4 * float4 (point)", generic);
+	special = bench::measure([&](size_t i) { yp[i] = transformPoint(a34[i], p[i]); }, count);
+	bench::doNotOptimize(yp);
+	bench::report("transformPoint(float3x4, float3)", special, generic);
+
+	generic = bench::measure([&](size_t i) { y[i] = inverseAffine(a[i]); }, count);
+	bench::doNotOptimize(y);
+	bench::report("inverseAffine(float4x4) (affine)", generic);
+	special = bench::measure([&](size_t i) { y34[i] = inverse(a34[i]); }, count);
+	bench::doNotOptimize(y34);
+	bench::report("inverse(float3x4)", special, generic);
+	special = bench::measure([&](size_t i) { y34[i] = inverseRigid(a34[i]); }, count);
+	bench::doNotOptimize(y34);
+	bench::report("inverseRigid(float3x4)", special, generic);
+
+	// instance buffers spilling to DRAM, bound by the 48 against 64 bytes per matrix
+	const size_t large = 1 << 20;
+	std::vector<float4x4> la(large), lb(large), ly(large);
+	std::vector<float3x4> la34(large), lb34(large), ly34(large);
+	for (size_t i = 0; i < large; ++i)
+	{
+		la[i] = a[i % count];
+		lb[i] = b[i % count];
+		la34[i] = a34[i % count];
+		lb34[i] = b34[i % count];
+	}
+	generic = bench::measure([&](size_t) { for (size_t i = 0; i < large; ++i) ly[i] = la[i] * lb[i]; }, 1) / large;
+	bench::doNotOptimize(ly);
+	bench::report("float4x4 * float4x4 (DRAM)", generic);
+	special = bench::measure([&](size_t) { multiply(la34.data(), lb34.data(), ly34.data(), large); }, 1) / large;
+	bench::doNotOptimize(ly34);
+	bench::report("multiply(float3x4*, count) (DRAM)", special, generic);
+	return 0;
+}
@@ -0,0 +1,69 @@
+#include "../math.h"
+#include "../Affine.h"
+#include "../Parallel.h"
+#include "Bench.h"
+#include <vector>
+#include <random>
+#include <thread>
+
+using namespace gm;
+
+// 2M instances: viewProjection * model, pairwise float4x4 products, quaternion slerp and normalize,
+// a plain loop against parallel:: on one thread and on all of them
+int main()
+{
+	const size_t count = 2 << 20;
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+	float4x4 viewProjection = perspective(1.0f, 1.5f, 0.1f, 100.0f) * translate(rotation(Quaternion::identity), float3(0.0f, 0.0f, -10.0f));
+	std::vector<float4x4> models(count), mvp(count);
+	std::vector<float3x4> affineModels(count);
+	std::vector<Quaternion> a(count), b(count), y(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		a[i].vec4 = normalize(float4(dist(rng), dist(rng), dist(rng), dist(rng)));
+		b[i].vec4 = normalize(float4(dist(rng), dist(rng), dist(rng), dist(rng)));
+		affineModels[i] = affine(a[i], float3(dist(rng), dist(rng), dist(rng)) * 10.0f);
+		models[i] = toMat4(affineModels[i]);
+	}
+
+	parallel::ThreadPool single(1);
+	parallel::ThreadPool all;
+	std::printf("%u threads\n", all.size());
+
+	double loop = bench::measure([&](size_t) { for (size_t i = 0; i < count; ++i) mvp[i] = viewProjection * models[i]; }, 1) / count;
+	bench::doNotOptimize(mvp);
+	bench::report("viewProjection * float4x4 loop", loop);
+	double time = bench::measure([&](size_t) { parallel::multiply(viewProjection, models.data(), mvp.data(), count, single); }, 1) / count;
+	bench::doNotOptimize(mvp);
+	bench::report("parallel::multiply, 1 thread", time, loop);
+	time = bench::measure([&](size_t) { parallel::multiply(viewProjection, models.data(), mvp.data(), count, all); }, 1) / count;
+	bench::doNotOptimize(mvp);
+	bench::report("parallel::multiply, all threads", time, loop);
+	time = bench::measure([&](size_t) { parallel::multiply(viewProjection, affineModels.data(), mvp.data(), count, all); }, 1) / count;
+	bench::doNotOptimize(mvp);
+	bench::report("parallel::multiply float3x4, all threads", time, loop);
+
+	loop = bench::measure([&](size_t) { for (size_t i = 0; i < count; ++i) mvp[i] = models[i] * models[count - 1 - i]; }, 1) / count;
+	bench::doNotOptimize(mvp);
+	bench::report("float4x4 * float4x4 loop", loop);
+	time = bench::measure([&](size_t) { parallel::multiply(models.data(), models.data(), mvp.data(), count, all); }, 1) / count;
+	bench::doNotOptimize(mvp);
+	bench::report("parallel::multiply pairs, all threads", time, loop);
+
+	loop = bench::measure([&](size_t) { for (size_t i = 0; i < count; ++i) y[i] = slerp(a[i], b[i], 0.3f); }, 1) / count;
+	bench::doNotOptimize(y);
+	bench::report("slerp loop", loop);
+	time = bench::measure([&](size_t) { parallel::slerp(a.data(), b.data(), 0.3f, y.data(), count, all); }, 1) / count;
+	bench::doNotOptimize(y);
+	bench::report("parallel::slerp, all threads", time, loop);
+
+	loop = bench::measure([&](size_t) { for (size_t i = 0; i < count; ++i) y[i] = normalize(a[i]); }, 1) / count;
+	bench::doNotOptimize(y);
+	bench::report("normalize loop", loop);
+	time = bench::measure([&](size_t) { parallel::normalize(a.data(), y.data(), count, all); }, 1) / count;
+	bench::doNotOptimize(y);
+	bench::report("parallel::normalize, all threads", time, loop);
+	return 0;
+}
@@ -0,0 +1,200 @@
+#include "../math.h"
+#include "../RayPacket.h"
+#include "Bench.h"
+#include <vector>
+#include <random>
+#include <new>
+
+using namespace gm;
+
+// Coherent rays from one camera against a triangle and a box, one ray against packets of triangles and boxes,
+// scalar tests against the packet kernels, ns per ray-primitive test
+template<int N>
+void benchPackets(std::mt19937& rng)
+{
+	const size_t count = 4096;
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+	std::vector<Ray<float>> rays(count);
+	for (size_t i = 0; i < count; ++i)
+		rays[i] = Ray<float>(float3(0.0f, 0.0f, -5.0f), float3(dist(rng) * 0.3f, dist(rng) * 0.3f, 1.0f));
+	bench::Buffer<RayPacket<N, float>> packets(count / N);
+	for (size_t i = 0; i < count / N; ++i)
+		new (&packets[i]) RayPacket<N, float>(rays.data() + i * N, 100.0f);
+	float3 v0(-1.0f, -1.0f, 0.0f), v1(1.0f, -1.0f, 0.2f), v2(0.0f, 1.0f, -0.2f);
+	AABB<3, float> box(float3(-0.5f), float3(0.5f));
+
+	char name[64];
+	std::vector<float> tMax(count);
+	double scalar = bench::measure([&](size_t i)
+	{
+		float t = 100.0f, u, v;
+		tMax[i] = intersect(rays[i], v0, v1, v2, t, u, v) ? t : 0.0f;
+	}, count);
+	bench::doNotOptimize(tMax);
+	bench::report("ray / triangle", scalar);
+	std::vector<uint32_t> hits(count / N);
+	double packet = bench::measure([&](size_t i)
+	{
+		for (int r = 0; r < N; ++r)
+			packets[i].tMax[r] = 100.0f;
+		hits[i] = intersect(packets[i], v0, v1, v2);
+	}, count / N) / N;
+	bench::doNotOptimize(hits);
+	std::snprintf(name, sizeof(name), "RayPacket<%d> / triangle", N);
+	bench::report(name, packet, scalar);
+
+	scalar = bench::measure([&](size_t i)
+	{
+		float t;
+		tMax[i] = intersect(rays[i], box, 100.0f, t) ? t : 0.0f;
+	}, count);
+	bench::doNotOptimize(tMax);
+	bench::report("ray / box", scalar);
+	std::vector<float> tNear(N);
+	packet = bench::measure([&](size_t i) { hits[i] = intersect(packets[i], box, tNear.data()); }, count / N) / N;
+	bench::doNotOptimize(hits);
+	std::snprintf(name, sizeof(name), "RayPacket<%d> / box", N);
+	bench::report(name, packet, scalar);
+
+	// N small triangles and boxes around the view direction
+	std::vector<float3> corners(3 * N);
+	std::vector<AABB<3, float>> boxes(N);
+	TrianglePacket<N, float> triangles;
+	BoxPacket<N, float> boxPacket;
+	for (int i = 0; i < N; ++i)
+	{
+		float3 c(dist(rng), dist(rng), dist(rng));
+		for (int k = 0; k < 3; ++k)
+			corners[3 * i + k] = c + float3(dist(rng), dist(rng), dist(rng)) * 0.5f;
+		triangles.set(i, corners[3 * i], corners[3 * i + 1], corners[3 * i + 2]);
+		boxes[i] = AABB<3, float>(c - float3(0.2f), c + float3(0.2f));
+		boxPacket.set(i, boxes[i]);
+	}
+	std::vector<int> closest(count);
+	scalar = bench::measure([&](size_t i)
+	{
+		float t = 100.0f, u, v;
+		int best = -1;
+		for (int k = 0; k < N; ++k)
+			if (intersect(rays[i], corners[3 * k], corners[3 * k + 1], corners[3 * k + 2], t, u, v))
+				best = k;
+		closest[i] = best;
+	}, count) / N;
+	bench::doNotOptimize(closest);
+	std::snprintf(name, sizeof(name), "ray / %d triangles, scalar", N);
+	bench::report(name, scalar);
+	packet = bench::measure([&](size_t i)
+	{
+		float t = 100.0f, u, v;
+		closest[i] = intersect(rays[i], triangles, t, u, v);
+	}, count) / N;
+	bench::doNotOptimize(closest);
+	std::snprintf(name, sizeof(name), "ray / TrianglePacket<%d>", N);
+	bench::report(name, packet, scalar);
+
+	std::vector<uint32_t> boxHits(count);
+	scalar = bench::measure([&](size_t i)
+	{
+		float3 invDirection = 1.0f / rays[i].direction;
+		uint32_t h = 0;
+		for (int k = 0; k < N; ++k)
+		{
+			float t;
+			h |= (uint32_t)intersectSlabs(rays[i].origin, invDirection, boxes[k], 100.0f, t) << k;
+		}
+		boxHits[i] = h;
+	}, count) / N;
+	bench::doNotOptimize(boxHits);
+	std::snprintf(name, sizeof(name), "ray / %d boxes, scalar", N);
+	bench::report(name, scalar);
+	packet = bench::measure([&](size_t i) { boxHits[i] = intersect(rays[i], boxPacket, 100.0f); }, count) / N;
+	bench::doNotOptimize(boxHits);
+	std::snprintf(name, sizeof(name), "ray / BoxPacket<%d>", N);
+	bench::report(name, packet, scalar);
+}
+
+// Random rays, triangles and boxes through both paths, the packet results must be bit identical to the scalar tests.
+// Returns the number of mismatches.
+template<int N, typename T>
+size_t checkPackets(std::mt19937& rng)
+{
+	std::uniform_real_distribution<T> dist(-1, 1);
+	auto point = [&] { return Vec<3, T>(dist(rng), dist(rng), dist(rng)); };
+	size_t mismatches = 0;
+	for (int it = 0; it < 2000; ++it)
+	{
+		Ray<T> rays[N];
+		RayPacket<N, T> packet;
+		for (int i = 0; i < N; ++i)
+		{
+			rays[i] = Ray<T>(point() + Vec<3, T>(0, 0, -3), Vec<3, T>(dist(rng) * (T)0.3, dist(rng) * (T)0.3, 1));
+			packet.set(i, rays[i], 4 + 2 * dist(rng));
+		}
+		Vec<3, T> v0 = point(), v1 = point(), v2 = point();
+		T tMax[N];
+		for (int i = 0; i < N; ++i)
+			tMax[i] = packet.tMax[i];
+		uint32_t hits = intersect(packet, v0, v1, v2);
+		for (int i = 0; i < N; ++i)
+		{
+			T u, v;
+			bool hit = intersect(rays[i], v0, v1, v2, tMax[i], u, v);
+			mismatches += hit != ((hits >> i & 1) != 0) || tMax[i] != packet.tMax[i] || (hit && (u != packet.u[i] || v != packet.v[i]));
+		}
+
+		Vec<3, T> corner = point();
+		AABB<3, T> box(corner, corner + Vec<3, T>((T)0.5));
+		T tNear[N];
+		hits = intersect(packet, box, tNear);
+		for (int i = 0; i < N; ++i)
+		{
+			T t;
+			bool hit = intersect(rays[i], box, packet.tMax[i], t);
+			mismatches += hit != ((hits >> i & 1) != 0) || (hit && t != tNear[i]);
+		}
+
+		TrianglePacket<N, T> triangles;
+		BoxPacket<N, T> boxes;
+		Vec<3, T> corners[N][3];
+		AABB<3, T> boxList[N];
+		for (int i = 0; i < N; ++i)
+		{
+			for (int k = 0; k < 3; ++k)
+				corners[i][k] = point();
+			triangles.set(i, corners[i][0], corners[i][1], corners[i][2]);
+			boxList[i] = AABB<3, T>(corners[i][0], corners[i][0] + Vec<3, T>((T)0.4));
+			boxes.set(i, boxList[i]);
+		}
+		T t = 10, u = 0, v = 0, rt = 10, ru = 0, rv = 0;
+		int best = intersect(rays[0], triangles, t, u, v), rbest = -1;
+		for (int i = 0; i < N; ++i)
+			if (intersect(rays[0], corners[i][0], corners[i][1], corners[i][2], rt, ru, rv))
+				rbest = i;
+		mismatches += best != rbest || t != rt || (best >= 0 && (u != ru || v != rv));
+		hits = intersect(rays[0], boxes, (T)10, tNear);
+		for (int i = 0; i < N; ++i)
+		{
+			T tn;
+			bool hit = intersect(rays[0], boxList[i], (T)10, tn);
+			mismatches += hit != ((hits >> i & 1) != 0) || (hit && tn != tNear[i]);
+		}
+	}
+	return mismatches;
+}
+
+int main()
+{
+	std::mt19937 rng(42);
+	size_t mismatches = checkPackets<4, float>(rng) + checkPackets<5, float>(rng) + checkPackets<16, float>(rng) + checkPackets<32, float>(rng) +
+		checkPackets<4, double>(rng) + checkPackets<8, double>(rng);
+	if (mismatches)
+	{
+		std::printf("%zu packet results differ from the scalar tests\n", mismatches);
+		return 1;
+	}
+	benchPackets<4>(rng);
+	benchPackets<8>(rng);
+	benchPackets<16>(rng);
+	return 0;
+}
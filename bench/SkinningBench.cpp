@@ -0,0 +1,83 @@
+#include "../math.h"
+#include "../Skinning.h"
+#include "Bench.h"
+#include <vector>
+#include <random>
+
+using namespace gm;
+
+template<int N>
+void benchSkinning(const char* naiveName, const char* name, const char* threadedName, const char* dualQuatName)
+{
+	const size_t count = 100000;
+	const int bones = 128;
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+	std::vector<float4x4> world(bones), inverseBind(bones);
+	for (int i = 0; i < bones; ++i)
+	{
+		Quaternion q;
+		q.vec4 = normalize(float4(dist(rng), dist(rng), dist(rng), dist(rng)));
+		world[i] = translate(rotation(q), float3(dist(rng), dist(rng), dist(rng)));
+		inverseBind[i] = translate(rotation(Quaternion::identity), float3(dist(rng), dist(rng), dist(rng)));
+	}
+	std::vector<float4x4> matrices(bones);
+	std::vector<Mat<3, 4, float>> palette(bones);
+	std::vector<DualQuat<float>> dualQuats(bones);
+	for (int i = 0; i < bones; ++i)
+	{
+		matrices[i] = world[i] * inverseBind[i];
+		Quaternion q;
+		q.vec4 = normalize(float4(dist(rng), dist(rng), dist(rng), dist(rng)));
+		dualQuats[i] = DualQuat<float>(q, float3(dist(rng), dist(rng), dist(rng)));
+	}
+	skinningPalette(world.data(), inverseBind.data(), palette.data(), bones);
+
+	std::vector<SkinInfluences<N, float>> influences(count);
+	std::vector<float3> positions(count), normals(count), outPositions(count), outNormals(count);
+	for (size_t v = 0; v < count; ++v)
+	{
+		for (int i = 0; i < N; ++i)
+		{
+			influences[v].bones[i] = (uint16_t)(rng() % bones);
+			influences[v].weights[i] = 1.0f / N;
+		}
+		positions[v] = float3(dist(rng), dist(rng), dist(rng));
+		normals[v] = normalize(float3(dist(rng), dist(rng), dist(rng)));
+	}
+
+	// one full Mat * Vec per influence, blended afterwards
+	double naive = bench::measure([&](size_t v)
+	{
+		const SkinInfluences<N, float>& in = influences[v];
+		float4 p(positions[v][0], positions[v][1], positions[v][2], 1.0f), n(normals[v][0], normals[v][1], normals[v][2], 0.0f);
+		float4 rp = matrices[in.bones[0]] * p * in.weights[0], rn = matrices[in.bones[0]] * n * in.weights[0];
+		for (int i = 1; i < N; ++i)
+		{
+			rp += matrices[in.bones[i]] * p * in.weights[i];
+			rn += matrices[in.bones[i]] * n * in.weights[i];
+		}
+		outPositions[v] = float3(rp[0], rp[1], rp[2]);
+		outNormals[v] = normalize(float3(rn[0], rn[1], rn[2]));
+	}, count);
+	bench::doNotOptimize(outPositions);
+	bench::report(naiveName, naive);
+	double batched = bench::measure([&](size_t) { skin(palette.data(), influences.data(), positions.data(), normals.data(), outPositions.data(), outNormals.data(), count, 1); }, 1) / count;
+	bench::doNotOptimize(outPositions);
+	bench::report(name, batched, naive);
+	batched = bench::measure([&](size_t) { skin(palette.data(), influences.data(), positions.data(), normals.data(), outPositions.data(), outNormals.data(), count); }, 1) / count;
+	bench::doNotOptimize(outPositions);
+	bench::report(threadedName, batched, naive);
+	batched = bench::measure([&](size_t) { skin(dualQuats.data(), influences.data(), positions.data(), normals.data(), outPositions.data(), outNormals.data(), count, 1); }, 1) / count;
+	bench::doNotOptimize(outPositions);
+	bench::report(dualQuatName, batched, naive);
+}
+
+// 100k vertices with positions and normals, 128 bones
+int main()
+{
+	benchSkinning<4>("Mat * Vec per influence, 4 bones", "skin, 4 bones", "skin, 4 bones, all threads", "skin dual quaternions, 4 bones");
+	benchSkinning<8>("Mat * Vec per influence, 8 bones", "skin, 8 bones", "skin, 8 bones, all threads", "skin dual quaternions, 8 bones");
+	return 0;
+}
@@ -0,0 +1,150 @@
+#include "../math.h"
+#include "../Transforms.h"
+#include "../AABB.h"
+#include "../TransformHierarchy.h"
+#include "../Normalize.h"
+#include "Bench.h"
+#include <vector>
+#include <random>
+
+using namespace gm;
+
+int main()
+{
+	const size_t count = 4096;
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+	std::vector<float3> v(count), y(count);
+	std::vector<Quaternion> q(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		v[i] = float3(dist(rng), dist(rng), dist(rng));
+		q[i].vec4 = normalize(float4(dist(rng), dist(rng), dist(rng), dist(rng)));
+	}
+	Quaternion r = q[0];
+	float4x4 m = translate(rotation(r), float3(0.0f));
+
+	double scalar = bench::measure([&](size_t i) { y[i] = r * v[i]; }, count);
+	bench::doNotOptimize(y);
+	bench::report("Quaternion * float3", scalar);
+	double batched = bench::measure([&](size_t) { rotateVectors(r, v, y); }, 1) / count;
+	bench::doNotOptimize(y);
+	bench::report("rotateVectors(Quaternion, span)", batched, scalar);
+	batched = bench::measure([&](size_t) { transformVectors(m, v, y); }, 1) / count;
+	bench::doNotOptimize(y);
+	bench::report("transformVectors(float4x4, span)", batched, scalar);
+
+	scalar = bench::measure([&](size_t i) { y[i] = q[i] * v[i]; }, count);
+	bench::doNotOptimize(y);
+	bench::report("Quaternion[i] * float3[i]", scalar);
+	batched = bench::measure([&](size_t) { rotateVectors(q.data(), v.data(), y.data(), count); }, 1) / count;
+	bench::doNotOptimize(y);
+	bench::report("rotateVectors(Quaternion*, float3*)", batched, scalar);
+
+	VecArraySoA<3, float> sv(v.data(), count), sy(count);
+	VecArraySoA<4, float> sq(count);
+	for (size_t i = 0; i < count; ++i)
+		sq.set(i, q[i].vec4);
+	batched = bench::measure([&](size_t) { rotateVectors(r, sv, sy); }, 1) / count;
+	bench::doNotOptimize(sy);
+	bench::report("rotateVectors(Quaternion, SoA)", batched, scalar);
+	batched = bench::measure([&](size_t) { rotateVectors(sq, sv, sy); }, 1) / count;
+	bench::doNotOptimize(sy);
+	bench::report("rotateVectors(SoA, SoA)", batched, scalar);
+
+	scalar = bench::measure([&](size_t i) { y[i] = normalize(v[i]); }, count);
+	bench::doNotOptimize(y);
+	bench::report("normalize(float3)", scalar);
+	batched = bench::measure([&](size_t i) { y[i] = normalizeFast(v[i]); }, count);
+	bench::doNotOptimize(y);
+	bench::report("normalizeFast(float3)", batched, scalar);
+	batched = bench::measure([&](size_t) { normalize(v.data(), y.data(), count); }, 1) / count;
+	bench::doNotOptimize(y);
+	bench::report("normalize(float3*)", batched, scalar);
+	batched = bench::measure([&](size_t) { normalizeFast(v.data(), y.data(), count); }, 1) / count;
+	bench::doNotOptimize(y);
+	bench::report("normalizeFast(float3*)", batched, scalar);
+	batched = bench::measure([&](size_t) { normalizeFastOrZero(v.data(), y.data(), count); }, 1) / count;
+	bench::doNotOptimize(y);
+	bench::report("normalizeFastOrZero(float3*)", batched, scalar);
+
+	std::vector<Quaternion> qy(count);
+	scalar = bench::measure([&](size_t i) { qy[i] = normalize(q[i]); }, count);
+	bench::doNotOptimize(qy);
+	bench::report("normalize(Quaternion)", scalar);
+	batched = bench::measure([&](size_t) { normalize(q.data(), qy.data(), count); }, 1) / count;
+	bench::doNotOptimize(qy);
+	bench::report("normalize(Quaternion*)", batched, scalar);
+	batched = bench::measure([&](size_t) { normalizeFast(q.data(), qy.data(), count); }, 1) / count;
+	bench::doNotOptimize(qy);
+	bench::report("normalizeFast(Quaternion*)", batched, scalar);
+
+	scalar = bench::measure([&](size_t i) { for (int k = 0; k < 3; ++k) sy.stream(k)[i] = v[i][k]; }, count);
+	bench::doNotOptimize(sy);
+	bench::report("float3[i] -> SoA, per element", scalar);
+	batched = bench::measure([&](size_t) { toSoA(v.data(), count, sy); }, 1) / count;
+	bench::doNotOptimize(sy);
+	bench::report("toSoA(float3*, VecArraySoA)", batched, scalar);
+	scalar = bench::measure([&](size_t i) { for (int k = 0; k < 3; ++k) y[i][k] = sy.stream(k)[i]; }, count);
+	bench::doNotOptimize(y);
+	bench::report("SoA -> float3[i], per element", scalar);
+	batched = bench::measure([&](size_t) { toAoS(sy, y.data()); }, 1) / count;
+	bench::doNotOptimize(y);
+	bench::report("toAoS(VecArraySoA, float3*)", batched, scalar);
+
+	std::vector<float3> angles(count);
+	std::vector<float3x3> rm(count);
+	for (size_t i = 0; i < count; ++i)
+		angles[i] = v[i] * 180.0f;
+	scalar = bench::measure([&](size_t i) { q[i] = Quaternion::euler(angles[i]); }, count);
+	bench::doNotOptimize(q);
+	bench::report("Quaternion::euler", scalar);
+	batched = bench::measure([&](size_t) { eulerToQuat(angles.data(), q.data(), count); }, 1) / count;
+	bench::doNotOptimize(q);
+	bench::report("eulerToQuat", batched, scalar);
+	scalar = bench::measure([&](size_t i) { rm[i] = rotation(v[i]); }, count);
+	bench::doNotOptimize(rm);
+	bench::report("rotation(float3)", scalar);
+	batched = bench::measure([&](size_t) { eulerToMatrix(v.data(), rm.data(), count); }, 1) / count;
+	bench::doNotOptimize(rm);
+	bench::report("eulerToMatrix", batched, scalar);
+
+	std::vector<AABB<3, float>> boxes(count), worldBoxes(count);
+	std::vector<float4x4> world(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		boxes[i] = AABB<3, float>(v[i] - float3(0.5f), v[i] + float3(0.5f));
+		world[i] = translate(rotation(q[i]), v[i] * 10.0f);
+	}
+	scalar = bench::measure([&](size_t i) { worldBoxes[i] = transform<float>(world[i], boxes[i]); }, count);
+	bench::doNotOptimize(worldBoxes);
+	bench::report("transform<float>(float4x4, AABB)", scalar);
+	batched = bench::measure([&](size_t) { transform(world.data(), boxes.data(), worldBoxes.data(), count); }, 1) / count;
+	bench::doNotOptimize(worldBoxes);
+	bench::report("transform(float4x4*, AABB*)", batched, scalar);
+	batched = bench::measure([&](size_t) { AABB<3, float> b(v.data(), count); worldBoxes[0] = b; }, 1) / count;
+	bench::doNotOptimize(worldBoxes);
+	bench::report("AABB(float3*, count) per point", batched);
+
+	// 8 children per node, parents always come first
+	TransformHierarchy<float> hierarchy;
+	std::vector<uint32_t> parents(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		parents[i] = i ? (uint32_t)(i - 1) / 8 : TransformHierarchy<float>::NoParent;
+		hierarchy.add(parents[i], v[i], q[i], float3(1.0f));
+	}
+	scalar = bench::measure([&](size_t i)
+	{
+		float4x4 local = translate(rotation(q[i]), v[i]);
+		world[i] = i ? world[parents[i]] * local : local;
+	}, count);
+	bench::doNotOptimize(world);
+	bench::report("parent world * translate(rotation(q), p)", scalar);
+	batched = bench::measure([&](size_t) { hierarchy.setPosition(0, v[0]); hierarchy.update(1); }, 1) / count;
+	bench::report("TransformHierarchy::update, all dirty", batched, scalar);
+	batched = bench::measure([&](size_t) { hierarchy.update(1); }, 1) / count;
+	bench::report("TransformHierarchy::update, static", batched, scalar);
+	return 0;
+}
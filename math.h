@@ -11,6 +11,7 @@ namespace gm
 	typedef Vec<3, float> float3;
 	typedef Vec<4, float> float4;
 	typedef Mat<4, 4, float> float4x4;
+	typedef Mat<3, 4, float> float3x4;
 	typedef Mat<3, 3, float> float3x3;
 	typedef Mat<2, 2, float> float2x2;
 	typedef Quat<float> Quaternion;